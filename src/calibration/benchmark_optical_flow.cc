@@ -0,0 +1,208 @@
+#include "../lib/args.h"
+#include "../lib/opencv.h"
+#include "../lib/dataset.h"
+#include "lib/feature_points.h"
+#include "lib/image_pyramid_cache.h"
+#include "lib/lk_tracker.h"
+#include <iostream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstdint>
+#include <algorithm>
+#include <stdexcept>
+#include <format.h>
+
+using namespace tlz;
+
+using tracker_type = lk_tracker<20, 20>;
+constexpr real position_tolerance = 0.05;
+constexpr std::uint64_t synthetic_seed = 1;
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+double elapsed_ms(clock_type::time_point start) {
+	return std::chrono::duration<double, std::milli>(clock_type::now() - start).count();
+}
+
+image_pyramid make_pyramid(const cv::Mat_<uchar>& gray_img, int max_level) {
+	image_pyramid pyramid;
+	cv::buildOpticalFlowPyramid(gray_img, pyramid, tracker_type::window_size(), max_level);
+	return pyramid;
+}
+
+image_pyramid load_pyramid(const dataset_view& view, int max_level) {
+	cv::Mat_<uchar> gray_img;
+	cv::cvtColor(view.load_texture(), gray_img, CV_BGR2GRAY);
+	return make_pyramid(gray_img, max_level);
+}
+
+
+/// Load reference view and nearest views on same row of dataset, and positions of reference features.
+/** Reads the dataset arguments, and the destinations count. */
+void load_dataset_flows(int max_level, image_pyramid& origin_pyramid, std::vector<image_pyramid>& dest_pyramids, std::vector<cv::Point2f>& positions) {
+	dataset datas = dataset_arg();
+	feature_points fpoints = feature_points_arg();
+	std::string dataset_group_name = string_opt_arg("");
+	int destinations_count = int_opt_arg(8);
+	if(destinations_count < 1) throw std::invalid_argument("destinations count must be at least 1");
+	dataset_group datag = datas.group(dataset_group_name);
+	const view_index& reference_idx = fpoints.view_idx;
+
+	for(const auto& kv : fpoints.points) positions.emplace_back(kv.second.position[0], kv.second.position[1]);
+	std::cout << positions.size() << " features on reference view " << encode_view_index(reference_idx) << std::endl;
+
+	std::cout << "loading images" << std::endl;
+	origin_pyramid = load_pyramid(datag.view(reference_idx), max_level);
+	std::vector<int> x_indices = datas.x_indices();
+	std::stable_sort(x_indices.begin(), x_indices.end(), [&](int a, int b) {
+		return (std::abs(a - reference_idx.x) < std::abs(b - reference_idx.x));
+	});
+	for(int x : x_indices) {
+		if(dest_pyramids.size() == destinations_count) break;
+		dataset_view view = datag.view(view_index(x, reference_idx.y));
+		if(x == reference_idx.x || ! view.image_exists()) continue;
+		dest_pyramids.push_back(load_pyramid(view, max_level));
+	}
+	if(dest_pyramids.empty()) throw std::runtime_error("no destination views with images");
+	std::cout << dest_pyramids.size() << " destination views, on same row as reference view" << std::endl;
+}
+
+
+/// Generate textured image, and copies shifted by random subpixel offsets with noise, and features to track.
+/** Some features are put on or outside the image borders, where tracking fails. Deterministic, for use as regression
+ ** check. Reads the destinations count argument. */
+void make_synthetic_flows(int max_level, image_pyramid& origin_pyramid, std::vector<image_pyramid>& dest_pyramids, std::vector<cv::Point2f>& positions) {
+	int destinations_count = int_opt_arg(8);
+	if(destinations_count < 1) throw std::invalid_argument("destinations count must be at least 1");
+	const cv::Size size(640, 480);
+	cv::RNG rng(synthetic_seed);
+
+	cv::Mat_<float> coarse_noise(size.height/8, size.width/8), fine_noise(size.height/2, size.width/2);
+	rng.fill(coarse_noise, cv::RNG::UNIFORM, 0.0, 1.0);
+	rng.fill(fine_noise, cv::RNG::UNIFORM, 0.0, 1.0);
+	cv::Mat_<float> base, fine;
+	cv::resize(coarse_noise, base, size, 0.0, 0.0, cv::INTER_CUBIC);
+	cv::resize(fine_noise, fine, size, 0.0, 0.0, cv::INTER_LINEAR);
+	base += 0.3 * fine;
+	cv::normalize(base, base, 0.0, 255.0, cv::NORM_MINMAX);
+	cv::Mat_<uchar> origin_img;
+	base.convertTo(origin_img, CV_8U);
+	origin_pyramid = make_pyramid(origin_img, max_level);
+
+	for(int dest = 0; dest < destinations_count; ++dest) {
+		cv::Mat_<double> shift = (cv::Mat_<double>(2, 3) <<
+			1.0, 0.0, rng.uniform(-15.0, 15.0),
+			0.0, 1.0, rng.uniform(-15.0, 15.0));
+		cv::Mat_<float> shifted, noise(size);
+		cv::warpAffine(base, shifted, shift, size, cv::INTER_LINEAR, cv::BORDER_REFLECT);
+		rng.fill(noise, cv::RNG::NORMAL, 0.0, 2.0);
+		shifted += noise;
+		cv::Mat_<uchar> dest_img;
+		shifted.convertTo(dest_img, CV_8U);
+		dest_pyramids.push_back(make_pyramid(dest_img, max_level));
+	}
+
+	cv::goodFeaturesToTrack(origin_img, positions, 300, 0.001, 8);
+	const float w = size.width, h = size.height;
+	for(const cv::Point2f& pt : { cv::Point2f(1.0, 1.0), cv::Point2f(w-1.5, h-1.5), cv::Point2f(-5.0, 10.0), cv::Point2f(w+3.0, 20.0), cv::Point2f(0.2, 300.0), cv::Point2f(w-0.3, 100.0) })
+		positions.push_back(pt);
+	std::cout << positions.size() << " features on synthetic " << size.width << "x" << size.height << " image, "
+		<< dest_pyramids.size() << " shifted destination images" << std::endl;
+}
+
+}
+
+
+int main(int argc, const char* argv[]) {
+	get_args(argc, argv, "dataset_parameters.json/synthetic [reference_fpoints.json] [dataset_group] [destinations_count] [repetitions]");
+	bool synthetic = args().next_arg_is("synthetic");
+	if(synthetic) args().next_arg();
+
+	tracker_type tracker;
+	const lk_tracker_parameters& param = tracker.parameters();
+	cv::TermCriteria term(cv::TermCriteria::COUNT | cv::TermCriteria::EPS, param.max_iterations, param.epsilon);
+
+	image_pyramid origin_pyramid;
+	std::vector<image_pyramid> dest_pyramids;
+	std::vector<cv::Point2f> positions;
+	if(synthetic) make_synthetic_flows(param.max_level, origin_pyramid, dest_pyramids, positions);
+	else load_dataset_flows(param.max_level, origin_pyramid, dest_pyramids, positions);
+	int repetitions = int_opt_arg(10);
+	if(repetitions < 1) throw std::invalid_argument("repetitions must be at least 1");
+
+	// single thread for both, as the optical flow tools run flows in parallel instead
+	cv::setNumThreads(1);
+
+	std::cout << "running cv::calcOpticalFlowPyrLK" << std::endl;
+	std::vector<std::vector<cv::Point2f>> cv_positions(dest_pyramids.size());
+	std::vector<std::vector<uchar>> cv_status(dest_pyramids.size());
+	std::vector<std::vector<float>> cv_errors(dest_pyramids.size());
+	auto cv_start = clock_type::now();
+	for(int rep = 0; rep < repetitions; ++rep)
+		for(std::ptrdiff_t dest = 0; dest < dest_pyramids.size(); ++dest)
+			cv::calcOpticalFlowPyrLK(origin_pyramid, dest_pyramids[dest], positions, cv_positions[dest], cv_status[dest], cv_errors[dest], tracker_type::window_size(), param.max_level, term, 0, param.min_eigen_threshold);
+	double cv_time = elapsed_ms(cv_start) / repetitions;
+
+	std::cout << "running lk_tracker (" << lk_tracker_instruction_set() << ")" << std::endl;
+	std::vector<std::vector<cv::Point2f>> lk_positions(dest_pyramids.size());
+	std::vector<std::vector<uchar>> lk_status(dest_pyramids.size());
+	std::vector<std::vector<float>> lk_errors(dest_pyramids.size());
+	double prepare_time = 0.0;
+	auto lk_start = clock_type::now();
+	for(int rep = 0; rep < repetitions; ++rep) {
+		auto prepare_start = clock_type::now();
+		tracker_type::origin orig = tracker.prepare(origin_pyramid, positions);
+		prepare_time += elapsed_ms(prepare_start);
+		for(std::ptrdiff_t dest = 0; dest < dest_pyramids.size(); ++dest)
+			tracker.track(orig, dest_pyramids[dest], lk_positions[dest], lk_status[dest], lk_errors[dest]);
+	}
+	double lk_time = elapsed_ms(lk_start) / repetitions;
+	prepare_time /= repetitions;
+
+	std::size_t tracked_count = 0, status_mismatches_count = 0;
+	real max_position_diff = 0.0, mean_position_diff = 0.0, max_error_diff = 0.0;
+	for(std::ptrdiff_t dest = 0; dest < dest_pyramids.size(); ++dest) {
+		for(std::ptrdiff_t feature = 0; feature < positions.size(); ++feature) {
+			bool cv_ok = cv_status[dest][feature], lk_ok = lk_status[dest][feature];
+			if(cv_ok != lk_ok) ++status_mismatches_count;
+			if(! cv_ok || ! lk_ok) continue;
+			const cv::Point2f& cv_pos = cv_positions[dest][feature];
+			const cv::Point2f& lk_pos = lk_positions[dest][feature];
+			real diff = std::hypot(cv_pos.x - lk_pos.x, cv_pos.y - lk_pos.y);
+			max_position_diff = std::max(max_position_diff, diff);
+			mean_position_diff += diff;
+			max_error_diff = std::max<real>(max_error_diff, std::abs(cv_errors[dest][feature] - lk_errors[dest][feature]));
+			++tracked_count;
+		}
+	}
+	if(tracked_count > 0) mean_position_diff /= tracked_count;
+
+	std::cout << "\ncomparison, over " << dest_pyramids.size() << " flows:\n"
+		<< "tracked by both: " << tracked_count << "\n"
+		<< "status mismatches: " << status_mismatches_count << "\n"
+		<< "max position difference: " << max_position_diff << " px\n"
+		<< "mean position difference: " << mean_position_diff << " px\n"
+		<< "max error difference: " << max_error_diff << "\n" << std::endl;
+
+	std::cout << "time, for " << dest_pyramids.size() << " flows of " << positions.size() << " features:\n"
+		<< fmt::format("cv::calcOpticalFlowPyrLK: {:.3f} ms\n", cv_time)
+		<< fmt::format("lk_tracker: {:.3f} ms (prepare: {:.3f} ms)\n", lk_time, prepare_time)
+		<< fmt::format("speedup: {:.2f}x\n", cv_time / lk_time) << std::endl;
+
+	if(tracked_count == 0) {
+		std::cout << "no features tracked by both, nothing compared" << std::endl;
+		return EXIT_FAILURE;
+	} else if(status_mismatches_count > 0) {
+		std::cout << "lk_tracker status does not match OpenCV for " << status_mismatches_count << " features" << std::endl;
+		return EXIT_FAILURE;
+	} else if(max_position_diff > position_tolerance) {
+		std::cout << "lk_tracker does not match OpenCV within tolerance of " << position_tolerance << " px" << std::endl;
+		return EXIT_FAILURE;
+	}
+	std::cout << "lk_tracker matches OpenCV, with same status and within tolerance of " << position_tolerance << " px" << std::endl;
+}
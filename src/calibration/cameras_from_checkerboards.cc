@@ -52,16 +52,15 @@ int main(int argc, const char* argv[]) {
 		
 		// load image
 		dataset_view view = datag.view(idx);
-		std::string image_filename = view.image_filename();
 		std::string camera_name = view.camera_name();
-		if(! file_exists(image_filename)) {
+		if(! view.image_exists()) {
 			std::cout << idx << ": no image file" << std::endl;
 			continue; 
 		}
 		
 		cv::Mat_<cv::Vec3b> img;
 		try {
-			img = load_texture(image_filename);
+			img = view.load_texture();
 		} catch(...) {
 			std::cout << idx << ": could not load image" << std::endl;
 			continue;
@@ -30,7 +30,7 @@ int main(int argc, const char* argv[]) {
 		// check if image files for all views in this column exist
 		for(int y = datag.set().y_min(); y <= datag.set().y_max(); y += datag.set().y_step()) {
 			view_index idx(x, y);
-			if(! file_exists(datag.view(idx).image_filename())) return false;
+			if(! datag.view(idx).image_exists()) return false;
 		}
 		return true;
 	};
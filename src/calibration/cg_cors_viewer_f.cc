@@ -55,19 +55,22 @@ int main(int argc, const char* argv[]) {
 		
 		cv::Mat_<cv::Vec3b> img;
 		{
-			std::string image_filename = datag.view(idx).image_filename();
-			std::string depth_filename = datag.view(idx).depth_filename();
+			dataset_view dview = datag.view(idx);
 
-			cv::Mat_<uchar> gray_img = cv::imread(image_filename, CV_LOAD_IMAGE_GRAYSCALE);
-			if(gray_img.empty()) {
+			cv::Mat_<uchar> gray_img;
+			try {
+				gray_img = dview.load_gray();
+			} catch(const std::runtime_error&) {
 				gray_img = cv::Mat_<uchar>(datag.image_size_with_border());
 				gray_img.setTo(0);
 			}
 			
-			if(depth_opacity_slider > 0.0 && file_exists(depth_filename)) {
-				cv::Mat_<ushort> depth_img = load_depth(depth_filename);
+			if(depth_opacity_slider > 0.0 && dview.depth_exists()) {
+				cv::Mat_<ushort> depth_img = dview.load_depth();
 				cv::Mat_<uchar> viz_depth_img = viewer::visualize_depth(depth_img, d_min_slider, d_max_slider);
-				cv::addWeighted(gray_img, 1.0-depth_opacity_slider, viz_depth_img, depth_opacity_slider, 0.0, gray_img);
+				cv::Mat_<uchar> blended_img; // not in place, gray_img is shared with image cache
+				cv::addWeighted(gray_img, 1.0-depth_opacity_slider, viz_depth_img, depth_opacity_slider, 0.0, blended_img);
+				gray_img = blended_img;
 			}
 
 			cv::cvtColor(gray_img, img, CV_GRAY2BGR);
@@ -33,9 +33,10 @@ int main(int argc, const char* argv[]) {
 		
 		cv::Mat_<cv::Vec3b> img;
 		{
-			std::string image_filename = datag.view(idx).image_filename();
-			cv::Mat_<uchar> gray_img = cv::imread(image_filename, CV_LOAD_IMAGE_GRAYSCALE);
-			if(gray_img.empty()) {
+			cv::Mat_<uchar> gray_img;
+			try {
+				gray_img = datag.view(idx).load_gray();
+			} catch(const std::runtime_error&) {
 				gray_img = cv::Mat_<uchar>(datag.image_size_with_border());
 				gray_img.setTo(0);
 			}
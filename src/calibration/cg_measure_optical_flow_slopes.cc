@@ -2,6 +2,7 @@
 #include <map>
 #include <cmath>
 #include "lib/image_correspondence.h"
+#include "lib/flat_image_correspondences.h"
 #include "lib/cg/feature_slopes.h"
 #include "../lib/misc.h"
 #include "../lib/json.h"
@@ -11,13 +12,15 @@
 
 using namespace tlz;
 
-real measure_horizontal_slope(const image_correspondence_feature& feature, int y_outreach) {
+using feature_id = flat_image_correspondences::feature_id;
+
+real measure_horizontal_slope(const flat_image_correspondences& cors, feature_id f, int y_outreach) {
+	const view_index& reference_view = cors.reference_views[f];
 	std::vector<cv::Vec2f> points;
-	for(const auto& kv : feature.points) {
-		const view_index& idx = kv.first;
-		const feature_point& fpoint = kv.second;
-		if(std::abs(idx.y - feature.reference_view.y) <= y_outreach)
-			points.push_back(fpoint.position);
+	for(std::ptrdiff_t p = cors.feature_begin(f); p < cors.feature_end(f); ++p) {
+		const view_index& idx = cors.views[p];
+		if(std::abs(idx.y - reference_view.y) <= y_outreach)
+			points.push_back(cors.position(p));
 	}
 
 	cv::Vec4f line_parameters;
@@ -26,13 +29,13 @@ real measure_horizontal_slope(const image_correspondence_feature& feature, int y
 	return line_parameters[1] / line_parameters[0];
 }
 
-real measure_vertical_slope(const image_correspondence_feature& feature) {
+real measure_vertical_slope(const flat_image_correspondences& cors, feature_id f) {
+	const view_index& reference_view = cors.reference_views[f];
 	std::vector<cv::Vec2f> points;
-	for(const auto& kv : feature.points) {
-		const view_index& idx = kv.first;
-		const feature_point& fpoint = kv.second;
-		if(idx.x == feature.reference_view.x)
-			points.push_back(fpoint.position);
+	for(std::ptrdiff_t p = cors.feature_begin(f); p < cors.feature_end(f); ++p) {
+		const view_index& idx = cors.views[p];
+		if(idx.x == reference_view.x)
+			points.push_back(cors.position(p));
 	}
 	
 	cv::Vec4f line_parameters;
@@ -45,22 +48,19 @@ real measure_vertical_slope(const image_correspondence_feature& feature) {
 int main(int argc, const char* argv[]) {
 	get_args(argc, argv, "dataset_parameters.json image_correspondences.json intrinsics.json out_slopes.json");
 	dataset datas = dataset_arg();
-	image_correspondences dist_cors = image_correspondences_arg();
+	flat_image_correspondences dist_cors = flat_image_correspondences_arg();
 	intrinsics intr = intrinsics_arg();
 	std::string out_slopes_filename = out_filename_arg();
 	int y_outreach = 3;
 	
 	std::cout << "undistorting image correspondences (if applicable)" << std::endl;
-	image_correspondences cors = undistort(dist_cors, intr);
+	flat_image_correspondences cors = undistort(dist_cors, intr);
 	
 	std::cout << "measuring slopes" << std::endl;
-	std::map<std::string, real> feature_horizontal_slopes, feature_vertical_slopes;
-	for(const auto& kv : cors.features) {
-		const std::string& feature_name = kv.first;
-		const image_correspondence_feature& feature = kv.second;
-		
-		feature_horizontal_slopes[feature_name] = measure_horizontal_slope(feature, y_outreach);
-		feature_vertical_slopes[feature_name] = measure_vertical_slope(feature);
+	std::vector<real> feature_horizontal_slopes(cors.features_count()), feature_vertical_slopes(cors.features_count());
+	for(feature_id f = 0; f < cors.features_count(); ++f) {
+		feature_horizontal_slopes[f] = measure_horizontal_slope(cors, f, y_outreach);
+		feature_vertical_slopes[f] = measure_vertical_slope(cors, f);
 	
 		std::cout << '.' << std::flush;
 	}
@@ -71,14 +71,15 @@ int main(int argc, const char* argv[]) {
 	auto ref_views = get_reference_views(cors);
 	feature_slopes fslopes;
 	for(const view_index& ref_idx : ref_views) {
-		image_correspondences ref_cors = image_correspondences_with_reference(cors, ref_idx);
+		flat_image_correspondences ref_cors = image_correspondences_with_reference(cors, ref_idx);
 		feature_points ref_fpoints = undistorted_feature_points_for_view(ref_cors, ref_idx, intr);
 		feature_slopes ref_fslopes(ref_fpoints);
-		for(auto& kv : ref_cors.features) {
-			const std::string& feature_name = kv.first;
+		for(feature_id f = 0; f < cors.features_count(); ++f) {
+			if(cors.reference_views[f] != ref_idx) continue;
+			const std::string& feature_name = cors.feature_names[f];
 			feature_slope& fslope = ref_fslopes.slopes[feature_name];
-			fslope.horizontal = feature_horizontal_slopes.at(feature_name);
-			fslope.vertical = feature_vertical_slopes.at(feature_name);
+			fslope.horizontal = feature_horizontal_slopes[f];
+			fslope.vertical = feature_vertical_slopes[f];
 			fslopes = merge_multiview_feature_slopes(fslopes, ref_fslopes);
 		}
 	}
@@ -7,15 +7,24 @@
 #include <mutex>
 #include <cmath>
 #include <map>
+#include <algorithm>
+#include <exception>
 #include <format.h>
 #include "lib/feature_points.h"
 #include "lib/image_correspondence.h"
+#include "lib/image_pyramid_cache.h"
+#include "lib/lk_tracker.h"
+#include "lib/dense_image_correspondences.h"
+#include "lib/cg/references_grid.h"
 #include "../lib/args.h"
 #include "../lib/json.h"
 #include "../lib/filesystem.h"
 #include "../lib/dataset.h"
 #include "../lib/opencv.h"
 #include "../lib/image_io.h"
+#include "../lib/image_cache.h"
+#include "../lib/view_read_ahead.h"
+#include "../lib/assert.h"
 
 using namespace tlz;
 
@@ -24,44 +33,59 @@ constexpr bool verbose = false;
 constexpr real max_flow_err = 4.0;
 constexpr real min_distance_between_features = 60;
 constexpr int max_pyramid_level = 3;
-const cv::Size horizontal_optical_flow_window_size(20, 20);
-const cv::Size vertical_optical_flow_window_size(20, 20);
+using optical_flow_tracker = lk_tracker<20, 20>;
+const cv::Size horizontal_optical_flow_window_size = optical_flow_tracker::window_size();
+const cv::Size vertical_optical_flow_window_size = optical_flow_tracker::window_size();
+constexpr std::size_t horizontal_read_ahead_window = 4;
 
+using feature_index = std::ptrdiff_t;
+
+/// Positions of features on one view. Features of different reference views can be tracked together.
 struct flow_state {
 	view_index view_idx;
-	std::vector<cv::Mat_<uchar>> image_pyramid;
+	image_pyramid_ptr pyramid;
+	std::vector<feature_index> features;
 	std::vector<cv::Point2f> feature_positions;
 	std::vector<uchar> feature_status;
-	
-	flow_state() = default;
-	flow_state(const view_index& idx, const cv::Mat_<uchar>& img, std::size_t features_count) :
-		view_idx(idx),
-		image_pyramid({img}),
-		feature_positions(features_count),
-		feature_status(features_count) { }
-			
-	std::size_t features_count() const { return feature_positions.size(); }
-	std::size_t valid_features_count() const;
+
+	std::size_t features_count() const { return features.size(); }
 	bool is_valid() const { return view_idx.is_valid(); }
+
+	void append(const flow_state&);
+	void remove_invalid_features();
 };
 
-std::size_t flow_state::valid_features_count() const {
+void flow_state::append(const flow_state& st) {
+	features.insert(features.end(), st.features.begin(), st.features.end());
+	feature_positions.insert(feature_positions.end(), st.feature_positions.begin(), st.feature_positions.end());
+	feature_status.insert(feature_status.end(), st.feature_status.begin(), st.feature_status.end());
+}
+
+void flow_state::remove_invalid_features() {
 	std::size_t count = 0;
-	for(uchar status : feature_status) if(status) ++count;
-	return count;
+	for(std::ptrdiff_t i = 0; i < features_count(); ++i) {
+		if(! feature_status[i]) continue;
+		features[count] = features[i];
+		feature_positions[count] = feature_positions[i];
+		feature_status[count] = feature_status[i];
+		++count;
+	}
+	features.resize(count);
+	feature_positions.resize(count);
+	feature_status.resize(count);
 }
 
+/// Reference view, and initial positions of the features that get tracked from it.
+struct flow_reference {
+	view_index view_idx;
+	feature_index first_feature;
+	std::vector<vec2> positions;
+};
+
 int horizontal_outreach;
 int vertical_outreach;
 
-using local_feature_index = std::ptrdiff_t;
-using correspondence_key_type = std::pair<local_feature_index, view_index>;
-using correspondences_type = std::map<correspondence_key_type, vec2>;
-
-inline correspondence_key_type cor_key(local_feature_index i, const view_index& idx) {
-	return std::make_pair(i, idx);
-}
-
+image_pyramid_cache pyramids(default_image_pyramid_cache_capacity());
 
 void print_flow_indicator(const view_index& origin_idx, const view_index& dest_idx) {
 	char dir = '?';
@@ -69,94 +93,99 @@ void print_flow_indicator(const view_index& origin_idx, const view_index& dest_i
 	else if(origin_idx.y > dest_idx.y) dir = 'v';
 	else if(origin_idx.x < dest_idx.x) dir = '>';
 	else if(origin_idx.x > dest_idx.x) dir = '<';
-	
+
 	if(verbose) std::cout << origin_idx << " --" << dir << "-- " << dest_idx << std::endl;
 	else std::cout << dir << std::flush;
 }
 
 
-void add_correspondences(correspondences_type& cors, const flow_state& state) {
-	std::size_t count = state.feature_positions.size();
-	for(local_feature_index i = 0; i < count; ++i) {
-		if(state.feature_status[i]) {
-			vec2 pos = point2f_to_vec2(state.feature_positions[i]);
-			cors[std::make_pair(i, state.view_idx)] = pos;
-		}
-	}
+void add_correspondences(dense_image_correspondences& cors, const flow_state& state) {
+	std::size_t count = state.features_count();
+	for(std::ptrdiff_t i = 0; i < count; ++i)
+		if(state.feature_status[i]) cors.set(state.features[i], state.view_idx, state.feature_positions[i]);
+}
+
+
+cv::Mat_<uchar> to_gray(const cv::Mat_<cv::Vec3b>& col_img) {
+	cv::Mat_<uchar> gray_img;
+	cv::cvtColor(col_img, gray_img, CV_BGR2GRAY);
+	return gray_img;
 }
 
 
 cv::Mat_<uchar> load_image(const dataset_group& datag, const view_index& idx, bool must_exist) {
-	static std::mutex disk_read_lock;
-	//std::lock_guard<std::mutex> lock(disk_read_lock);
-	std::string image_filename = datag.view(idx).image_filename();
-	if(file_exists(image_filename)) {
-		cv::Mat_<cv::Vec3b> col_img = load_texture(image_filename);
-		cv::Mat_<uchar> gray_img;
-		cv::cvtColor(col_img, gray_img, CV_BGR2GRAY);
-		return gray_img;
-	} else {
-		if(must_exist) throw std::runtime_error("image for " + encode_view_index(idx) + " must exist, but does not");
-		else return cv::Mat_<uchar>();
-	}
+	dataset_view view = datag.view(idx);
+	if(view.image_exists()) return to_gray(view.load_texture());
+	else if(must_exist) throw std::runtime_error("image for " + encode_view_index(idx) + " must exist, but does not");
+	else return cv::Mat_<uchar>();
 }
 
 
+cv::Mat_<uchar> read_ahead_image(const read_ahead_view& view, bool must_exist) {
+	if(! view.texture.empty()) return to_gray(view.texture);
+	else if(must_exist) throw std::runtime_error("image for " + encode_view_index(view.idx) + " must exist, but does not");
+	else return cv::Mat_<uchar>();
+}
 
-flow_state flow_to(flow_state& origin_state, view_index dest_idx, const dataset_group& datag, const cv::Size& window_size, bool may_skip) {
-	std::size_t features_count = origin_state.features_count();
 
-	if(origin_state.image_pyramid.size() <= max_pyramid_level) {
-		cv::Mat_<uchar> orig_img;
-		origin_state.image_pyramid.front().copyTo(orig_img);
-		origin_state.image_pyramid.clear();
-		cv::buildOpticalFlowPyramid(
-			orig_img,
-			origin_state.image_pyramid,
-			window_size,
-			max_pyramid_level
-		);
+/// Call `callback(idx, pyramid)` for the views at `indices` in order, until it returns false.
+/** Pyramids come from the shared cache. Only the images of views whose pyramid is not yet cached are read ahead.
+ ** Pyramid is null for views with missing image, unless `must_exist` (then it throws). */
+template<typename Callback>
+void pyramid_sweep(const dataset_group& datag, const std::vector<view_index>& indices, const cv::Size& window_size, bool must_exist, Callback&& callback, std::size_t read_ahead_window = 8, int read_ahead_threads = 2) {
+	std::vector<view_index> load_indices;
+	for(const view_index& idx : indices)
+		if(! pyramids.contains(idx, window_size, max_pyramid_level)) load_indices.push_back(idx);
+	view_read_ahead read_ahead(datag, load_indices, view_read_ahead::texture, read_ahead_window, read_ahead_threads);
+
+	auto load_it = load_indices.cbegin();
+	for(const view_index& idx : indices) {
+		image_pyramid_ptr pyramid;
+		if(load_it != load_indices.cend() && *load_it == idx) {
+			// consume read-ahead view even if its pyramid got cached in the meantime, to stay in sync
+			read_ahead_view view;
+			read_ahead.next(view);
+			++load_it;
+			pyramid = pyramids.load(idx, window_size, max_pyramid_level, [&]() {
+				return read_ahead_image(view, must_exist);
+			});
+		} else {
+			pyramid = pyramids.load(idx, window_size, max_pyramid_level, [&]() {
+				return load_image(datag, idx, must_exist);
+			});
+		}
+		if(! callback(idx, pyramid)) break;
 	}
+}
 
-	cv::Mat_<uchar> dest_img = load_image(datag, dest_idx, !may_skip);
-	if(may_skip && dest_img.empty()) {
-		return flow_state();
-	}
-	
-	flow_state dest_state(dest_idx, dest_img, features_count);
-	if(max_pyramid_level > 0) {
-		dest_state.image_pyramid.clear();
-		cv::buildOpticalFlowPyramid(
-			dest_img,
-			dest_state.image_pyramid,
-			window_size,
-			max_pyramid_level
-		);
-	}
+
+/// Track features of `origin_state` into view `dest_idx`. Both pyramids must have been built for `window_size`.
+flow_state flow_to(const flow_state& origin_state, const view_index& dest_idx, const image_pyramid_ptr& dest_pyramid, const cv::Size& window_size) {
+	std::size_t features_count = origin_state.features_count();
+	const cv::Mat& dest_img = dest_pyramid->front();
+
+	flow_state dest_state;
+	dest_state.view_idx = dest_idx;
+	dest_state.pyramid = dest_pyramid;
+	dest_state.features = origin_state.features;
 
 	std::vector<cv::Point2f>& dest_positions = dest_state.feature_positions;
 	std::vector<uchar>& dest_status = dest_state.feature_status;
 	std::vector<float> dest_errs(features_count);
-	
-	cv::TermCriteria term(cv::TermCriteria::COUNT | cv::TermCriteria::EPS, 30, 0.01);
-	cv::calcOpticalFlowPyrLK(
-		origin_state.image_pyramid,
-		dest_state.image_pyramid,
-		origin_state.feature_positions,
-		dest_positions,
-		dest_status,
-		dest_errs,
-		window_size,
-		max_pyramid_level,
-		term
-	);
-	
+
+	Assert(window_size == optical_flow_tracker::window_size());
+	lk_tracker_parameters param;
+	param.max_level = max_pyramid_level;
+	optical_flow_tracker tracker(param);
+	optical_flow_tracker::origin orig = tracker.prepare(*origin_state.pyramid, origin_state.feature_positions);
+	tracker.track(orig, *dest_state.pyramid, dest_positions, dest_status, dest_errs);
+
 
 	auto position_ok = [&](const cv::Point2f& pos) -> bool {
 		return (pos.x > 0.0) && (pos.y > 0.0) && (pos.x < dest_img.cols) && (pos.y < dest_img.rows);
 	};
 
-	for(std::ptrdiff_t feature = 0; feature < features_count; ++feature) {	
+	for(std::ptrdiff_t feature = 0; feature < features_count; ++feature) {
 		bool status =
 			origin_state.feature_status[feature] &&
 			dest_status[feature] &&
@@ -169,161 +198,381 @@ flow_state flow_to(flow_state& origin_state, view_index dest_idx, const dataset_
 }
 
 
-void do_horizontal_optical_flow(correspondences_type& cors, const view_index& reference_idx, const flow_state& mid_x_state, const dataset_group& datag, bool verb = false) {
-	const dataset& datas = datag.set();
-	int x_min = std::max(datas.x_min(), reference_idx.x - horizontal_outreach);
-	int x_max = std::min(datas.x_max(), reference_idx.x + horizontal_outreach);
-
-	flow_state state = mid_x_state;
-	state.image_pyramid = { state.image_pyramid.front() }; // let flow_to() recalculate pyramid, because window size if different
-
-	if(verb) std::cout << "horizontal optical flow by increasing x starting at mid_x..." << std::endl;
-	for(int x = mid_x_state.view_idx.x + datas.x_step(); x <= x_max; x += datas.x_step()) {
-		view_index idx(x, mid_x_state.view_idx.y);
-		print_flow_indicator(state.view_idx, idx);
-		flow_state new_state = flow_to(state, idx, datag, horizontal_optical_flow_window_size, true);
-		if(new_state.is_valid()) {
-			add_correspondences(cors, new_state);
-			state = std::move(new_state);
-		}
-		if(state.valid_features_count() == 0) break;
+/// Features that join a flow chain at one of its views.
+struct flow_chain_origin {
+	std::ptrdiff_t position; // index of origin view in chain
+	std::ptrdiff_t end_position; // index of last view in chain to which the features get tracked
+	flow_state state;
+};
+
+/// Views on one line of the dataset, along which features of several origins are tracked in one direction.
+struct flow_chain {
+	std::vector<view_index> views;
+	std::vector<flow_chain_origin> origins;
+};
+
+
+/// Make chain through the views reached from `origin_states`, in direction `step` along x or y axis.
+/** Features get tracked up to `outreach` from their origin view, within `[limit_min, limit_max]`.
+ ** All origin states must be on the same line. */
+flow_chain make_flow_chain(const std::vector<flow_state>& origin_states, bool vertical, int step, int outreach, int limit_min, int limit_max) {
+	Assert(! origin_states.empty() && step != 0);
+	auto coord = [vertical](const view_index& idx) { return (vertical ? idx.y : idx.x); };
+	auto clamp = [&](int c) { return std::min(std::max(c, limit_min), limit_max); };
+	int direction = (step > 0 ? 1 : -1);
+
+	int first = coord(origin_states.front().view_idx);
+	for(const flow_state& st : origin_states)
+		if((coord(st.view_idx) - first) * direction < 0) first = coord(st.view_idx);
+	int last = first;
+	for(const flow_state& st : origin_states) {
+		int end = clamp(coord(st.view_idx) + direction * outreach);
+		if((end - last) * direction > 0) last = end;
+	}
+
+	flow_chain chain;
+	for(int c = first; (last - c) * direction >= 0; c += step) {
+		view_index idx = origin_states.front().view_idx;
+		if(vertical) idx.y = c;
+		else idx.x = c;
+		chain.views.push_back(idx);
+	}
+
+	for(const flow_state& st : origin_states) {
+		int c = coord(st.view_idx);
+		if((c - first) % step != 0) throw std::runtime_error("reference views must be on dataset grid");
+		flow_chain_origin origin;
+		origin.position = (c - first) / step;
+		origin.end_position = (clamp(c + direction * outreach) - first) / step;
+		origin.state = st;
+		chain.origins.push_back(std::move(origin));
 	}
-	
-	if(verb) std::cout << "\nhorizontal optical flow by decreasing x starting at mid_x..." << std::endl;
-	state = mid_x_state;
-	for(int x = mid_x_state.view_idx.x - datas.x_step(); x >= x_min; x -= datas.x_step()) {
-		view_index idx(x, mid_x_state.view_idx.y);
-		print_flow_indicator(state.view_idx, idx);
-		flow_state new_state = flow_to(state, idx, datag, horizontal_optical_flow_window_size, true);
-		if(new_state.is_valid()) {
-			add_correspondences(cors, new_state);
-			state = std::move(new_state);
+	std::stable_sort(chain.origins.begin(), chain.origins.end(), [](const flow_chain_origin& a, const flow_chain_origin& b) {
+		return (a.position < b.position);
+	});
+
+	return chain;
+}
+
+
+/// Track features of all origins along the chain, visiting each view once.
+/** Features of each origin join at its view, and are tracked together with the others until they get lost or reach their end
+ ** position. After each flow, `callback(state)` receives the valid tracked features on the new view, excluding those of origins
+ ** that join there. Then `progress_callback(position)` gets called for each position of the chain, in order, once the chain
+ ** is done with it. Views with missing image are skipped, unless `must_exist` (then it throws). */
+template<typename Callback, typename ProgressCallback>
+void do_flow_chain(const dataset_group& datag, const flow_chain& chain, const cv::Size& window_size, bool must_exist, Callback&& callback, ProgressCallback&& progress_callback, std::size_t read_ahead_window = 8, int read_ahead_threads = 2) {
+	flow_state state;
+	std::vector<std::ptrdiff_t> end_positions; // of each feature in state
+
+	std::ptrdiff_t done_position = 0;
+	auto done_until = [&](std::ptrdiff_t position) {
+		for(; done_position < position; ++done_position) progress_callback(done_position);
+	};
+
+	auto retire_features = [&](std::ptrdiff_t position) {
+		std::size_t count = 0;
+		for(std::ptrdiff_t i = 0; i < state.features_count(); ++i) {
+			if(end_positions[i] <= position) continue;
+			state.features[count] = state.features[i];
+			state.feature_positions[count] = state.feature_positions[i];
+			state.feature_status[count] = state.feature_status[i];
+			end_positions[count] = end_positions[i];
+			++count;
 		}
-		if(state.valid_features_count() == 0) break;
+		state.features.resize(count);
+		state.feature_positions.resize(count);
+		state.feature_status.resize(count);
+		end_positions.resize(count);
+	};
+
+	auto next_origin = chain.origins.cbegin();
+	while(next_origin != chain.origins.cend()) {
+		// state is empty here: skip views up to next origin
+		std::ptrdiff_t position = next_origin->position;
+		std::vector<view_index> views(chain.views.begin() + position, chain.views.end());
+		done_until(position);
+
+		pyramid_sweep(datag, views, window_size, must_exist, [&](const view_index& idx, const image_pyramid_ptr& pyramid) {
+			if(state.features_count() > 0) {
+				print_flow_indicator(state.view_idx, idx);
+				if(pyramid) {
+					std::vector<std::ptrdiff_t> old_end_positions = std::move(end_positions);
+					flow_state new_state = flow_to(state, idx, pyramid, window_size);
+					end_positions.clear();
+					for(std::ptrdiff_t i = 0; i < new_state.features_count(); ++i)
+						if(new_state.feature_status[i]) end_positions.push_back(old_end_positions[i]);
+					new_state.remove_invalid_features();
+					state = std::move(new_state);
+					callback(state);
+				}
+				retire_features(position);
+			}
+
+			for(; next_origin != chain.origins.cend() && next_origin->position == position; ++next_origin) {
+				if(next_origin->end_position <= position) continue;
+				if(! pyramid) throw std::runtime_error("image for " + encode_view_index(idx) + " must exist, but does not");
+				if(state.features_count() == 0) {
+					state.view_idx = idx;
+					state.pyramid = pyramid;
+				}
+				Assert(state.view_idx == idx);
+				state.append(next_origin->state);
+				end_positions.resize(state.features_count(), next_origin->end_position);
+			}
+
+			++position;
+			done_until(position);
+			return (state.features_count() > 0);
+		}, read_ahead_window, read_ahead_threads);
 	}
+	done_until(chain.views.size());
 }
 
 
-correspondences_type do_2d_optical_flow(const dataset_group& datag, const view_index& reference_idx, const std::vector<vec2>& reference_points) {
+/// Schedules the vertical and horizontal flow chains as OpenMP tasks, following their dependencies.
+/** All vertical chains run concurrently. The horizontal chains of a row start as soon as all vertical chains that cross the row
+ ** have passed it, because only then its origins are complete. Idle threads take the next ready chain from the task pool.
+ ** Each correspondence is found by only one chain, so the chains write them into `cors` without locking. */
+class flow_scheduler {
+private:
+	struct flow_row {
+		std::mutex mutex;
+		std::map<view_index, flow_state> origins;
+		int pending_vertical_chains = 0;
+	};
+
+	const dataset_group& datag_;
+	dense_image_correspondences& cors_;
+	std::vector<flow_chain> vertical_chains_;
+	std::map<int, flow_row> rows_;
+
+	std::mutex mutex_;
+	std::size_t horizontal_chains_count_ = 0;
+	std::size_t horizontal_chains_done_ = 0;
+	std::exception_ptr error_;
+
+	void add_origin_(const flow_state&);
+	void set_error_();
+	void vertical_chain_passed_(const view_index&);
+	void spawn_horizontal_chains_(flow_row&);
+	void run_vertical_chain_(const flow_chain&);
+	void run_horizontal_chain_(flow_row&, int direction);
+
+public:
+	flow_scheduler(const dataset_group&, dense_image_correspondences& cors, const std::vector<flow_state>& reference_states);
+
+	void run();
+};
+
+
+flow_scheduler::flow_scheduler(const dataset_group& datag, dense_image_correspondences& cors, const std::vector<flow_state>& reference_states) :
+	datag_(datag),
+	cors_(cors)
+{
 	const dataset& datas = datag.set();
-	int y_min = std::max(datas.y_min(), reference_idx.y - vertical_outreach);
-	int y_max = std::min(datas.y_max(), reference_idx.y + vertical_outreach);
-
-	cv::Mat_<uchar> center_image = load_image(datag, reference_idx, true);
-	
-	std::vector<cv::Point2f> center_positions = vec2_to_point2f(reference_points);
-	std::size_t features_count = center_positions.size();
-
-	flow_state center_state(reference_idx, center_image, features_count);
-	center_state.feature_positions = center_positions;
-	center_state.feature_status.assign(features_count, 1);
-	
-	correspondences_type cors;
-	add_correspondences(cors, center_state);
-	
+	for(const flow_state& state : reference_states) {
+		rows_[state.view_idx.y];
+		add_correspondences(cors_, state);
+		add_origin_(state);
+	}
+
 	if(datas.is_2d()) {
 		// 2D MODE
-		std::vector<flow_state> vertical_origins;		
-		vertical_origins.push_back(center_state);
-		
-		std::cout << "vertical optical flow by increasing y starting at mid_y..." << std::endl;
-		flow_state state = center_state;
-		for(int y = reference_idx.y + datas.y_step(); y <= y_max; y += datas.y_step()) {
-			view_index idx(reference_idx.x, y);
-			print_flow_indicator(state.view_idx, idx);
-			flow_state new_state = flow_to(state, idx, datag, vertical_optical_flow_window_size, false);
-			add_correspondences(cors, new_state);
-			vertical_origins.push_back(new_state);
-			state = std::move(new_state);
-			if(state.valid_features_count() == 0) break;
+		std::map<int, std::vector<flow_state>> columns;
+		for(const flow_state& state : reference_states) columns[state.view_idx.x].push_back(state);
+
+		for(const auto& kv : columns) {
+			const std::vector<flow_state>& column_states = kv.second;
+			vertical_chains_.push_back(make_flow_chain(column_states, true, datas.y_step(), vertical_outreach, datas.y_min(), datas.y_max()));
+			vertical_chains_.push_back(make_flow_chain(column_states, true, -datas.y_step(), vertical_outreach, datas.y_min(), datas.y_max()));
 		}
-		
-		
-		std::cout << "\nvertical optical flow by decreasing y starting at mid_y..." << std::endl;
-		state = center_state;	
-		for(int y = reference_idx.y - datas.y_step(); y >= y_min; y -= datas.y_step()) {
-			view_index idx(reference_idx.x, y);
-			print_flow_indicator(state.view_idx, idx);
-			flow_state new_state = flow_to(state, idx, datag, vertical_optical_flow_window_size, false);
-			add_correspondences(cors, new_state);
-			vertical_origins.push_back(new_state);
-			state = std::move(new_state);
-			if(state.valid_features_count() == 0) break;
+		for(const flow_chain& chain : vertical_chains_)
+			for(const view_index& idx : chain.views) ++rows_[idx.y].pending_vertical_chains;
+	}
+
+	horizontal_chains_count_ = 2 * rows_.size();
+}
+
+
+void flow_scheduler::add_origin_(const flow_state& state) {
+	flow_row& row = rows_.at(state.view_idx.y);
+	std::lock_guard<std::mutex> lock(row.mutex);
+	flow_state& origin = row.origins[state.view_idx];
+	origin.view_idx = state.view_idx;
+	origin.append(state);
+}
+
+
+void flow_scheduler::set_error_() {
+	std::lock_guard<std::mutex> lock(mutex_);
+	if(! error_) error_ = std::current_exception();
+}
+
+
+void flow_scheduler::vertical_chain_passed_(const view_index& idx) {
+	flow_row& row = rows_.at(idx.y);
+	bool ready;
+	{
+		std::lock_guard<std::mutex> lock(row.mutex);
+		ready = (--row.pending_vertical_chains == 0);
+	}
+	if(ready) spawn_horizontal_chains_(row);
+}
+
+
+void flow_scheduler::spawn_horizontal_chains_(flow_row& row) {
+	flow_scheduler* self = this;
+	flow_row* row_ptr = &row;
+	for(int direction : { +1, -1 }) {
+		#pragma omp task firstprivate(self, row_ptr, direction)
+		self->run_horizontal_chain_(*row_ptr, direction);
+	}
+}
+
+
+void flow_scheduler::run_vertical_chain_(const flow_chain& chain) {
+	try {
+		do_flow_chain(datag_, chain, vertical_optical_flow_window_size, true, [&](const flow_state& state) {
+			add_correspondences(cors_, state);
+			add_origin_(state);
+		}, [&](std::ptrdiff_t position) {
+			vertical_chain_passed_(chain.views[position]);
+		});
+	} catch(...) {
+		set_error_();
+	}
+}
+
+
+void flow_scheduler::run_horizontal_chain_(flow_row& row, int direction) {
+	// origins of row are complete and no longer modified when this runs
+	const dataset& datas = datag_.set();
+	std::vector<flow_state> origin_states;
+	for(const auto& kv : row.origins) origin_states.push_back(kv.second);
+
+	try {
+		if(! origin_states.empty()) {
+			// horizontal flows are run in parallel, so use only one read-ahead thread per chain
+			flow_chain chain = make_flow_chain(origin_states, false, direction * datas.x_step(), horizontal_outreach, datas.x_min(), datas.x_max());
+			do_flow_chain(datag_, chain, horizontal_optical_flow_window_size, false, [&](const flow_state& state) {
+				add_correspondences(cors_, state);
+			}, [](std::ptrdiff_t) { }, horizontal_read_ahead_window, 1);
 		}
+	} catch(...) {
+		set_error_();
+	}
 
-		std::cout << "\nnow doing horizontal flows..." << std::endl;
-		int done = 0;
-		#pragma omp parallel for
-		for(std::ptrdiff_t i = 0; i < vertical_origins.size(); i++) {
-			correspondences_type hcors;
-			
-			const flow_state& origin_state = vertical_origins[i];
-			do_horizontal_optical_flow(hcors, reference_idx, origin_state, datag);
-									
-			#pragma omp critical
-			{
-				++done;
-				std::cout << '\n' << done << " of " << vertical_origins.size() << std::endl;
-				
-				cors.insert(hcors.begin(), hcors.end());
-			}
+	std::lock_guard<std::mutex> lock(mutex_);
+	++horizontal_chains_done_;
+	std::cout << '\n' << horizontal_chains_done_ << " of " << horizontal_chains_count_ << std::endl;
+}
+
+
+void flow_scheduler::run() {
+	#pragma omp parallel
+	#pragma omp single
+	{
+		// rows not crossed by vertical chains (all rows in 1D mode)
+		for(auto& kv : rows_)
+			if(kv.second.pending_vertical_chains == 0) spawn_horizontal_chains_(kv.second);
+		for(const flow_chain& chain : vertical_chains_) {
+			const flow_chain* chain_ptr = &chain;
+			flow_scheduler* self = this;
+			#pragma omp task firstprivate(self, chain_ptr)
+			self->run_vertical_chain_(*chain_ptr);
 		}
+	}
+
+	if(error_) std::rethrow_exception(error_);
+}
 
 
-	} else {
-		// 1D MODE
-	
-		do_horizontal_optical_flow(cors, reference_idx, center_state, datag, true);
+/// Track features of all references, first vertically and then horizontally.
+/** References on the same dataset column share their vertical flows, and features on the same row share their
+ ** horizontal flows. So each view is visited by a small number of flow chains, regardless of the number of references. */
+void do_2d_optical_flow(const dataset_group& datag, const std::vector<flow_reference>& references, dense_image_correspondences& cors) {
+	std::vector<flow_state> reference_states;
+	for(const flow_reference& ref : references) {
+		flow_state state;
+		state.view_idx = ref.view_idx;
+		state.feature_positions = vec2_to_point2f(ref.positions);
+		for(std::ptrdiff_t i = 0; i < ref.positions.size(); ++i) state.features.push_back(ref.first_feature + i);
+		state.feature_status.assign(ref.positions.size(), 1);
+		reference_states.push_back(std::move(state));
 	}
 
-	return cors;
+	std::cout << "doing vertical and horizontal optical flows..." << std::endl;
+	flow_scheduler scheduler(datag, cors, reference_states);
+	scheduler.run();
 }
 
 
 int main(int argc, const char* argv[]) {
-	get_args(argc, argv, "dataset_parameters.json reference_fpoints.json horiz_outreach vert_outreach out_cors.json [dataset_group]");
+	get_args(argc, argv, "dataset_parameters.json reference_fpoints.json/refgrid.json horiz_outreach vert_outreach out_cors.json [dataset_group] [fpoints_dir/]");
 	dataset datas = dataset_arg();
-	feature_points reference_fpoints = feature_points_arg();
+	std::string references_filename = in_filename_arg();
 	horizontal_outreach = int_arg();
 	vertical_outreach = int_arg();
 	std::string out_cors_filename = out_filename_arg();
 	std::string dataset_group_name = string_opt_arg("");
+	std::string fpoints_dirname = string_opt_arg(filename_parent(references_filename));
 
 	dataset_group datag = datas.group(dataset_group_name);
 
-	view_index reference_idx = reference_fpoints.view_idx;
+	std::vector<feature_points> references_fpoints;
+	json j_references = import_json_file(references_filename);
+	if(j_references.count("x_indices") == 1) {
+		references_grid grid = decode_references_grid(j_references);
+		std::cout << "loading reference points of " << grid.size() << " reference views" << std::endl;
+		for(std::ptrdiff_t col = 0; col < grid.cols(); ++col)
+		for(std::ptrdiff_t row = 0; row < grid.rows(); ++row) {
+			std::string fpoints_filename = filename_append(fpoints_dirname, "fpoints_" + encode_view_index(grid.view(col, row)) + ".json");
+			references_fpoints.push_back(import_feature_points(fpoints_filename));
+		}
+	} else {
+		std::cout << "loading reference points" << std::endl;
+		references_fpoints.push_back(decode_feature_points(j_references));
+	}
 
-	std::cout << "loading reference points" << std::endl;
-	std::vector<vec2> reference_feature_points;
-	std::map<local_feature_index, std::string> feature_names;
-	for(const auto& kv : reference_fpoints.points) {
-		const std::string& feature_name = kv.first;
-		const feature_point& fpoint = kv.second;
-		feature_names[reference_feature_points.size()] = feature_name;
-		reference_feature_points.push_back(fpoint.position);
+	std::vector<flow_reference> references;
+	std::vector<std::string> feature_names;
+	std::vector<view_index> feature_reference_views;
+	std::map<std::string, view_index> feature_names_set;
+	for(const feature_points& fpoints : references_fpoints) {
+		flow_reference ref;
+		ref.view_idx = fpoints.view_idx;
+		ref.first_feature = feature_names.size();
+		for(const auto& kv : fpoints.points) {
+			const std::string& feature_name = kv.first;
+			const feature_point& fpoint = kv.second;
+			auto inserted = feature_names_set.emplace(feature_name, fpoints.view_idx);
+			if(! inserted.second) {
+				// feature already tracked from same reference view gets tracked only once, like in merge_cors
+				if(inserted.first->second != fpoints.view_idx)
+					throw std::runtime_error("same name features with different reference views");
+				continue;
+			}
+			feature_names.push_back(feature_name);
+			feature_reference_views.push_back(fpoints.view_idx);
+			ref.positions.push_back(fpoint.position);
+		}
+		references.push_back(std::move(ref));
 	}
-	
-	
-	std::cout << "doing optical flow from reference view " << reference_idx << std::endl;
-	correspondences_type cors = do_2d_optical_flow(datag, reference_idx, reference_feature_points);
-	
+
+
+	if(references.size() == 1) std::cout << "doing optical flow from reference view " << references.front().view_idx << std::endl;
+	else std::cout << "doing optical flow from " << references.size() << " reference views" << std::endl;
+	dense_image_correspondences cors(datas, dataset_group_name, feature_names, feature_reference_views, horizontal_outreach, vertical_outreach);
+	do_2d_optical_flow(datag, references, cors);
+
 
 	std::cout << "\nsaving image correspondences" << std::endl;
-	image_correspondences out_cors;
-	out_cors.dataset_group = dataset_group_name;
-	for(const auto& kv : cors) {
-		const local_feature_index& local_feature_idx = kv.first.first;
-		const view_index& idx = kv.first.second;
-		const vec2& position = kv.second;
-		
-		std::string& feature_name = feature_names[local_feature_idx];
-		
-		image_correspondence_feature& feature = out_cors.features[feature_name];
-		feature.reference_view = reference_idx;
-		feature.points[idx].position = position;
-	}
-	export_image_corresponcences(out_cors, out_cors_filename);
-	
+	export_dense_image_correspondences(cors, out_cors_filename);
+
+	const image_cache& cache = datas.cache();
+	std::cout << "image cache: " << cache.hits() << " hits, " << cache.misses() << " misses" << std::endl;
+	std::cout << "pyramid cache: " << pyramids.hits() << " hits, " << pyramids.misses() << " misses" << std::endl;
+
 	std::cout << "done" << std::endl;
 }
-
@@ -93,7 +93,7 @@ int main(int argc, const char* argv[]) {
 		
 		std::string filename = datag.view(idx).image_filename();
 		try {
-			cv::Mat_<cv::Vec3b> img = load_texture(filename);
+			cv::Mat_<cv::Vec3b> img = datag.view(idx).load_texture().clone();
 			std::vector<cv::Point2f> features = choose_features(img);
 			for(cv::Point2f pt : features) {
 				cv_aa_circle(img, pt, 7, cv::Scalar(cv::Vec3b(255, 255, 255)), 3);
@@ -112,8 +112,7 @@ int main(int argc, const char* argv[]) {
 
 	auto export_fpoints = [&](view_index idx, int global_index_base = 0) {
 		int number = 0;
-		std::string img_filename = datag.view(idx).image_filename();
-		cv::Mat_<cv::Vec3b> img = load_texture(img_filename);
+		cv::Mat_<cv::Vec3b> img = datag.view(idx).load_texture();
 		std::vector<cv::Point2f> features = choose_features(img);
 		feature_points fpoints;
 		fpoints.view_idx = idx;
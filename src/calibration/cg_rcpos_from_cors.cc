@@ -6,7 +6,9 @@
 #include "../lib/misc.h"
 #include "../lib/assert.h"
 #include "lib/feature_points.h"
+#include "lib/feature_points_index.h"
 #include "lib/image_correspondence.h"
+#include "lib/flat_image_correspondences.h"
 #include "lib/cg/relative_camera_positions.h"
 #include "lib/cg/straight_depths.h"
 #include <map>
@@ -64,7 +66,7 @@ target_camera_position_result compute_target_camera_position(const std::map<std:
 int main(int argc, const char* argv[]) {
 	get_args(argc, argv, "dataset_parameters.json cors.json intr.json R.json straight_depths.json out_rcpos.json [out_sample_positions.txt] [out_final_positions.txt]");
 	dataset datas = dataset_arg();
-	image_correspondences cors = image_correspondences_arg();
+	flat_image_correspondences cors = flat_image_correspondences_arg();
 	intrinsics intr = intrinsics_arg();
 	mat33 R = decode_mat(json_arg());
 	straight_depths depths = straight_depths_arg();
@@ -87,11 +89,11 @@ int main(int argc, const char* argv[]) {
 	auto get_target_camera_position_samples = [&](
 		const view_index& target_idx,
 		const view_index& ref_idx,
-		const image_correspondences& ref_cors,
+		const feature_points_index& ref_cors_index,
 		const feature_points& ref_fpoints
 	) -> target_camera_position_samples
 	{
-		feature_points target_fpoints = feature_points_for_view(ref_cors, target_idx, false);
+		feature_points target_fpoints = feature_points_for_view(ref_cors_index, target_idx, false);
 	
 		target_camera_position_samples samples;
 						
@@ -140,11 +142,12 @@ int main(int argc, const char* argv[]) {
 			#pragma omp critical
 			std::cout << "   reference view " << ref_idx << std::endl;
 			
-			image_correspondences ref_cors = image_correspondences_with_reference(cors, ref_idx);
-			feature_points ref_fpoints = feature_points_for_view(ref_cors, ref_idx, false);
+			flat_image_correspondences ref_cors = image_correspondences_with_reference(cors, ref_idx);
+			feature_points_index ref_cors_index(ref_cors);
+			feature_points ref_fpoints = feature_points_for_view(ref_cors_index, ref_idx, false);
 			for(const view_index& target_idx : all_vws) {			
 				if(target_idx == ref_idx) continue;
-				target_camera_position_samples samples = get_target_camera_position_samples(target_idx, ref_idx, ref_cors, ref_fpoints);
+				target_camera_position_samples samples = get_target_camera_position_samples(target_idx, ref_idx, ref_cors_index, ref_fpoints);
 				vec2 mean = 0.0;
 				for(const auto& kv : samples) mean += kv.second;
 				mean /= real(samples.size());
@@ -211,8 +214,9 @@ int main(int argc, const char* argv[]) {
 			
 	//if(ref_idx != ref2) continue;
 		
-		image_correspondences ref_cors = image_correspondences_with_reference(cors, ref_idx);
-		feature_points ref_fpoints = feature_points_for_view(ref_cors, ref_idx, false);
+		flat_image_correspondences ref_cors = image_correspondences_with_reference(cors, ref_idx);
+		feature_points_index ref_cors_index(ref_cors);
+		feature_points ref_fpoints = feature_points_for_view(ref_cors_index, ref_idx, false);
 
 		std::map<view_index, vec2> relative_camera_positions;
 
@@ -225,7 +229,7 @@ int main(int argc, const char* argv[]) {
 				final_pos.variance = 0.0;
 				
 			} else {
-				samples = get_target_camera_position_samples(target_idx, ref_idx, ref_cors, ref_fpoints);
+				samples = get_target_camera_position_samples(target_idx, ref_idx, ref_cors_index, ref_fpoints);
 				if(find_bad_features)
 					for(const std::string& shrt_bad_feature_name : bad_features) samples.erase(shrt_bad_feature_name);
 			
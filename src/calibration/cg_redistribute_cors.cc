@@ -8,6 +8,7 @@
 #include "../lib/misc.h"
 #include "lib/image_correspondence.h"
 #include "lib/feature_points.h"
+#include "lib/feature_points_index.h"
 #include "lib/cg/references_grid.h"
 
 using namespace tlz;
@@ -32,10 +33,11 @@ int main(int argc, const char* argv[]) {
 		}
 	}
 	
+	feature_points_index cors_index(cors);
 	for(std::ptrdiff_t col = 0; col < pseudo_refgrid.cols(); ++col)
 	for(std::ptrdiff_t row = 0; row < pseudo_refgrid.rows(); ++row) {
 		view_index idx = pseudo_refgrid.view(col, row);
-		if(feature_points_for_view(cors, idx).count() == 0) {
+		if(cors_index.count(idx) == 0) {
 			std::cout << "no features for pseudo reference view " << idx << std::endl;
 			return 0;
 		}
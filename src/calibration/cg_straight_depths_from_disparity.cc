@@ -5,6 +5,7 @@
 #include <algorithm>
 #include <map>
 #include "lib/image_correspondence.h"
+#include "lib/flat_image_correspondences.h"
 #include "lib/feature_points.h"
 #include "lib/cg/straight_depths.h"
 #include "../lib/args.h"
@@ -25,34 +26,43 @@ constexpr int min_position_pairs_count = 300;
 constexpr real max_relative_scale_error = 0.3;
 constexpr bool make_visualizations = false;
 
-using view_feature_positions = std::map<view_index, vec2>;
-
 using view_feature_position_pair = std::pair<vec2, vec2>;
-using view_feature_position_pairs = std::map<view_index, view_feature_position_pair>;
+using view_feature_position_pairs = std::vector<std::pair<view_index, view_feature_position_pair>>; // sorted by view
 
 
 view_feature_position_pairs common_view_feature_positions(
-	const view_feature_positions& views1, const view_feature_positions& views2
+	const flat_image_correspondences& cors, const std::vector<vec2>& positions,
+	flat_image_correspondences::feature_id feature1, flat_image_correspondences::feature_id feature2
 ) {
 	view_feature_position_pairs out_pairwise;
-	auto it1 = views1.begin();
-	auto it2 = views2.begin();
-	while(it1 != views1.end() && it2 != views2.end()) {
-		if(it1->first < it2->first) {
-			++it1;
-		} else if(it2->first < it1->first) {
-			++it2;
+	std::ptrdiff_t p1 = cors.feature_begin(feature1), end1 = cors.feature_end(feature1);
+	std::ptrdiff_t p2 = cors.feature_begin(feature2), end2 = cors.feature_end(feature2);
+	while(p1 != end1 && p2 != end2) {
+		const view_index& idx1 = cors.views[p1];
+		const view_index& idx2 = cors.views[p2];
+		if(idx1 < idx2) {
+			++p1;
+		} else if(idx2 < idx1) {
+			++p2;
 		} else {
-			const view_index& idx = it1->first;			
-			out_pairwise.emplace(idx, view_feature_position_pair(it1->second, it2->second));
-			++it1;
-			++it2;
+			out_pairwise.emplace_back(idx1, view_feature_position_pair(positions[p1], positions[p2]));
+			++p1;
+			++p2;
 		} 
 	}
 	return out_pairwise;
 }
 
 
+const view_feature_position_pair& view_feature_position_pair_at(const view_feature_position_pairs& pairs, const view_index& idx) {
+	auto it = std::lower_bound(pairs.begin(), pairs.end(), idx, [](const auto& kv, const view_index& idx) {
+		return (kv.first < idx);
+	});
+	if(it == pairs.end() || it->first != idx) throw std::out_of_range("no position pair for view");
+	return it->second;
+}
+
+
 
 struct estimate_relative_scale_result {
 	real scale = NAN;
@@ -75,8 +85,9 @@ estimate_relative_scale_result estimate_relative_scale(
 	
 	if(center_view) {
 		// center on center_view, and solve for scale only
-		vec2 src_center_position = src_tg_positions.at(center_view).first;
-		vec2 tg_center_position = src_tg_positions.at(center_view).second;
+		const view_feature_position_pair& center_pair = view_feature_position_pair_at(src_tg_positions, center_view);
+		vec2 src_center_position = center_pair.first;
+		vec2 tg_center_position = center_pair.second;
 		
 		real scales_sum = 0, scales_weights_sum = 0;
 		for(const auto& kv : src_tg_positions) {
@@ -243,7 +254,7 @@ Eigen_vecX complete_depths(const Eigen_vecX& known_depths, const Eigen_vecX& glo
 
 int main(int argc, const char* argv[]) {
 	get_args(argc, argv, "image_correspondences.json intrinsics.json R.json straight_depths.json out_straight_depths.json");
-	image_correspondences cors = image_correspondences_arg();
+	flat_image_correspondences cors = flat_image_correspondences_arg();
 	intrinsics intr = intrinsics_arg();
 	mat33 R = decode_mat(json_arg());
 	straight_depths in_depths = straight_depths_arg();
@@ -257,8 +268,7 @@ int main(int argc, const char* argv[]) {
 
 	mat33 unrotate = intr.K * R.t() * intr.K_inv;
 
-	auto all_views = get_all_views(cors);
-	auto all_features = get_feature_names(cors);
+	const std::vector<std::string>& all_features = cors.feature_names;
 
 	std::size_t features_count = all_features.size();
 	//features_count = 20;
@@ -271,20 +281,12 @@ int main(int argc, const char* argv[]) {
 	// undistort & unrotate correspondences, and get view feature positions foreach feature
 	// all_view_feature_xy = points in normalized view spaces (v_z = 1)
 	std::cout << "undistorting correspondences" << std::endl;
-	image_correspondences undist_cors = undistort(cors, intr);	
+	flat_image_correspondences undist_cors = undistort(cors, intr);	
 	std::cout << "collecting unrotated view feature positions" << std::endl;
-	std::map<std::string, view_feature_positions> all_view_feature_xy;
-	for(const auto& kv : undist_cors.features) {
-		const std::string& feature_name = kv.first;
-		const image_correspondence_feature& feature = kv.second;
-		view_feature_positions positions;
-		for(const auto& kv2 : feature.points) {
-			const view_index& idx = kv2.first;
-			const feature_point& fpoint = kv2.second;
-			vec2 unrotated_xy = mul_h(unrotate, fpoint.position);
-			all_view_feature_xy[feature_name][idx] = unrotated_xy;
-		}
-	}
+	std::vector<vec2> all_view_feature_xy(undist_cors.points_count()); // indexed like points in cors
+	#pragma omp parallel for
+	for(std::ptrdiff_t p = 0; p < undist_cors.points_count(); ++p)
+		all_view_feature_xy[p] = mul_h(unrotate, undist_cors.position(p));
 
 	// calculate relative scale ratio for all feature pairs, using the image correspondences	
 	Eigen_matXX scale_ratios(features_count, features_count);
@@ -298,19 +300,14 @@ int main(int argc, const char* argv[]) {
 	for(int ref = 0; ref < features_count; ++ref) for(int tg = ref+1; tg < features_count; ++tg) {
 		// get feature position pairs for source and target feature
 		// for views on which both features are present
-		const std::string& src_feature_name = all_features.at(ref);
-		const view_feature_positions& src_positions = all_view_feature_xy.at(src_feature_name);
-		const std::string& tg_feature_name = all_features.at(tg);
-		const view_feature_positions& tg_positions = all_view_feature_xy.at(tg_feature_name);
-		
-		auto src_tg_position_pairs = common_view_feature_positions(src_positions, tg_positions);
+		auto src_tg_position_pairs = common_view_feature_positions(undist_cors, all_view_feature_xy, ref, tg);
 		if(src_tg_position_pairs.size() < min_position_pairs_count) continue;
 		
 		
 		// estimate scale of target view feature positions, relative to corresponding reference view features
 		estimate_relative_scale_result result;
-		view_index src_reference = cors.features.at(src_feature_name).reference_view;
-		view_index tg_reference = cors.features.at(tg_feature_name).reference_view;
+		view_index src_reference = cors.reference_views[ref];
+		view_index tg_reference = cors.reference_views[tg];
 		if(src_reference == tg_reference) result = estimate_relative_scale(src_tg_position_pairs, src_reference);
 		else result = estimate_relative_scale(src_tg_position_pairs);
 		if(! result) continue;
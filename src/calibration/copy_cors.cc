@@ -4,14 +4,27 @@
 #include <cstdlib>
 #include <stdexcept>
 #include "../lib/args.h"
+#include "../lib/string.h"
 #include "lib/image_correspondence.h"
+#include "lib/binary_image_correspondences.h"
 
 using namespace tlz;
 
 int main(int argc, const char* argv[]) {
 	get_args(argc, argv, "in_cors.json out_cors.json");
-	image_correspondences cors = image_correspondences_arg();
+	std::string in_cors_filename = in_filename_arg();
 	std::string out_cors_filename = out_filename_arg();
+	
+	if(is_binary_image_correspondences_v2(in_cors_filename) && file_name_extension(out_cors_filename) == "bin") {
+		std::cout << "copying binary image correspondences" << std::endl;
+		mapped_image_correspondences mcors(in_cors_filename);
+		std::ofstream output(out_cors_filename, std::ios_base::binary);
+		output.write(reinterpret_cast<const std::ofstream::char_type*>(mcors.raw_data()), mcors.raw_size());
+		return EXIT_SUCCESS;
+	}
+	
+	std::cout << "loading image correspondences" << std::endl;
+	image_correspondences cors = import_image_correspondences(in_cors_filename);
 	export_image_corresponcences(cors, out_cors_filename);
 }
 
@@ -2,15 +2,69 @@
 #include "../lib/dataset.h"
 #include "lib/image_correspondence.h"
 #include "lib/feature_points.h"
+#include "lib/binary_image_correspondences.h"
+#include "lib/feature_points_index.h"
 #include <iostream>
 #include <atomic>
+#include <cstdlib>
+#include <map>
+#include <vector>
 
 using namespace tlz;
 
+const int view_feature_counts_hist_max = 10;
+
+void print_view_feature_counts_hist(const std::vector<std::atomic<int>>& view_feature_counts_hist) {
+	std::cout << "features per view:" << std::endl;
+	for(int count = 0; count <= view_feature_counts_hist_max; ++count) {
+		std::cout << count << " features: " << view_feature_counts_hist[count] << " views" << std::endl;
+	}
+	std::cout << "more features: " << view_feature_counts_hist[view_feature_counts_hist_max+1] << " views" << std::endl;
+}
+
+
+void mapped_cors_info(const dataset& datas, const mapped_image_correspondences& mcors) {
+	// binary v2 file: read directly from the mapped feature table and view index
+	std::map<view_index, std::vector<std::ptrdiff_t>> ref_features;
+	for(std::ptrdiff_t feature = 0; feature < mcors.features_count(); ++feature)
+		ref_features[mcors.feature_reference_view(feature)].push_back(feature);
+
+	std::cout << ref_features.size() << " reference views:\n";
+	for(const auto& kv : ref_features) std::cout << "    " << kv.first << "\n";
+	std::cout << mcors.features_count() << " features total\n";
+	std::cout << "dataset group: " << mcors.dataset_group() << "\n";
+	for(const auto& kv : ref_features) {
+		std::cout << "\nreference " << kv.first << ":\n";
+		std::cout << "    " << kv.second.size() << " features\n";
+		for(std::ptrdiff_t feature : kv.second)
+			std::cout << "    " << mcors.feature_name_c_str(feature) << ": " << mcors.feature_points(feature).size() << " views\n";
+	}
+	
+	auto all_views = datas.indices();
+	std::vector<std::atomic<int>> view_feature_counts_hist(view_feature_counts_hist_max+2);
+	for(const view_index& idx : all_views) {
+		int count = mcors.view_points(idx).size();
+		if(count > view_feature_counts_hist_max)
+			view_feature_counts_hist[view_feature_counts_hist_max+1]++;
+		else
+			view_feature_counts_hist[count]++;
+	}
+	print_view_feature_counts_hist(view_feature_counts_hist);
+}
+
+
 int main(int argc, const char* argv[]) {
 	get_args(argc, argv, "dataset_parameters.json cors.json");
 	dataset datas = dataset_arg();
-	image_correspondences cors = image_correspondences_arg();
+	std::string cors_filename = in_filename_arg();
+	
+	if(is_binary_image_correspondences_v2(cors_filename)) {
+		mapped_cors_info(datas, mapped_image_correspondences(cors_filename));
+		return EXIT_SUCCESS;
+	}
+	
+	std::cout << "loading image correspondences" << std::endl;
+	image_correspondences cors = import_image_correspondences(cors_filename);
 	
 	auto refs = get_reference_views(cors);
 	std::cout << refs.size() << " reference views:\n";
@@ -26,21 +80,16 @@ int main(int argc, const char* argv[]) {
 	}
 	
 	auto all_views = datas.indices();
-	const int view_feature_counts_hist_max = 10;
+	feature_points_index cors_index(cors);
 	std::vector<std::atomic<int>> view_feature_counts_hist(view_feature_counts_hist_max+2);
 	#pragma omp parallel for
 	for(std::ptrdiff_t i = 0; i < all_views.size(); ++i) {
 		const view_index& idx = all_views[i];
-		auto fpoints = feature_points_for_view(cors, idx);
-		int count = fpoints.points.size();
+		int count = cors_index.count(idx);
 		if(count > view_feature_counts_hist_max)
 			view_feature_counts_hist[view_feature_counts_hist_max+1]++;
 		else
 			view_feature_counts_hist[count]++;
 	}
-	std::cout << "features per view:" << std::endl;
-	for(int count = 0; count <= view_feature_counts_hist_max; ++count) {
-		std::cout << count << " features: " << view_feature_counts_hist[count] << " views" << std::endl;
-	}
-	std::cout << "more features: " << view_feature_counts_hist[view_feature_counts_hist_max+1] << " views" << std::endl;
+	print_view_feature_counts_hist(view_feature_counts_hist);
 }
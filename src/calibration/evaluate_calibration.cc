@@ -5,6 +5,7 @@
 #include "../lib/misc.h"
 #include "lib/image_correspondence.h"
 #include "lib/feature_points.h"
+#include "lib/feature_points_index.h"
 #include <iostream>
 #include <cmath>
 #include <random>
@@ -26,6 +27,7 @@ int main(int argc, const char* argv[]) {
 	int random_count = int_opt_arg(10000);
 	
 	auto cams_map = cameras_map(cams);
+	feature_points_index cors_index(cors);
 	
 	std::ofstream out_samples_stream(out_samples_filename);
 	out_samples_stream << "baseline reprojection_error\n";
@@ -41,8 +43,8 @@ int main(int argc, const char* argv[]) {
 		intrinsics to_intr = to_undistorted_intrinsics(to_cam, datas.image_width(), datas.image_height());
 		mat44 pose_transformation = to_cam.extrinsic() * from_cam.extrinsic_inv();
 		
-		const feature_points& from_fpoints = undistorted_feature_points_for_view(cors, from, from_intr);
-		const feature_points& to_fpoints = undistorted_feature_points_for_view(cors, to, to_intr);
+		const feature_points& from_fpoints = undistorted_feature_points_for_view(cors_index, from, from_intr);
+		const feature_points& to_fpoints = undistorted_feature_points_for_view(cors_index, to, to_intr);
 		std::vector<std::string> common_features;
 		for(const auto& kv : from_fpoints.points) {
 			const std::string& feature_name = kv.first;
@@ -0,0 +1,262 @@
+#include "binary_image_correspondences.h"
+#include "image_correspondence.h"
+#include "../../lib/assert.h"
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+
+namespace tlz {
+
+namespace {
+	const std::int32_t binary_cors_v2_magic_ = 0x2D1111C2;
+	const std::int32_t binary_cors_v2_version_ = 2;
+
+	static_assert(sizeof(binary_cors_header) == 88, "unexpected binary_cors_header layout");
+	static_assert(sizeof(binary_cors_feature) == 32, "unexpected binary_cors_feature layout");
+	static_assert(sizeof(binary_cors_point) == 40, "unexpected binary_cors_point layout");
+	static_assert(sizeof(binary_cors_view) == 24, "unexpected binary_cors_view layout");
+	static_assert(sizeof(binary_cors_view_point) == 16, "unexpected binary_cors_view_point layout");
+
+	std::uint64_t aligned_offset_(std::uint64_t offset) {
+		return (offset + 7) & ~std::uint64_t(7);
+	}
+
+	bool view_less_(const binary_cors_point& a, const binary_cors_point& b) {
+		return (a.view() < b.view());
+	}
+}
+
+
+feature_point binary_cors_point::point() const {
+	feature_point fpoint;
+	fpoint.position = vec2(position_x, position_y);
+	fpoint.depth = depth;
+	fpoint.weight = weight;
+	return fpoint;
+}
+
+
+void binary_image_correspondences_data::add_feature(const std::string& feature_name, const view_index& reference_view, const binary_cors_point* points_begin, const binary_cors_point* points_end) {
+	binary_cors_feature feature;
+	feature.name_offset = names.size();
+	feature.name_length = feature_name.length();
+	feature.reference_view_x = reference_view.x;
+	feature.reference_view_y = reference_view.y;
+	feature.points_begin = points.size();
+	feature.points_count = points_end - points_begin;
+	features.push_back(feature);
+
+	names.append(feature_name).push_back('\0');
+
+	points.insert(points.end(), points_begin, points_end);
+	auto feature_points_begin = points.begin() + feature.points_begin;
+	if(! std::is_sorted(feature_points_begin, points.end(), view_less_))
+		std::sort(feature_points_begin, points.end(), view_less_);
+}
+
+
+binary_image_correspondences_data to_binary_image_correspondences_data(const image_correspondences& cors) {
+	binary_image_correspondences_data data;
+	data.dataset_group = cors.dataset_group;
+	data.features.reserve(cors.features.size());
+
+	std::vector<binary_cors_point> feature_points;
+	for(const auto& kv : cors.features) {
+		const std::string& feature_name = kv.first;
+		const image_correspondence_feature& feature = kv.second;
+
+		feature_points.clear();
+		for(const auto& kv2 : feature.points) {
+			const view_index& idx = kv2.first;
+			const feature_point& fpoint = kv2.second;
+			binary_cors_point pt;
+			pt.view_x = idx.x;
+			pt.view_y = idx.y;
+			pt.position_x = fpoint.position[0];
+			pt.position_y = fpoint.position[1];
+			pt.depth = fpoint.depth;
+			pt.weight = fpoint.weight;
+			feature_points.push_back(pt);
+		}
+
+		data.add_feature(feature_name, feature.reference_view, feature_points.data(), feature_points.data() + feature_points.size());
+	}
+
+	return data;
+}
+
+
+void export_binary_image_correspondences_v2(const binary_image_correspondences_data& data, const std::string& filename) {
+	// feature table, sorted by name
+	std::vector<binary_cors_feature> features = data.features;
+	std::sort(features.begin(), features.end(), [&data](const binary_cors_feature& a, const binary_cors_feature& b) {
+		return (data.names.compare(a.name_offset, a.name_length, data.names, b.name_offset, b.name_length) < 0);
+	});
+
+	// per-view index into points
+	std::vector<binary_cors_view_point> view_points;
+	view_points.reserve(data.points.size());
+	for(std::uint32_t feature = 0; feature < features.size(); ++feature) {
+		const binary_cors_feature& feat = features[feature];
+		for(std::uint64_t point = feat.points_begin; point < feat.points_begin + feat.points_count; ++point) {
+			binary_cors_view_point view_point;
+			view_point.feature = feature;
+			view_point.padding = 0;
+			view_point.point = point;
+			view_points.push_back(view_point);
+		}
+	}
+	std::stable_sort(view_points.begin(), view_points.end(), [&data](const binary_cors_view_point& a, const binary_cors_view_point& b) {
+		return view_less_(data.points[a.point], data.points[b.point]);
+	});
+
+	std::vector<binary_cors_view> views;
+	for(std::uint64_t i = 0; i < view_points.size(); ++i) {
+		const binary_cors_point& pt = data.points[view_points[i].point];
+		if(views.empty() || views.back().view() != pt.view()) {
+			binary_cors_view view;
+			view.view_x = pt.view_x;
+			view.view_y = pt.view_y;
+			view.view_points_begin = i;
+			view.view_points_count = 0;
+			views.push_back(view);
+		}
+		views.back().view_points_count++;
+	}
+
+	// names table, with dataset group appended
+	std::string names = data.names;
+	std::uint32_t dataset_group_name_offset = names.size();
+	names.append(data.dataset_group).push_back('\0');
+
+	binary_cors_header header;
+	header.magic = binary_cors_v2_magic_;
+	header.version = binary_cors_v2_version_;
+	header.dataset_group_name_offset = dataset_group_name_offset;
+	header.dataset_group_name_length = data.dataset_group.length();
+	header.features_count = features.size();
+	header.points_count = data.points.size();
+	header.views_count = views.size();
+	header.names_offset = aligned_offset_(sizeof(binary_cors_header));
+	header.names_size = names.size();
+	header.features_offset = aligned_offset_(header.names_offset + header.names_size);
+	header.points_offset = aligned_offset_(header.features_offset + features.size() * sizeof(binary_cors_feature));
+	header.views_offset = aligned_offset_(header.points_offset + data.points.size() * sizeof(binary_cors_point));
+	header.view_points_offset = aligned_offset_(header.views_offset + views.size() * sizeof(binary_cors_view));
+
+	std::ofstream str(filename, std::ios_base::binary);
+	std::uint64_t position = 0;
+	auto write_section = [&str, &position](std::uint64_t offset, const void* buf, std::size_t sz) {
+		Assert(offset >= position);
+		static const char padding[8] = { 0 };
+		str.write(padding, offset - position);
+		str.write(static_cast<const std::ostream::char_type*>(buf), sz);
+		position = offset + sz;
+	};
+
+	write_section(0, &header, sizeof(binary_cors_header));
+	write_section(header.names_offset, names.data(), names.size());
+	write_section(header.features_offset, features.data(), features.size() * sizeof(binary_cors_feature));
+	write_section(header.points_offset, data.points.data(), data.points.size() * sizeof(binary_cors_point));
+	write_section(header.views_offset, views.data(), views.size() * sizeof(binary_cors_view));
+	write_section(header.view_points_offset, view_points.data(), view_points.size() * sizeof(binary_cors_view_point));
+
+	if(! str) throw std::runtime_error("could not write binary cors file " + filename);
+}
+
+
+mapped_image_correspondences::mapped_image_correspondences(const std::string& filename) :
+	file_(filename)
+{
+	const byte* data = file_.data();
+	std::size_t size = file_.size();
+
+	if(size < sizeof(binary_cors_header)) throw std::runtime_error("binary cors file too small");
+	header_ = reinterpret_cast<const binary_cors_header*>(data);
+	if(header_->magic != binary_cors_v2_magic_) throw std::runtime_error("binary cors file does not have v2 magic number");
+	if(header_->version != binary_cors_v2_version_) throw std::runtime_error("binary cors file has unsupported version");
+
+	auto section = [&](std::uint64_t offset, std::uint64_t count, std::size_t elem_size) {
+		if(offset % 8 != 0 || offset > size || count > (size - offset) / elem_size)
+			throw std::runtime_error("binary cors file is corrupt or truncated");
+		return data + offset;
+	};
+	names_ = reinterpret_cast<const char*>(section(header_->names_offset, header_->names_size, 1));
+	features_ = reinterpret_cast<const binary_cors_feature*>(section(header_->features_offset, header_->features_count, sizeof(binary_cors_feature)));
+	points_ = reinterpret_cast<const binary_cors_point*>(section(header_->points_offset, header_->points_count, sizeof(binary_cors_point)));
+	views_ = reinterpret_cast<const binary_cors_view*>(section(header_->views_offset, header_->views_count, sizeof(binary_cors_view)));
+	view_points_ = reinterpret_cast<const binary_cors_view_point*>(section(header_->view_points_offset, header_->points_count, sizeof(binary_cors_view_point)));
+
+	// check that all names, and indices into the other sections, are in range
+	// so that the accessors can use them without checks
+	auto check = [](bool ok) { if(! ok) throw std::runtime_error("binary cors file is corrupt"); };
+	auto check_name = [&](std::uint64_t offset, std::uint64_t length) {
+		check(offset + length < header_->names_size && names_[offset + length] == '\0');
+	};
+	check_name(header_->dataset_group_name_offset, header_->dataset_group_name_length);
+	for(const binary_cors_feature& feat : features()) {
+		check_name(feat.name_offset, feat.name_length);
+		check(feat.points_begin <= points_count() && feat.points_count <= points_count() - feat.points_begin);
+	}
+	for(const binary_cors_view& view : views())
+		check(view.view_points_begin <= points_count() && view.view_points_count <= points_count() - view.view_points_begin);
+	for(std::size_t i = 0; i < points_count(); ++i)
+		check(view_points_[i].feature < features_count() && view_points_[i].point < points_count());
+}
+
+
+std::string mapped_image_correspondences::dataset_group() const {
+	return std::string(names_ + header_->dataset_group_name_offset, header_->dataset_group_name_length);
+}
+
+
+binary_cors_range<binary_cors_point> mapped_image_correspondences::feature_points(std::ptrdiff_t feature) const {
+	const binary_cors_feature& feat = features_[feature];
+	Assert_crit(feat.points_begin + feat.points_count <= points_count());
+	const binary_cors_point* begin = points_ + feat.points_begin;
+	return binary_cors_range<binary_cors_point>(begin, begin + feat.points_count);
+}
+
+
+std::ptrdiff_t mapped_image_correspondences::find_feature(const std::string& feature_name) const {
+	auto it = std::lower_bound(features_, features_ + features_count(), feature_name, [this](const binary_cors_feature& feat, const std::string& name) {
+		return (name.compare(0, std::string::npos, names_ + feat.name_offset, feat.name_length) > 0);
+	});
+	if(it == features_ + features_count()) return -1;
+	if(feature_name.compare(0, std::string::npos, names_ + it->name_offset, it->name_length) != 0) return -1;
+	return it - features_;
+}
+
+
+binary_cors_range<binary_cors_view_point> mapped_image_correspondences::view_points(const view_index& idx) const {
+	auto it = std::lower_bound(views_, views_ + views_count(), idx, [](const binary_cors_view& view, const view_index& idx) {
+		return (view.view() < idx);
+	});
+	if(it == views_ + views_count() || it->view() != idx) return binary_cors_range<binary_cors_view_point>();
+	const binary_cors_view_point* begin = view_points_ + it->view_points_begin;
+	return binary_cors_range<binary_cors_view_point>(begin, begin + it->view_points_count);
+}
+
+
+bool is_binary_image_correspondences_v2(const std::string& filename) {
+	std::ifstream str(filename, std::ios_base::binary);
+	std::int32_t magic = 0;
+	str.read(reinterpret_cast<std::istream::char_type*>(&magic), sizeof(magic));
+	return str && (magic == binary_cors_v2_magic_);
+}
+
+
+image_correspondences to_image_correspondences(const mapped_image_correspondences& mcors) {
+	image_correspondences cors;
+	cors.dataset_group = mcors.dataset_group();
+	for(std::ptrdiff_t feature = 0; feature < mcors.features_count(); ++feature) {
+		auto feature_it = cors.features.emplace_hint(cors.features.end(), mcors.feature_name(feature), image_correspondence_feature());
+		image_correspondence_feature& feat = feature_it->second;
+		feat.reference_view = mcors.feature_reference_view(feature);
+		for(const binary_cors_point& pt : mcors.feature_points(feature))
+			feat.points.emplace_hint(feat.points.end(), pt.view(), pt.point());
+	}
+	return cors;
+}
+
+}
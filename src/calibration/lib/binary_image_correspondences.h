@@ -0,0 +1,170 @@
+#ifndef LICORNEA_BINARY_IMAGE_CORRESPONDENCES_H_
+#define LICORNEA_BINARY_IMAGE_CORRESPONDENCES_H_
+
+#include "../../lib/common.h"
+#include "../../lib/memory_mapped_file.h"
+#include "feature_point.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace tlz {
+
+struct image_correspondences;
+
+/*
+Binary image correspondences format, version 2.
+All sections are 8-byte aligned, and stored in host (little endian) byte order, so that the file
+can be memory mapped and accessed in place:
+
+   header
+   names       concatenated feature names, each NUL-terminated (also holds dataset group name)
+   features    binary_cors_feature[features_count], sorted by name
+   points      binary_cors_point[points_count], contiguous block per feature, sorted by view
+   views       binary_cors_view[views_count], sorted by view index
+   view_points binary_cors_view_point[points_count], contiguous block per view, sorted by feature
+*/
+
+struct binary_cors_header {
+	std::int32_t magic;
+	std::int32_t version;
+	std::uint32_t dataset_group_name_offset;
+	std::uint32_t dataset_group_name_length;
+	std::uint64_t features_count;
+	std::uint64_t points_count;
+	std::uint64_t views_count;
+	std::uint64_t names_offset;
+	std::uint64_t names_size;
+	std::uint64_t features_offset;
+	std::uint64_t points_offset;
+	std::uint64_t views_offset;
+	std::uint64_t view_points_offset;
+};
+
+struct binary_cors_feature {
+	std::uint32_t name_offset;
+	std::uint32_t name_length;
+	std::int32_t reference_view_x;
+	std::int32_t reference_view_y;
+	std::uint64_t points_begin;
+	std::uint64_t points_count;
+
+	view_index reference_view() const { return view_index(reference_view_x, reference_view_y); }
+};
+
+struct binary_cors_point {
+	std::int32_t view_x;
+	std::int32_t view_y;
+	double position_x;
+	double position_y;
+	double depth;
+	double weight;
+
+	view_index view() const { return view_index(view_x, view_y); }
+	feature_point point() const;
+};
+
+struct binary_cors_view {
+	std::int32_t view_x;
+	std::int32_t view_y;
+	std::uint64_t view_points_begin;
+	std::uint64_t view_points_count;
+
+	view_index view() const { return view_index(view_x, view_y); }
+};
+
+struct binary_cors_view_point {
+	std::uint32_t feature;
+	std::uint32_t padding;
+	std::uint64_t point;
+};
+
+
+/// Contiguous range of records in binary correspondences.
+template<typename T>
+class binary_cors_range {
+private:
+	const T* begin_ = nullptr;
+	const T* end_ = nullptr;
+
+public:
+	binary_cors_range() = default;
+	binary_cors_range(const T* begin, const T* end) : begin_(begin), end_(end) { }
+
+	const T* begin() const { return begin_; }
+	const T* end() const { return end_; }
+	std::size_t size() const { return end_ - begin_; }
+	bool empty() const { return (begin_ == end_); }
+	const T& operator[](std::ptrdiff_t i) const { return begin_[i]; }
+};
+
+
+/// Image correspondences in binary v2 layout, as flat arrays.
+/** Intermediate form for writing binary v2 files. Features need to be added sorted by name, and points for
+ ** each feature sorted by view. */
+struct binary_image_correspondences_data {
+	std::string dataset_group;
+	std::string names;
+	std::vector<binary_cors_feature> features;
+	std::vector<binary_cors_point> points;
+
+	void add_feature(const std::string& feature_name, const view_index& reference_view, const binary_cors_point* points_begin, const binary_cors_point* points_end);
+};
+
+binary_image_correspondences_data to_binary_image_correspondences_data(const image_correspondences&);
+
+void export_binary_image_correspondences_v2(const binary_image_correspondences_data&, const std::string& filename);
+
+
+/// Read-only access to memory mapped binary v2 image correspondences file.
+/** Nothing gets copied when opening the file. Feature names, points for a feature, and points on a view
+ ** are accessed in place. The section sizes, and the names and indices in the records, are checked against the file
+ ** size when opening it, and a corrupt or truncated file throws. */
+class mapped_image_correspondences {
+private:
+	memory_mapped_file file_;
+	const binary_cors_header* header_ = nullptr;
+	const char* names_ = nullptr;
+	const binary_cors_feature* features_ = nullptr;
+	const binary_cors_point* points_ = nullptr;
+	const binary_cors_view* views_ = nullptr;
+	const binary_cors_view_point* view_points_ = nullptr;
+
+public:
+	explicit mapped_image_correspondences(const std::string& filename);
+
+	std::string dataset_group() const;
+
+	std::size_t features_count() const { return header_->features_count; }
+	std::size_t points_count() const { return header_->points_count; }
+	std::size_t views_count() const { return header_->views_count; }
+
+	binary_cors_range<binary_cors_feature> features() const
+		{ return binary_cors_range<binary_cors_feature>(features_, features_ + features_count()); }
+	binary_cors_range<binary_cors_view> views() const
+		{ return binary_cors_range<binary_cors_view>(views_, views_ + views_count()); }
+
+	const char* feature_name_c_str(std::ptrdiff_t feature) const
+		{ return names_ + features_[feature].name_offset; }
+	std::string feature_name(std::ptrdiff_t feature) const
+		{ return std::string(feature_name_c_str(feature), features_[feature].name_length); }
+	view_index feature_reference_view(std::ptrdiff_t feature) const
+		{ return features_[feature].reference_view(); }
+	binary_cors_range<binary_cors_point> feature_points(std::ptrdiff_t feature) const;
+	std::ptrdiff_t find_feature(const std::string& feature_name) const;
+
+	const binary_cors_point& point(std::uint64_t point) const { return points_[point]; }
+
+	binary_cors_range<binary_cors_view_point> view_points(const view_index&) const;
+
+	const byte* raw_data() const { return file_.data(); }
+	std::size_t raw_size() const { return file_.size(); }
+};
+
+bool is_binary_image_correspondences_v2(const std::string& filename);
+
+image_correspondences to_image_correspondences(const mapped_image_correspondences&);
+
+}
+
+#endif
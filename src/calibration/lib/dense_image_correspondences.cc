@@ -0,0 +1,166 @@
+#include "dense_image_correspondences.h"
+#include "flat_image_correspondences.h"
+#include "binary_image_correspondences.h"
+#include "../../lib/string.h"
+#include <algorithm>
+#include <numeric>
+#include <iostream>
+#include <stdexcept>
+
+namespace tlz {
+
+namespace {
+	std::vector<std::ptrdiff_t> features_by_name_(const std::vector<std::string>& feature_names) {
+		std::vector<std::ptrdiff_t> order(feature_names.size());
+		std::iota(order.begin(), order.end(), 0);
+		std::sort(order.begin(), order.end(), [&feature_names](std::ptrdiff_t a, std::ptrdiff_t b) {
+			return (feature_names[a] < feature_names[b]);
+		});
+		return order;
+	}
+}
+
+
+dense_image_correspondences::dense_image_correspondences(const dataset& datas, const std::string& dataset_group, const std::vector<std::string>& feature_names, const std::vector<view_index>& reference_views, int horizontal_outreach, int vertical_outreach) :
+	dataset_group_(dataset_group),
+	feature_names_(feature_names),
+	reference_views_(reference_views),
+	is_2d_(datas.is_2d()),
+	x_min_(datas.x_min()), x_step_(datas.x_step()), x_count_(datas.x_count()),
+	y_min_(datas.y_min()), y_step_(datas.y_step()), y_count_(datas.y_count())
+{
+	Assert(feature_names_.size() == reference_views_.size());
+	if(horizontal_outreach < 0 || vertical_outreach < 0) throw std::invalid_argument("outreach must not be negative");
+	
+	int horizontal_reach = horizontal_outreach / x_step_;
+	int vertical_reach = (is_2d_ ? vertical_outreach / y_step_ : 0);
+	std::ptrdiff_t cells_count = 0;
+	windows_.reserve(features_count());
+	for(const view_index& ref_idx : reference_views_) {
+		if(! has_view(ref_idx)) throw std::invalid_argument("reference view must be on dataset grid");
+		int col = col_(ref_idx), row = row_(ref_idx);
+		window win;
+		win.offset = cells_count;
+		win.col_begin = std::max(col - horizontal_reach, 0);
+		win.col_count = std::min(col + horizontal_reach, x_count_ - 1) - win.col_begin + 1;
+		win.row_begin = std::max(row - vertical_reach, 0);
+		win.row_count = std::min(row + vertical_reach, (is_2d_ ? y_count_ : 1) - 1) - win.row_begin + 1;
+		windows_.push_back(win);
+		cells_count += win.size();
+	}
+	positions_.resize(cells_count);
+	valid_.assign(cells_count, 0);
+}
+
+
+view_index dense_image_correspondences::view_(const window& win, std::ptrdiff_t window_view) const {
+	int x = x_min_ + (win.col_begin + window_view % win.col_count) * x_step_;
+	if(is_2d_) return view_index(x, y_min_ + (win.row_begin + window_view / win.col_count) * y_step_);
+	else return view_index(x);
+}
+
+
+bool dense_image_correspondences::has_view(const view_index& idx) const {
+	auto valid_coordinate = [](int c, int min, int step, int count) {
+		return (c >= min) && ((c - min) % step == 0) && ((c - min) / step < count);
+	};
+	if(! valid_coordinate(idx.x, x_min_, x_step_, x_count_)) return false;
+	if(is_2d_) return valid_coordinate(idx.y, y_min_, y_step_, y_count_);
+	else return idx.is_1d();
+}
+
+
+bool dense_image_correspondences::in_window_(feature_id f, const view_index& idx) const {
+	if(! has_view(idx)) return false;
+	const window& win = windows_[f];
+	int col = col_(idx), row = row_(idx);
+	return (col >= win.col_begin) && (col < win.col_begin + win.col_count)
+		&& (row >= win.row_begin) && (row < win.row_begin + win.row_count);
+}
+
+
+vec2 dense_image_correspondences::position(feature_id f, const view_index& idx) const {
+	const cv::Point2f& pos = positions_[cell_(f, idx)];
+	return vec2(pos.x, pos.y);
+}
+
+
+std::size_t dense_image_correspondences::feature_points_count(feature_id f) const {
+	auto begin = valid_.begin() + windows_[f].offset;
+	return std::count(begin, begin + windows_[f].size(), 1);
+}
+
+
+std::size_t dense_image_correspondences::points_count() const {
+	return std::count(valid_.begin(), valid_.end(), 1);
+}
+
+
+flat_image_correspondences to_flat_image_correspondences(const dense_image_correspondences& dense_cors) {
+	flat_image_correspondences flat_cors;
+	flat_cors.dataset_group = dense_cors.dataset_group();
+	flat_cors.reserve(dense_cors.features_count(), dense_cors.points_count());
+
+	for(std::ptrdiff_t f : features_by_name_(dense_cors.feature_names_)) {
+		flat_cors.add_feature(dense_cors.feature_names_[f], dense_cors.reference_views_[f]);
+		const auto& win = dense_cors.windows_[f];
+		std::ptrdiff_t cell = win.offset;
+		for(std::ptrdiff_t view = 0; view < win.size(); ++view, ++cell) {
+			if(! dense_cors.valid_[cell]) continue;
+			feature_point fpoint;
+			fpoint.position = vec2(dense_cors.positions_[cell].x, dense_cors.positions_[cell].y);
+			flat_cors.add_point(dense_cors.view_(win, view), fpoint);
+		}
+	}
+	return flat_cors;
+}
+
+
+binary_image_correspondences_data to_binary_image_correspondences_data(const dense_image_correspondences& dense_cors) {
+	binary_image_correspondences_data data;
+	data.dataset_group = dense_cors.dataset_group();
+	data.features.reserve(dense_cors.features_count());
+	data.points.reserve(dense_cors.points_count());
+
+	for(std::ptrdiff_t f : features_by_name_(dense_cors.feature_names_)) {
+		std::size_t points_begin = data.points.size();
+		const auto& win = dense_cors.windows_[f];
+		std::ptrdiff_t cell = win.offset;
+		for(std::ptrdiff_t view = 0; view < win.size(); ++view, ++cell) {
+			if(! dense_cors.valid_[cell]) continue;
+			view_index idx = dense_cors.view_(win, view);
+			binary_cors_point pt;
+			pt.view_x = idx.x;
+			pt.view_y = idx.y;
+			pt.position_x = dense_cors.positions_[cell].x;
+			pt.position_y = dense_cors.positions_[cell].y;
+			pt.depth = 0.0;
+			pt.weight = 1.0;
+			data.points.push_back(pt);
+		}
+
+		// points are already sorted by view
+		binary_cors_feature feature;
+		feature.name_offset = data.names.size();
+		feature.name_length = dense_cors.feature_names_[f].length();
+		feature.reference_view_x = dense_cors.reference_views_[f].x;
+		feature.reference_view_y = dense_cors.reference_views_[f].y;
+		feature.points_begin = points_begin;
+		feature.points_count = data.points.size() - points_begin;
+		data.features.push_back(feature);
+		data.names.append(dense_cors.feature_names_[f]).push_back('\0');
+	}
+	return data;
+}
+
+
+void export_dense_image_correspondences(const dense_image_correspondences& cors, const std::string& filename) {
+	if(file_name_extension(filename) == "bin") {
+		std::cout << "exporting image correspondences to binary" << std::endl;
+		export_binary_image_correspondences_v2(to_binary_image_correspondences_data(cors), filename);
+	} else {
+		export_flat_image_correspondences(to_flat_image_correspondences(cors), filename);
+	}
+}
+
+}
@@ -0,0 +1,92 @@
+#ifndef LICORNEA_DENSE_IMAGE_CORRESPONDENCES_H_
+#define LICORNEA_DENSE_IMAGE_CORRESPONDENCES_H_
+
+#include "../../lib/common.h"
+#include "../../lib/opencv.h"
+#include "../../lib/dataset.h"
+#include "../../lib/assert.h"
+#include <string>
+#include <vector>
+
+namespace tlz {
+
+struct flat_image_correspondences;
+struct binary_image_correspondences_data;
+
+/// Image correspondences of a fixed set of features on the views around their reference views, in dense arrays.
+/** Each feature has a window of views, within `horizontal_outreach` and `vertical_outreach` of its reference view (in view
+ ** index units), and holds a position and validity flag for each view in it. Views outside the window are never set.
+ ** Windows are stored feature by feature, with views numbered row by row. Different (feature, view) pairs can be written
+ ** concurrently without locking. Meant for accumulating tracking results, where features are seen on many views. Positions
+ ** are stored in single precision. Features have no depth, and weight 1. */
+class dense_image_correspondences {
+public:
+	using feature_id = std::ptrdiff_t;
+
+private:
+	/// Views of one feature, as range of dataset grid columns and rows, and offset of its cells.
+	struct window {
+		std::ptrdiff_t offset;
+		int col_begin, col_count;
+		int row_begin, row_count;
+		
+		std::size_t size() const { return col_count * row_count; }
+	};
+
+	std::string dataset_group_;
+	std::vector<std::string> feature_names_;
+	std::vector<view_index> reference_views_;
+
+	bool is_2d_;
+	int x_min_, x_step_, x_count_;
+	int y_min_, y_step_, y_count_;
+
+	std::vector<window> windows_;
+	std::vector<cv::Point2f> positions_;
+	std::vector<uchar> valid_;
+
+	int col_(const view_index& idx) const { return (idx.x - x_min_) / x_step_; }
+	int row_(const view_index& idx) const { return (is_2d_ ? (idx.y - y_min_) / y_step_ : 0); }
+	view_index view_(const window&, std::ptrdiff_t window_view) const;
+	bool in_window_(feature_id f, const view_index& idx) const;
+	std::ptrdiff_t cell_(feature_id f, const view_index& idx) const {
+		Assert_crit(f >= 0 && f < features_count() && in_window_(f, idx));
+		const window& win = windows_[f];
+		return win.offset + (row_(idx) - win.row_begin) * win.col_count + (col_(idx) - win.col_begin);
+	}
+
+public:
+	dense_image_correspondences(const dataset&, const std::string& dataset_group, const std::vector<std::string>& feature_names, const std::vector<view_index>& reference_views, int horizontal_outreach, int vertical_outreach);
+
+	const std::string& dataset_group() const { return dataset_group_; }
+	std::size_t features_count() const { return feature_names_.size(); }
+	const std::string& feature_name(feature_id f) const { return feature_names_[f]; }
+	const view_index& reference_view(feature_id f) const { return reference_views_[f]; }
+
+	bool has_view(const view_index&) const;
+
+	void set(feature_id f, const view_index& idx, const cv::Point2f& pos) {
+		std::ptrdiff_t cell = cell_(f, idx);
+		positions_[cell] = pos;
+		valid_[cell] = 1;
+	}
+	bool has(feature_id f, const view_index& idx) const { return in_window_(f, idx) && valid_[cell_(f, idx)]; }
+	vec2 position(feature_id f, const view_index& idx) const;
+
+	std::size_t feature_points_count(feature_id f) const;
+	std::size_t points_count() const;
+
+	friend flat_image_correspondences to_flat_image_correspondences(const dense_image_correspondences&);
+	friend binary_image_correspondences_data to_binary_image_correspondences_data(const dense_image_correspondences&);
+};
+
+
+flat_image_correspondences to_flat_image_correspondences(const dense_image_correspondences&);
+binary_image_correspondences_data to_binary_image_correspondences_data(const dense_image_correspondences&);
+
+/// Export to binary (`.bin`) file directly, or to other formats through flat_image_correspondences.
+void export_dense_image_correspondences(const dense_image_correspondences&, const std::string& filename);
+
+}
+
+#endif
@@ -38,6 +38,35 @@ json encode_feature_points(const feature_points& fpoints) {
 }
 
 
+feature_points import_feature_points(const std::string& filename) {
+	// fill feature_points from parser events, discarding each point value once decoded
+	feature_points fpoints;
+	std::string key1, key2; // current keys in root object, and in points object
+	
+	using event_t = json::parse_event_t;
+	json j_fpoints = import_json_file(filename, [&](int depth, event_t event, json& parsed) -> bool {
+		if(event == event_t::key) {
+			if(depth == 1) key1 = parsed.get<std::string>();
+			else if(depth == 2) key2 = parsed.get<std::string>();
+			return true;
+		}
+		
+		if(depth == 2 && event == event_t::object_end && key1 == "points") {
+			fpoints.points[key2] = decode_feature_point(parsed);
+			return false;
+		} else if(depth == 1 && event == event_t::object_end && key1 == "points") {
+			return false;
+		} else {
+			return true; // small root values (view_idx, is_distorted) are kept
+		}
+	});
+	
+	if(has(j_fpoints, "view_idx")) fpoints.view_idx = decode_view_index(j_fpoints["view_idx"]);
+	fpoints.is_distorted = get_or(j_fpoints, "is_distorted", false);
+	return fpoints;
+}
+
+
 void feature_points::normalize_weights() {
 	real weights_sum = 0.0;
 	for(const auto& kv : points) weights_sum += kv.second.weight;
@@ -132,7 +161,7 @@ cv::Mat_<cv::Vec3b> visualize_feature_points(const feature_points& fpoints, cons
 
 feature_points feature_points_arg() {
 	std::cout << "loading feature points" << std::endl;
-	return decode_feature_points(json_arg());
+	return import_feature_points(in_filename_arg());
 }
 
 
@@ -31,6 +31,8 @@ struct feature_points {
 feature_points decode_feature_points(const json&);
 json encode_feature_points(const feature_points&);
 
+feature_points import_feature_points(const std::string& filename);
+
 feature_points undistort(const feature_points&, const intrinsics&);
 
 feature_points feature_points_for_view(const image_correspondences& cors, view_index idx, bool is_distorted = true);
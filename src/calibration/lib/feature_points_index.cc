@@ -0,0 +1,133 @@
+#include "feature_points_index.h"
+#include "image_correspondence.h"
+#include "flat_image_correspondences.h"
+#include <algorithm>
+#include <atomic>
+#include <climits>
+
+namespace tlz {
+
+std::ptrdiff_t feature_points_index::cell_(const view_index& idx) const {
+	if(idx.x < x_min_ || idx.x > x_max_ || idx.y < y_min_ || idx.y > y_max_) return -1;
+	std::ptrdiff_t width = x_max_ - x_min_ + 1;
+	return (idx.y - y_min_)*width + (idx.x - x_min_);
+}
+
+
+template<typename Points_func>
+void feature_points_index::build_(Points_func&& for_each_point) {
+	// for_each_point(f, fn) calls fn(view_index, feature_point) for each point of feature f
+	std::ptrdiff_t features_count = feature_names_.size();
+	
+	// bounding box of view indices, defines grid of cells
+	x_min_ = y_min_ = INT_MAX;
+	x_max_ = y_max_ = INT_MIN;
+	#pragma omp parallel
+	{
+		int x_min = INT_MAX, x_max = INT_MIN, y_min = INT_MAX, y_max = INT_MIN;
+		#pragma omp for
+		for(std::ptrdiff_t f = 0; f < features_count; ++f)
+			for_each_point(f, [&](const view_index& idx, const feature_point&) {
+				x_min = std::min(x_min, idx.x); x_max = std::max(x_max, idx.x);
+				y_min = std::min(y_min, idx.y); y_max = std::max(y_max, idx.y);
+			});
+		#pragma omp critical
+		{
+			x_min_ = std::min(x_min_, x_min); x_max_ = std::max(x_max_, x_max);
+			y_min_ = std::min(y_min_, y_min); y_max_ = std::max(y_max_, y_max);
+		}
+	}
+	if(x_max_ < x_min_) {
+		x_min_ = y_min_ = 0;
+		x_max_ = y_max_ = -1;
+		offsets_.assign(1, 0);
+		return;
+	}
+	std::size_t cells_count = std::size_t(x_max_ - x_min_ + 1) * std::size_t(y_max_ - y_min_ + 1);
+	
+	// count points per cell
+	std::vector<std::atomic<std::size_t>> cursors(cells_count);
+	for(auto& cursor : cursors) cursor = 0;
+	#pragma omp parallel for
+	for(std::ptrdiff_t f = 0; f < features_count; ++f)
+		for_each_point(f, [&](const view_index& idx, const feature_point&) {
+			cursors[cell_(idx)]++;
+		});
+
+	offsets_.resize(cells_count + 1);
+	offsets_[0] = 0;
+	for(std::size_t cell = 0; cell < cells_count; ++cell) {
+		offsets_[cell + 1] = offsets_[cell] + cursors[cell];
+		cursors[cell] = offsets_[cell];
+	}
+	
+	// scatter points into cells
+	entries_.resize(offsets_.back());
+	#pragma omp parallel for
+	for(std::ptrdiff_t f = 0; f < features_count; ++f)
+		for_each_point(f, [&](const view_index& idx, const feature_point& fpoint) {
+			entry& ent = entries_[cursors[cell_(idx)]++];
+			ent.feature = f;
+			ent.point = fpoint;
+		});
+	
+	// order by feature within each cell (features are ordered by name)
+	#pragma omp parallel for schedule(dynamic, 256)
+	for(std::ptrdiff_t cell = 0; cell < cells_count; ++cell)
+		std::sort(entries_.begin() + offsets_[cell], entries_.begin() + offsets_[cell + 1], [](const entry& a, const entry& b) {
+			return (a.feature < b.feature);
+		});
+}
+
+
+feature_points_index::feature_points_index(const image_correspondences& cors) {
+	std::vector<const image_correspondence_feature*> features;
+	for(const auto& kv : cors.features) {
+		feature_names_.push_back(kv.first);
+		reference_views_.push_back(kv.second.reference_view);
+		features.push_back(&kv.second);
+	}
+	build_([&features](std::ptrdiff_t f, auto&& fn) {
+		for(const auto& kv : features[f]->points) fn(kv.first, kv.second);
+	});
+}
+
+
+feature_points_index::feature_points_index(const flat_image_correspondences& cors) {
+	feature_names_ = cors.feature_names;
+	reference_views_ = cors.reference_views;
+	build_([&cors](std::ptrdiff_t f, auto&& fn) {
+		for(std::ptrdiff_t p = cors.feature_begin(f); p < cors.feature_end(f); ++p) fn(cors.views[p], cors.point(p));
+	});
+}
+
+
+auto feature_points_index::view_entries(const view_index& idx) const -> entries_range {
+	std::ptrdiff_t cell = cell_(idx);
+	if(cell == -1) return entries_range { nullptr, nullptr };
+	const entry* base = entries_.data();
+	return entries_range { base + offsets_[cell], base + offsets_[cell + 1] };
+}
+
+
+feature_points feature_points_for_view(const feature_points_index& index, view_index idx, bool is_distorted) {
+	feature_points fpoints;
+	fpoints.view_idx = idx;
+	fpoints.is_distorted = is_distorted;
+	for(const feature_points_index::entry& ent : index.view_entries(idx))
+		fpoints.points.emplace_hint(fpoints.points.end(), index.feature_name(ent), ent.point);
+	return fpoints;
+}
+
+
+feature_points undistorted_feature_points_for_view(const feature_points_index& index, view_index idx, const intrinsics& intr) {
+	feature_points fpoints = feature_points_for_view(index, idx);
+	if(intr.distortion) {
+		return undistort(fpoints, intr);
+	} else {
+		fpoints.is_distorted = false;
+		return fpoints;
+	}
+}
+
+}
@@ -0,0 +1,67 @@
+#ifndef LICORNEA_FEATURE_POINTS_INDEX_H_
+#define LICORNEA_FEATURE_POINTS_INDEX_H_
+
+#include "../../lib/common.h"
+#include "../../lib/intrinsics.h"
+#include "feature_point.h"
+#include "feature_points.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace tlz {
+
+struct image_correspondences;
+struct flat_image_correspondences;
+
+/// Inverted index from view to the feature points on that view.
+/** Built once from image correspondences, in one parallel pass over all points. Afterwards the feature points on
+ ** a view are retrieved in constant time, instead of doing one lookup per feature. Keeps its own copy of the
+ ** points, stored contiguously per view and ordered by feature name. */
+class feature_points_index {
+public:
+	struct entry {
+		std::uint32_t feature; // index into feature_names()
+		feature_point point;
+	};
+	
+	struct entries_range {
+		const entry* begin_;
+		const entry* end_;
+		
+		const entry* begin() const { return begin_; }
+		const entry* end() const { return end_; }
+		std::size_t size() const { return end_ - begin_; }
+		bool empty() const { return (begin_ == end_); }
+	};
+
+private:
+	std::vector<std::string> feature_names_;
+	std::vector<view_index> reference_views_;
+	int x_min_ = 0, x_max_ = -1;
+	int y_min_ = 0, y_max_ = -1;
+	std::vector<std::size_t> offsets_; // per grid cell, plus end
+	std::vector<entry> entries_;
+	
+	std::ptrdiff_t cell_(const view_index&) const;
+	template<typename Points_func> void build_(Points_func&&);
+
+public:
+	feature_points_index() = default;
+	explicit feature_points_index(const image_correspondences&);
+	explicit feature_points_index(const flat_image_correspondences&);
+	
+	const std::vector<std::string>& feature_names() const { return feature_names_; }
+	const std::string& feature_name(const entry& ent) const { return feature_names_[ent.feature]; }
+	const view_index& reference_view(const entry& ent) const { return reference_views_[ent.feature]; }
+	
+	entries_range view_entries(const view_index&) const;
+	std::size_t count(const view_index& idx) const { return view_entries(idx).size(); }
+};
+
+feature_points feature_points_for_view(const feature_points_index&, view_index idx, bool is_distorted = true);
+feature_points undistorted_feature_points_for_view(const feature_points_index&, view_index idx, const intrinsics&);
+
+}
+
+#endif
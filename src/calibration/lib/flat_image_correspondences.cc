@@ -0,0 +1,243 @@
+#include "flat_image_correspondences.h"
+#include "image_correspondence.h"
+#include "binary_image_correspondences.h"
+#include "../../lib/assert.h"
+#include "../../lib/string.h"
+#include <algorithm>
+#include <iostream>
+
+namespace tlz {
+
+feature_point flat_image_correspondences::point(point_id p) const {
+	feature_point fpoint;
+	fpoint.position = position(p);
+	fpoint.depth = depth[p];
+	fpoint.weight = weight[p];
+	return fpoint;
+}
+
+
+auto flat_image_correspondences::find_feature(const std::string& feature_name) const -> feature_id {
+	auto it = std::lower_bound(feature_names.begin(), feature_names.end(), feature_name);
+	if(it == feature_names.end() || *it != feature_name) return -1;
+	else return it - feature_names.begin();
+}
+
+
+auto flat_image_correspondences::find_point(feature_id f, const view_index& idx) const -> point_id {
+	auto begin = views.begin() + feature_begin(f);
+	auto end = views.begin() + feature_end(f);
+	auto it = std::lower_bound(begin, end, idx);
+	if(it == end || *it != idx) return -1;
+	else return it - views.begin();
+}
+
+
+auto flat_image_correspondences::add_feature(const std::string& feature_name, const view_index& reference_view) -> feature_id {
+	Assert_crit(feature_names.empty() || feature_names.back() < feature_name);
+	feature_names.push_back(feature_name);
+	reference_views.push_back(reference_view);
+	feature_offsets.push_back(points_count());
+	return features_count() - 1;
+}
+
+
+void flat_image_correspondences::add_point(const view_index& idx, const feature_point& fpoint) {
+	Assert_crit(features_count() > 0);
+	Assert_crit(feature_points_count(features_count() - 1) == 0 || views.back() < idx);
+	views.push_back(idx);
+	x.push_back(fpoint.position[0]);
+	y.push_back(fpoint.position[1]);
+	depth.push_back(fpoint.depth);
+	weight.push_back(fpoint.weight);
+	feature_offsets.back() = points_count();
+}
+
+
+void flat_image_correspondences::reserve(std::size_t features_count, std::size_t points_count) {
+	feature_names.reserve(features_count);
+	reference_views.reserve(features_count);
+	feature_offsets.reserve(features_count + 1);
+	views.reserve(points_count);
+	x.reserve(points_count);
+	y.reserve(points_count);
+	depth.reserve(points_count);
+	weight.reserve(points_count);
+}
+
+
+void flat_image_correspondences::shrink_to_fit() {
+	feature_names.shrink_to_fit();
+	reference_views.shrink_to_fit();
+	feature_offsets.shrink_to_fit();
+	views.shrink_to_fit();
+	x.shrink_to_fit();
+	y.shrink_to_fit();
+	depth.shrink_to_fit();
+	weight.shrink_to_fit();
+}
+
+
+flat_image_correspondences to_flat_image_correspondences(const image_correspondences& cors) {
+	std::size_t points_count = 0;
+	for(const auto& kv : cors.features) points_count += kv.second.points.size();
+
+	flat_image_correspondences flat_cors;
+	flat_cors.dataset_group = cors.dataset_group;
+	flat_cors.reserve(cors.features.size(), points_count);
+	for(const auto& kv : cors.features) {
+		const std::string& feature_name = kv.first;
+		const image_correspondence_feature& feature = kv.second;
+		flat_cors.add_feature(feature_name, feature.reference_view);
+		for(const auto& kv2 : feature.points) flat_cors.add_point(kv2.first, kv2.second);
+	}
+	return flat_cors;
+}
+
+
+flat_image_correspondences to_flat_image_correspondences(const mapped_image_correspondences& mcors) {
+	flat_image_correspondences flat_cors;
+	flat_cors.dataset_group = mcors.dataset_group();
+	flat_cors.reserve(mcors.features_count(), mcors.points_count());
+	for(std::ptrdiff_t feature = 0; feature < mcors.features_count(); ++feature) {
+		flat_cors.add_feature(mcors.feature_name(feature), mcors.feature_reference_view(feature));
+		for(const binary_cors_point& pt : mcors.feature_points(feature)) flat_cors.add_point(pt.view(), pt.point());
+	}
+	return flat_cors;
+}
+
+
+image_correspondences to_image_correspondences(const flat_image_correspondences& flat_cors) {
+	image_correspondences cors;
+	cors.dataset_group = flat_cors.dataset_group;
+	for(std::ptrdiff_t f = 0; f < flat_cors.features_count(); ++f) {
+		auto feature_it = cors.features.emplace_hint(cors.features.end(), flat_cors.feature_names[f], image_correspondence_feature());
+		image_correspondence_feature& feature = feature_it->second;
+		feature.reference_view = flat_cors.reference_views[f];
+		for(std::ptrdiff_t p = flat_cors.feature_begin(f); p < flat_cors.feature_end(f); ++p)
+			feature.points.emplace_hint(feature.points.end(), flat_cors.views[p], flat_cors.point(p));
+	}
+	return cors;
+}
+
+
+binary_image_correspondences_data to_binary_image_correspondences_data(const flat_image_correspondences& flat_cors) {
+	binary_image_correspondences_data data;
+	data.dataset_group = flat_cors.dataset_group;
+	data.features.reserve(flat_cors.features_count());
+	data.points.reserve(flat_cors.points_count());
+
+	std::vector<binary_cors_point> feature_points;
+	for(std::ptrdiff_t f = 0; f < flat_cors.features_count(); ++f) {
+		feature_points.clear();
+		for(std::ptrdiff_t p = flat_cors.feature_begin(f); p < flat_cors.feature_end(f); ++p) {
+			binary_cors_point pt;
+			pt.view_x = flat_cors.views[p].x;
+			pt.view_y = flat_cors.views[p].y;
+			pt.position_x = flat_cors.x[p];
+			pt.position_y = flat_cors.y[p];
+			pt.depth = flat_cors.depth[p];
+			pt.weight = flat_cors.weight[p];
+			feature_points.push_back(pt);
+		}
+		data.add_feature(flat_cors.feature_names[f], flat_cors.reference_views[f], feature_points.data(), feature_points.data() + feature_points.size());
+	}
+	return data;
+}
+
+
+std::vector<view_index> get_reference_views(const flat_image_correspondences& cors) {
+	std::vector<view_index> reference_views = cors.reference_views;
+	std::sort(reference_views.begin(), reference_views.end());
+	reference_views.erase(std::unique(reference_views.begin(), reference_views.end()), reference_views.end());
+	return reference_views;
+}
+
+
+std::vector<view_index> get_all_views(const flat_image_correspondences& cors) {
+	std::vector<view_index> all_views = cors.views;
+	std::sort(all_views.begin(), all_views.end());
+	all_views.erase(std::unique(all_views.begin(), all_views.end()), all_views.end());
+	return all_views;
+}
+
+
+flat_image_correspondences image_correspondences_with_reference(const flat_image_correspondences& cors, const view_index& reference_view) {
+	flat_image_correspondences out_cors;
+	out_cors.dataset_group = cors.dataset_group;
+	for(std::ptrdiff_t f = 0; f < cors.features_count(); ++f) {
+		if(cors.reference_views[f] != reference_view) continue;
+		out_cors.add_feature(cors.feature_names[f], reference_view);
+		for(std::ptrdiff_t p = cors.feature_begin(f); p < cors.feature_end(f); ++p)
+			out_cors.add_point(cors.views[p], cors.point(p));
+	}
+	return out_cors;
+}
+
+
+flat_image_correspondences undistort(const flat_image_correspondences& cors, const intrinsics& intr) {
+	if(intr.distortion.is_none()) return cors;
+
+	std::vector<vec2> dist_points(cors.points_count());
+	for(std::ptrdiff_t p = 0; p < cors.points_count(); ++p) dist_points[p] = cors.position(p);
+
+	std::vector<vec2> undist_points = undistort_points(intr, dist_points);
+
+	flat_image_correspondences out_cors = cors;
+	for(std::ptrdiff_t p = 0; p < cors.points_count(); ++p) {
+		out_cors.x[p] = undist_points[p][0];
+		out_cors.y[p] = undist_points[p][1];
+	}
+	return out_cors;
+}
+
+
+feature_points feature_points_for_view(const flat_image_correspondences& cors, view_index idx, bool is_distorted) {
+	feature_points fpoints;
+	fpoints.view_idx = idx;
+	fpoints.is_distorted = is_distorted;
+
+	for(std::ptrdiff_t f = 0; f < cors.features_count(); ++f) {
+		std::ptrdiff_t p = cors.find_point(f, idx);
+		if(p != -1) fpoints.points.emplace_hint(fpoints.points.end(), cors.feature_names[f], cors.point(p));
+	}
+
+	return fpoints;
+}
+
+
+feature_points undistorted_feature_points_for_view(const flat_image_correspondences& cors, view_index idx, const intrinsics& intr) {
+	feature_points fpoints = feature_points_for_view(cors, idx);
+	if(intr.distortion) {
+		return undistort(fpoints, intr);
+	} else {
+		fpoints.is_distorted = false;
+		return fpoints;
+	}
+}
+
+
+void export_flat_image_correspondences(const flat_image_correspondences& cors, const std::string& filename) {
+	if(file_name_extension(filename) == "bin") {
+		std::cout << "exporting image correspondences to binary" << std::endl;
+		export_binary_image_correspondences_v2(to_binary_image_correspondences_data(cors), filename);
+	} else {
+		export_image_corresponcences(to_image_correspondences(cors), filename);
+	}
+}
+
+
+flat_image_correspondences import_flat_image_correspondences(const std::string& filename) {
+	if(file_name_extension(filename) == "bin" && is_binary_image_correspondences_v2(filename))
+		return to_flat_image_correspondences(mapped_image_correspondences(filename));
+	else
+		return to_flat_image_correspondences(import_image_correspondences(filename));
+}
+
+
+flat_image_correspondences flat_image_correspondences_arg() {
+	std::cout << "loading image correspondences" << std::endl;
+	return import_flat_image_correspondences(in_filename_arg());
+}
+
+}
@@ -0,0 +1,86 @@
+#ifndef LICORNEA_FLAT_IMAGE_CORRESPONDENCES_H_
+#define LICORNEA_FLAT_IMAGE_CORRESPONDENCES_H_
+
+#include "../../lib/common.h"
+#include "../../lib/intrinsics.h"
+#include "feature_point.h"
+#include "feature_points.h"
+#include <string>
+#include <vector>
+
+namespace tlz {
+
+struct image_correspondences;
+struct binary_image_correspondences_data;
+class mapped_image_correspondences;
+
+/// Image correspondences stored in flat, columnar arrays.
+/** Features are identified by integer IDs, in order of feature name. The points of all features are stored in
+ ** parallel arrays (structure of arrays), sorted by (feature, view). Points of feature `f` are at indices
+ ** `[feature_begin(f), feature_end(f))`.
+ ** Alternative to image_correspondences with much less memory overhead and cache-friendly iteration. */
+struct flat_image_correspondences {
+	using feature_id = std::ptrdiff_t;
+	using point_id = std::ptrdiff_t;
+
+	std::string dataset_group;
+
+	// per feature
+	std::vector<std::string> feature_names;
+	std::vector<view_index> reference_views;
+	std::vector<std::size_t> feature_offsets = { 0 }; // features_count() + 1 elements
+
+	// per point
+	std::vector<view_index> views;
+	std::vector<real> x;
+	std::vector<real> y;
+	std::vector<real> depth;
+	std::vector<real> weight;
+
+	std::size_t features_count() const { return feature_names.size(); }
+	std::size_t points_count() const { return views.size(); }
+
+	point_id feature_begin(feature_id f) const { return feature_offsets[f]; }
+	point_id feature_end(feature_id f) const { return feature_offsets[f + 1]; }
+	std::size_t feature_points_count(feature_id f) const { return feature_end(f) - feature_begin(f); }
+
+	vec2 position(point_id p) const { return vec2(x[p], y[p]); }
+	feature_point point(point_id p) const;
+
+	feature_id find_feature(const std::string& feature_name) const;
+	point_id find_point(feature_id f, const view_index& idx) const;
+	bool has_feature(const std::string& feature_name) const
+		{ return (find_feature(feature_name) != -1); }
+
+	/// Append new feature, with higher name than all existing features.
+	feature_id add_feature(const std::string& feature_name, const view_index& reference_view);
+	/// Append point to last added feature, with higher view index than its existing points.
+	void add_point(const view_index& idx, const feature_point&);
+
+	void reserve(std::size_t features_count, std::size_t points_count);
+	void shrink_to_fit();
+};
+
+
+flat_image_correspondences to_flat_image_correspondences(const image_correspondences&);
+flat_image_correspondences to_flat_image_correspondences(const mapped_image_correspondences&);
+image_correspondences to_image_correspondences(const flat_image_correspondences&);
+binary_image_correspondences_data to_binary_image_correspondences_data(const flat_image_correspondences&);
+
+std::vector<view_index> get_reference_views(const flat_image_correspondences&);
+std::vector<view_index> get_all_views(const flat_image_correspondences&);
+flat_image_correspondences image_correspondences_with_reference(const flat_image_correspondences&, const view_index& reference_view);
+
+flat_image_correspondences undistort(const flat_image_correspondences&, const intrinsics&);
+
+feature_points feature_points_for_view(const flat_image_correspondences& cors, view_index idx, bool is_distorted = true);
+feature_points undistorted_feature_points_for_view(const flat_image_correspondences& cors, view_index idx, const intrinsics&);
+
+void export_flat_image_correspondences(const flat_image_correspondences& cors, const std::string& filename);
+flat_image_correspondences import_flat_image_correspondences(const std::string& filename);
+
+flat_image_correspondences flat_image_correspondences_arg();
+
+}
+
+#endif
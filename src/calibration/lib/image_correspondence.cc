@@ -1,4 +1,5 @@
 #include "image_correspondence.h"
+#include "binary_image_correspondences.h"
 #include "../../lib/string.h"
 #include "../../lib/assert.h"
 #include <fstream>
@@ -71,54 +72,94 @@ json encode_image_correspondences(const image_correspondences& cors) {
 }
 
 
-void export_binary_image_correspondences(const image_correspondences& cors, const std::string& filename) {
-	std::ofstream str(filename, std::ios_base::binary);
-	
-	auto write = [&str](const auto& val) {
-		const auto* ptr = reinterpret_cast<const std::ostream::char_type*>(&val);
-		str.write(ptr, sizeof(val));
-	};
-	auto write_buffer = [&str](const void* buf, std::size_t sz) {
-		str.write(static_cast<const std::ostream::char_type*>(buf), sz);
-	};
+void export_json_image_correspondences(const image_correspondences& cors, const std::string& filename) {
+	// write JSON text directly, with only the DOM for one point at a time
+	std::ofstream output(filename);
+	auto str = [](const std::string& s) { return json(s).dump(); };
+	const std::string indent = "    ";
 	
-	auto uint8 = [&write](std::uint8_t val) { write(val); };
-	auto int32 = [&write](std::int32_t val) { write(val); };
-	auto float64 = [&write](double val) { write(val); };
-	
-	auto short_string = [&](const std::string& str) {
-		Assert(str.length() <= 255);
-		uint8(str.length());
-		write_buffer(str.data(), str.length());
-	};
-	auto view_idx = [&](const view_index& idx) {
-		int32(idx.x);
-		int32(idx.y);
-	};
-	
-	int32(binary_cors_magic_);
-	short_string(cors.dataset_group);
-	int32(cors.features.size());
+	output << "{\n";
+	if(! cors.dataset_group.empty())
+		output << indent << "\"dataset_group\": " << str(cors.dataset_group) << ",\n";
+	output << indent << "\"features\": {";
+	bool first_feature = true;
 	for(const auto& kv : cors.features) {
 		const std::string& feature_name = kv.first;
 		const image_correspondence_feature& feature = kv.second;
-		short_string(feature_name);
-		view_idx(feature.reference_view);
-		int32(feature.points.size());
+		output << (first_feature ? "\n" : ",\n");
+		first_feature = false;
+		
+		output << indent << indent << str(feature_name) << ": {\n";
+		output << indent << indent << indent << "\"points\": {";
+		bool first_point = true;
 		for(const auto& kv2 : feature.points) {
 			const view_index& idx = kv2.first;
-			const feature_point& fpoint = kv2.second;
-			view_idx(idx);
-			float64(fpoint.position[0]);
-			float64(fpoint.position[1]);
-			float64(fpoint.depth);
-			float64(fpoint.weight);
+			const feature_point& pt = kv2.second;
+			output << (first_point ? "\n" : ",\n");
+			first_point = false;
+			output << indent << indent << indent << indent << str(encode_view_index(idx)) << ": " << encode_feature_point(pt).dump();
 		}
+		if(! first_point) output << "\n" << indent << indent << indent;
+		output << "}";
+		if(feature.reference_view)
+			output << ",\n" << indent << indent << indent << "\"reference_view\": " << str(encode_view_index(feature.reference_view));
+		output << "\n" << indent << indent << "}";
 	}
+	if(! first_feature) output << "\n" << indent;
+	output << "}\n}\n";
+}
+
+
+image_correspondences import_json_image_correspondences(const std::string& filename) {
+	// fill image_correspondences from parser events, and discard each point value once decoded,
+	// so the DOM of the whole file never gets built
+	image_correspondences cors;
+	image_correspondence_feature* feature = nullptr;
+	std::vector<std::string> keys; // keys[d]: current key in object at depth d
+	auto key = [&keys](int depth) -> const std::string& {
+		static const std::string none;
+		return (depth < keys.size() ? keys[depth] : none);
+	};
+	
+	using event_t = json::parse_event_t;
+	import_json_file(filename, [&](int depth, event_t event, json& parsed) -> bool {
+		if(event == event_t::key) {
+			if(keys.size() <= depth) keys.resize(depth + 1);
+			keys[depth] = parsed.get<std::string>();
+			if(depth == 2 && key(1) == "features") feature = &cors.features[keys[2]];
+			return true;
+		}
+		
+		if(depth == 1 && event == event_t::value && key(1) == "dataset_group") {
+			cors.dataset_group = parsed.get<std::string>();
+			return false;
+		} else if(depth == 3 && event == event_t::value && key(1) == "features" && key(3) == "reference_view") {
+			feature->reference_view = decode_view_index(parsed.get<std::string>());
+			return false;
+		} else if(depth == 4 && event == event_t::object_end && key(1) == "features" && key(3) == "points") {
+			feature->points[decode_view_index(key(4))] = decode_feature_point(parsed);
+			return false;
+		} else if(depth >= 1 && depth <= 3 && event == event_t::object_end) {
+			return false; // points, feature and features objects, already consumed
+		} else {
+			return true;
+		}
+	});
+	
+	return cors;
+}
+
+
+void export_binary_image_correspondences(const image_correspondences& cors, const std::string& filename) {
+	export_binary_image_correspondences_v2(to_binary_image_correspondences_data(cors), filename);
 }
 
 
 image_correspondences import_binary_image_correspondences(const std::string& filename) {
+	if(is_binary_image_correspondences_v2(filename))
+		return to_image_correspondences(mapped_image_correspondences(filename));
+	
+	// legacy (v1) format: stream of per-point records
 	std::ifstream str(filename, std::ios_base::binary);
 	
 	auto read = [&str](auto& val) {
@@ -173,7 +214,7 @@ image_correspondences import_binary_image_correspondences(const std::string& fil
 void export_image_corresponcences(const image_correspondences& cors, const std::string& filename) {
 	if(file_name_extension(filename) == "json") {
 		std::cout << "exporting image correspondences to JSON" << std::endl;
-		export_json_file(encode_image_correspondences(cors), filename);
+		export_json_image_correspondences(cors, filename);
 	} else if(file_name_extension(filename) == "bin") {
 		std::cout << "exporting image correspondences to binary" << std::endl;
 		export_binary_image_correspondences(cors, filename);
@@ -183,7 +224,7 @@ void export_image_corresponcences(const image_correspondences& cors, const std::
 }
 
 image_correspondences import_image_correspondences(const std::string& filename) {
-	if(file_name_extension(filename) == "json") return decode_image_correspondences(import_json_file(filename));
+	if(file_name_extension(filename) == "json") return import_json_image_correspondences(filename);
 	else if(file_name_extension(filename) == "bin") return import_binary_image_correspondences(filename);
 	else throw std::runtime_error("unknown filename extension for image correspondences (need .json or .bin)");
 }
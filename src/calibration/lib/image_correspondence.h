@@ -57,6 +57,9 @@ json encode_image_correspondence_feature(const image_correspondence_feature&);
 image_correspondences decode_image_correspondences(const json&);
 json encode_image_correspondences(const image_correspondences&);
 
+void export_json_image_correspondences(const image_correspondences& cors, const std::string& filename);
+image_correspondences import_json_image_correspondences(const std::string& filename);
+
 void export_binary_image_correspondences(const image_correspondences& cors, const std::string& filename);
 image_correspondences import_binary_image_correspondences(const std::string& filename);
 
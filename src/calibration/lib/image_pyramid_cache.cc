@@ -0,0 +1,119 @@
+#include "image_pyramid_cache.h"
+#include <cstdlib>
+
+namespace tlz {
+
+namespace {
+	const std::size_t default_image_pyramid_cache_size_mb_ = 1024;
+
+	std::size_t pyramid_bytes_(const image_pyramid& pyramid) {
+		// pyramid levels are regions of larger matrices with borders, count the whole allocated buffers
+		std::size_t bytes = 0;
+		for(const cv::Mat& level : pyramid) {
+			cv::Size whole_size;
+			cv::Point offset;
+			level.locateROI(whole_size, offset);
+			bytes += whole_size.area() * level.elemSize();
+		}
+		return bytes;
+	}
+}
+
+
+image_pyramid_cache::image_pyramid_cache(std::size_t capacity) :
+	capacity_(capacity) { }
+
+
+auto image_pyramid_cache::key_(const view_index& idx, const cv::Size& window_size, int levels) -> key_type {
+	return key_type(idx, window_size.width, window_size.height, levels);
+}
+
+
+void image_pyramid_cache::evict_() {
+	while(size_ > capacity_ && ! entries_.empty()) {
+		const entry& lru = entries_.back();
+		size_ -= lru.bytes;
+		index_.erase(lru.key);
+		entries_.pop_back();
+	}
+}
+
+
+image_pyramid_ptr image_pyramid_cache::load(const view_index& idx, const cv::Size& window_size, int levels, const std::function<cv::Mat_<uchar>()>& loader) {
+	key_type key = key_(idx, window_size, levels);
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		auto it = index_.find(key);
+		if(it != index_.end()) {
+			++hits_;
+			entries_.splice(entries_.begin(), entries_, it->second);
+			return it->second->pyramid;
+		}
+		++misses_;
+	}
+
+	// load and build without holding the lock, so that different pyramids can be built in parallel
+	cv::Mat_<uchar> image = loader();
+	if(image.empty()) return nullptr;
+	auto pyramid = std::make_shared<image_pyramid>();
+	cv::buildOpticalFlowPyramid(image, *pyramid, window_size, levels);
+	std::size_t bytes = pyramid_bytes_(*pyramid);
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	auto it = index_.find(key);
+	if(it != index_.end()) return it->second->pyramid; // built concurrently by other thread
+	if(bytes > capacity_) return pyramid;
+	entries_.push_front(entry { key, pyramid, bytes });
+	index_[key] = entries_.begin();
+	size_ += bytes;
+	evict_();
+	return pyramid;
+}
+
+
+bool image_pyramid_cache::contains(const view_index& idx, const cv::Size& window_size, int levels) const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return (index_.count(key_(idx, window_size, levels)) == 1);
+}
+
+
+std::size_t image_pyramid_cache::size() const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return size_;
+}
+
+
+std::size_t image_pyramid_cache::entries_count() const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return entries_.size();
+}
+
+
+std::size_t image_pyramid_cache::hits() const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return hits_;
+}
+
+
+std::size_t image_pyramid_cache::misses() const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return misses_;
+}
+
+
+void image_pyramid_cache::clear() {
+	std::lock_guard<std::mutex> lock(mutex_);
+	entries_.clear();
+	index_.clear();
+	size_ = 0;
+}
+
+
+std::size_t default_image_pyramid_cache_capacity() {
+	const char* size_env = std::getenv("LICORNEA_PYRAMID_CACHE_SIZE");
+	std::size_t size_mb = default_image_pyramid_cache_size_mb_;
+	if(size_env != nullptr) size_mb = std::strtoul(size_env, nullptr, 10);
+	return size_mb * 1024 * 1024;
+}
+
+}
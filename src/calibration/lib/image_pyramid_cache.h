@@ -0,0 +1,70 @@
+#ifndef LICORNEA_IMAGE_PYRAMID_CACHE_H_
+#define LICORNEA_IMAGE_PYRAMID_CACHE_H_
+
+#include "../../lib/common.h"
+#include "../../lib/opencv.h"
+#include <vector>
+#include <list>
+#include <map>
+#include <tuple>
+#include <mutex>
+#include <memory>
+#include <functional>
+
+namespace tlz {
+
+/// Optical flow image pyramid, as built by `cv::buildOpticalFlowPyramid`.
+using image_pyramid = std::vector<cv::Mat>;
+using image_pyramid_ptr = std::shared_ptr<const image_pyramid>;
+
+/// Thread-safe least-recently-used cache of optical flow image pyramids of dataset views.
+/** Entries are keyed by view index, window size and number of pyramid levels, and evicted once their total size
+ ** exceeds the capacity in bytes. Pyramids are shared and immutable, so evicted pyramids remain valid for as long
+ ** as callers hold on to them. A capacity of zero disables caching. */
+class image_pyramid_cache {
+private:
+	using key_type = std::tuple<view_index, int, int, int>;
+
+	struct entry {
+		key_type key;
+		image_pyramid_ptr pyramid;
+		std::size_t bytes;
+	};
+	using entries_list = std::list<entry>;
+
+	mutable std::mutex mutex_;
+	entries_list entries_; // most recently used first
+	std::map<key_type, entries_list::iterator> index_;
+	std::size_t capacity_;
+	std::size_t size_ = 0;
+	std::size_t hits_ = 0;
+	std::size_t misses_ = 0;
+
+	static key_type key_(const view_index&, const cv::Size& window_size, int levels);
+	void evict_();
+
+public:
+	explicit image_pyramid_cache(std::size_t capacity);
+	image_pyramid_cache(const image_pyramid_cache&) = delete;
+	image_pyramid_cache& operator=(const image_pyramid_cache&) = delete;
+
+	/// Get pyramid of view, or build it from the gray image returned by `loader` and insert it if not in cache.
+	/** Returns null if `loader` returns an empty image. */
+	image_pyramid_ptr load(const view_index&, const cv::Size& window_size, int levels, const std::function<cv::Mat_<uchar>()>& loader);
+
+	bool contains(const view_index&, const cv::Size& window_size, int levels) const;
+
+	std::size_t capacity() const { return capacity_; }
+	std::size_t size() const;
+	std::size_t entries_count() const;
+	std::size_t hits() const;
+	std::size_t misses() const;
+	void clear();
+};
+
+/// Default capacity in bytes, from `LICORNEA_PYRAMID_CACHE_SIZE` environment variable (in MB).
+std::size_t default_image_pyramid_cache_capacity();
+
+}
+
+#endif
@@ -0,0 +1,32 @@
+#include "lk_tracker.h"
+#include <stdexcept>
+
+namespace tlz {
+
+namespace {
+	bool has_window_borders_(const cv::Mat& level, const cv::Size& window_size) {
+		cv::Size whole_size;
+		cv::Point offset;
+		level.locateROI(whole_size, offset);
+		return (offset.x >= window_size.width) && (offset.y >= window_size.height)
+			&& (offset.x + level.cols + window_size.width <= whole_size.width)
+			&& (offset.y + level.rows + window_size.height <= whole_size.height);
+	}
+}
+
+
+int optical_flow_pyramid_max_level(const image_pyramid& pyramid, const cv::Size& window_size) {
+	if(pyramid.empty() || pyramid.size() % 2 != 0)
+		throw std::invalid_argument("optical flow pyramid must have image and derivatives on each level");
+	for(std::ptrdiff_t i = 0; i < pyramid.size(); i += 2) {
+		const cv::Mat& img = pyramid[i];
+		const cv::Mat& deriv = pyramid[i + 1];
+		if(img.type() != CV_8UC1 || deriv.type() != CV_16SC2 || img.size() != deriv.size())
+			throw std::invalid_argument("optical flow pyramid must have gray images and their Scharr derivatives");
+		if(! has_window_borders_(img, window_size) || ! has_window_borders_(deriv, window_size))
+			throw std::invalid_argument("optical flow pyramid must have borders of at least the window size");
+	}
+	return pyramid.size()/2 - 1;
+}
+
+}
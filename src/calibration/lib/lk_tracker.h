@@ -0,0 +1,103 @@
+#ifndef LICORNEA_LK_TRACKER_H_
+#define LICORNEA_LK_TRACKER_H_
+
+#include "../../lib/common.h"
+#include "../../lib/opencv.h"
+#include "image_pyramid_cache.h"
+#include <vector>
+#include <cstdint>
+#if defined(__AVX2__) && ! defined(LICORNEA_LK_TRACKER_SCALAR)
+#define LICORNEA_LK_TRACKER_AVX2
+#include <immintrin.h>
+#endif
+
+namespace tlz {
+
+/// Parameters of the pyramidal Lucas-Kanade tracker, same as for `cv::calcOpticalFlowPyrLK`.
+struct lk_tracker_parameters {
+	int max_level = 3;
+	int max_iterations = 30;
+	double epsilon = 0.01;
+	double min_eigen_threshold = 1e-4;
+};
+
+/// Check that pyramid was built by `cv::buildOpticalFlowPyramid` with derivatives, and with borders for window size.
+/** Returns its highest level. Throws `std::invalid_argument` otherwise. */
+int optical_flow_pyramid_max_level(const image_pyramid&, const cv::Size& window_size);
+
+/// Name of the instruction set used by lk_tracker, depending on compilation flags.
+/** Defining `LICORNEA_LK_TRACKER_SCALAR` selects the scalar code even when the compiler targets AVX2. */
+inline const char* lk_tracker_instruction_set() {
+#ifdef LICORNEA_LK_TRACKER_AVX2
+	return "AVX2";
+#else
+	return "scalar";
+#endif
+}
+
+
+/// Pyramidal Lucas-Kanade optical flow tracker, for small sets of features and fixed window size.
+/** Produces the same results as `cv::calcOpticalFlowPyrLK`, up to floating point rounding. The window patches of the
+ ** features on the origin image, and their gradients, are extracted once by prepare(). The resulting origin can then be tracked
+ ** into several destination images. The inner loops run over the window pixels with fixed bounds, and use AVX2 when the
+ ** compiler targets it. Pyramids must include derivatives, as built by the image_pyramid_cache. */
+template<int Window_width, int Window_height>
+class lk_tracker {
+	static_assert(Window_width > 0 && Window_height > 0, "window size must be positive");
+
+private:
+	static constexpr int window_area_ = Window_width * Window_height;
+
+	struct feature_ {
+		float A11, A12, A22;
+		float inv_D;
+		bool valid;
+	};
+	struct level_ {
+		std::vector<feature_> features;
+		std::vector<std::int16_t> patches; // for each feature: image, x gradient, y gradient patches
+	};
+
+	lk_tracker_parameters parameters_;
+	double epsilon_sq_;
+
+	static const std::int16_t* patch_(const level_& lvl, std::ptrdiff_t feature) {
+		return lvl.patches.data() + feature * 3 * window_area_;
+	}
+	static void mismatch_(const std::int16_t* patch, const uchar* dest, std::ptrdiff_t dest_step, const int* weights, float& b1, float& b2);
+	static int error_(const std::int16_t* patch, const uchar* dest, std::ptrdiff_t dest_step, const int* weights);
+
+public:
+	/// Features on origin image, prepared for tracking.
+	class origin {
+		friend class lk_tracker;
+
+	private:
+		std::vector<cv::Point2f> positions_;
+		std::vector<level_> levels_;
+
+	public:
+		std::size_t features_count() const { return positions_.size(); }
+		int max_level() const { return levels_.size() - 1; }
+		const std::vector<cv::Point2f>& positions() const { return positions_; }
+	};
+
+	static cv::Size window_size() { return cv::Size(Window_width, Window_height); }
+
+	explicit lk_tracker(const lk_tracker_parameters& = lk_tracker_parameters());
+
+	const lk_tracker_parameters& parameters() const { return parameters_; }
+
+	/// Extract window patches of features at `positions` on all levels of origin pyramid.
+	origin prepare(const image_pyramid& origin_pyramid, const std::vector<cv::Point2f>& positions) const;
+
+	/// Track features of `orig` into destination pyramid.
+	/** Outputs are as for `cv::calcOpticalFlowPyrLK`, with `errors` being the mean absolute difference of the windows. */
+	void track(const origin& orig, const image_pyramid& dest_pyramid, std::vector<cv::Point2f>& dest_positions, std::vector<uchar>& status, std::vector<float>& errors) const;
+};
+
+}
+
+#include "lk_tracker.tcc"
+
+#endif
@@ -0,0 +1,357 @@
+#include <cmath>
+#include <cfloat>
+#include <cstring>
+#include <algorithm>
+
+namespace tlz {
+
+namespace lk_tracker_detail {
+	// fixed point arithmetic as in OpenCV's LKTrackerInvoker
+	constexpr int weight_bits = 14; // bilinear weights
+	constexpr int image_shift = weight_bits - 5; // interpolated image values are scaled by 32
+	constexpr float scale = 1.0f / (1 << 20); // of the matrix and vector sums
+
+	inline int descale(int x, int n) {
+		return (x + (1 << (n - 1))) >> n;
+	}
+
+	inline void bilinear_weights(const cv::Point2f& pt, const cv::Point2i& ipt, int* weights) {
+		float a = pt.x - ipt.x, b = pt.y - ipt.y;
+		weights[0] = cvRound((1.0f - a) * (1.0f - b) * (1 << weight_bits));
+		weights[1] = cvRound(a * (1.0f - b) * (1 << weight_bits));
+		weights[2] = cvRound((1.0f - a) * b * (1 << weight_bits));
+		weights[3] = (1 << weight_bits) - weights[0] - weights[1] - weights[2];
+	}
+
+	inline int interpolate(const uchar* p, std::ptrdiff_t step, const int* weights) {
+		return descale(p[0]*weights[0] + p[1]*weights[1] + p[step]*weights[2] + p[step + 1]*weights[3], image_shift);
+	}
+
+	inline bool out_of_window_bounds(const cv::Point2i& ipt, const cv::Size& window_size, const cv::Mat& img) {
+		return (ipt.x < -window_size.width) || (ipt.x >= img.cols) || (ipt.y < -window_size.height) || (ipt.y >= img.rows);
+	}
+
+#ifdef LICORNEA_LK_TRACKER_AVX2
+	// pixels p[0], p[1], p[1], p[2], ..., p[7], p[8], as 8-bit
+	inline __m128i load_pixel_pairs8(const uchar* p) {
+		__m128i a = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p));
+		__m128i b = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p + 1));
+		return _mm_unpacklo_epi8(a, b);
+	}
+
+	// pixels p[0], p[1], ..., p[3], p[4], as 8-bit
+	inline __m128i load_pixel_pairs4(const uchar* p) {
+		std::int32_t a, b;
+		std::memcpy(&a, p, 4);
+		std::memcpy(&b, p + 1, 4);
+		return _mm_unpacklo_epi8(_mm_cvtsi32_si128(a), _mm_cvtsi32_si128(b));
+	}
+
+	// weights pairs for top or bottom pixels pairs, in 16-bit
+	inline __m256i weights_pair8(int w0, int w1) {
+		return _mm256_set1_epi32((w1 << 16) | (w0 & 0xffff));
+	}
+
+	// interpolate at p[0], ..., p[7], in 32-bit
+	inline __m256i interpolate8(const uchar* p, std::ptrdiff_t step, __m256i weights_top, __m256i weights_bottom) {
+		__m256i top = _mm256_madd_epi16(_mm256_cvtepu8_epi16(load_pixel_pairs8(p)), weights_top);
+		__m256i bottom = _mm256_madd_epi16(_mm256_cvtepu8_epi16(load_pixel_pairs8(p + step)), weights_bottom);
+		__m256i sum = _mm256_add_epi32(_mm256_add_epi32(top, bottom), _mm256_set1_epi32(1 << (image_shift - 1)));
+		return _mm256_srai_epi32(sum, image_shift);
+	}
+
+	// interpolate at p[0], ..., p[3], in 32-bit
+	inline __m128i interpolate4(const uchar* p, std::ptrdiff_t step, __m256i weights_top, __m256i weights_bottom) {
+		__m128i top = _mm_madd_epi16(_mm_cvtepu8_epi16(load_pixel_pairs4(p)), _mm256_castsi256_si128(weights_top));
+		__m128i bottom = _mm_madd_epi16(_mm_cvtepu8_epi16(load_pixel_pairs4(p + step)), _mm256_castsi256_si128(weights_bottom));
+		__m128i sum = _mm_add_epi32(_mm_add_epi32(top, bottom), _mm_set1_epi32(1 << (image_shift - 1)));
+		return _mm_srai_epi32(sum, image_shift);
+	}
+
+	// interpolate at p[0], ..., p[15], in 16-bit
+	inline __m256i interpolate16(const uchar* p, std::ptrdiff_t step, __m256i weights_top, __m256i weights_bottom) {
+		__m256i packed = _mm256_packs_epi32(interpolate8(p, step, weights_top, weights_bottom), interpolate8(p + 8, step, weights_top, weights_bottom));
+		return _mm256_permute4x64_epi64(packed, _MM_SHUFFLE(3, 1, 2, 0)); // packs works per 128-bit lane
+	}
+
+	inline __m256i load16_epi16(const std::int16_t* p) {
+		return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+	}
+
+	inline __m256i load8_epi16(const std::int16_t* p) {
+		return _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+	}
+
+	inline __m128i load4_epi16(const std::int16_t* p) {
+		return _mm_cvtepi16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)));
+	}
+
+	inline float horizontal_sum(__m256 v8, __m128 v4) {
+		__m128 v = _mm_add_ps(_mm_add_ps(_mm256_castps256_ps128(v8), _mm256_extractf128_ps(v8, 1)), v4);
+		v = _mm_hadd_ps(v, v);
+		v = _mm_hadd_ps(v, v);
+		return _mm_cvtss_f32(v);
+	}
+
+	inline int horizontal_sum(__m256i v8, __m128i v4) {
+		__m128i v = _mm_add_epi32(_mm_add_epi32(_mm256_castsi256_si128(v8), _mm256_extracti128_si256(v8, 1)), v4);
+		v = _mm_hadd_epi32(v, v);
+		v = _mm_hadd_epi32(v, v);
+		return _mm_cvtsi128_si32(v);
+	}
+#endif
+}
+
+
+template<int Window_width, int Window_height>
+lk_tracker<Window_width, Window_height>::lk_tracker(const lk_tracker_parameters& param) :
+	parameters_(param)
+{
+	parameters_.max_iterations = std::min(std::max(parameters_.max_iterations, 0), 100);
+	parameters_.epsilon = std::min(std::max(parameters_.epsilon, 0.0), 10.0);
+	epsilon_sq_ = parameters_.epsilon * parameters_.epsilon;
+}
+
+
+template<int Window_width, int Window_height>
+void lk_tracker<Window_width, Window_height>::mismatch_(const std::int16_t* patch, const uchar* dest, std::ptrdiff_t dest_step, const int* weights, float& b1, float& b2) {
+	using namespace lk_tracker_detail;
+	const std::int16_t* img = patch;
+	const std::int16_t* grad_x = patch + window_area_;
+	const std::int16_t* grad_y = patch + 2*window_area_;
+	float sum1 = 0.0, sum2 = 0.0;
+
+#ifdef LICORNEA_LK_TRACKER_AVX2
+	__m256i weights_top = weights_pair8(weights[0], weights[1]);
+	__m256i weights_bottom = weights_pair8(weights[2], weights[3]);
+	__m256 sum1_8 = _mm256_setzero_ps(), sum2_8 = _mm256_setzero_ps();
+	__m128 sum1_4 = _mm_setzero_ps(), sum2_4 = _mm_setzero_ps();
+#endif
+
+	for(int y = 0; y < Window_height; ++y) {
+		const uchar* dest_row = dest + y*dest_step;
+		int x = 0;
+	#ifdef LICORNEA_LK_TRACKER_AVX2
+		for(; x + 16 <= Window_width; x += 16) {
+			// products of adjacent pixels get added in 32-bit
+			__m256i diff = _mm256_sub_epi16(interpolate16(dest_row + x, dest_step, weights_top, weights_bottom), load16_epi16(img + x));
+			sum1_8 = _mm256_add_ps(sum1_8, _mm256_cvtepi32_ps(_mm256_madd_epi16(diff, load16_epi16(grad_x + x))));
+			sum2_8 = _mm256_add_ps(sum2_8, _mm256_cvtepi32_ps(_mm256_madd_epi16(diff, load16_epi16(grad_y + x))));
+		}
+		for(; x + 8 <= Window_width; x += 8) {
+			__m256i diff = _mm256_sub_epi32(interpolate8(dest_row + x, dest_step, weights_top, weights_bottom), load8_epi16(img + x));
+			sum1_8 = _mm256_add_ps(sum1_8, _mm256_cvtepi32_ps(_mm256_mullo_epi32(diff, load8_epi16(grad_x + x))));
+			sum2_8 = _mm256_add_ps(sum2_8, _mm256_cvtepi32_ps(_mm256_mullo_epi32(diff, load8_epi16(grad_y + x))));
+		}
+		for(; x + 4 <= Window_width; x += 4) {
+			__m128i diff = _mm_sub_epi32(interpolate4(dest_row + x, dest_step, weights_top, weights_bottom), load4_epi16(img + x));
+			sum1_4 = _mm_add_ps(sum1_4, _mm_cvtepi32_ps(_mm_mullo_epi32(diff, load4_epi16(grad_x + x))));
+			sum2_4 = _mm_add_ps(sum2_4, _mm_cvtepi32_ps(_mm_mullo_epi32(diff, load4_epi16(grad_y + x))));
+		}
+	#endif
+		for(; x < Window_width; ++x) {
+			int diff = interpolate(dest_row + x, dest_step, weights) - img[x];
+			sum1 += static_cast<float>(diff * grad_x[x]);
+			sum2 += static_cast<float>(diff * grad_y[x]);
+		}
+		img += Window_width;
+		grad_x += Window_width;
+		grad_y += Window_width;
+	}
+
+#ifdef LICORNEA_LK_TRACKER_AVX2
+	sum1 += horizontal_sum(sum1_8, sum1_4);
+	sum2 += horizontal_sum(sum2_8, sum2_4);
+#endif
+	b1 = sum1 * scale;
+	b2 = sum2 * scale;
+}
+
+
+template<int Window_width, int Window_height>
+int lk_tracker<Window_width, Window_height>::error_(const std::int16_t* patch, const uchar* dest, std::ptrdiff_t dest_step, const int* weights) {
+	using namespace lk_tracker_detail;
+	const std::int16_t* img = patch;
+	int sum = 0;
+
+#ifdef LICORNEA_LK_TRACKER_AVX2
+	__m256i weights_top = weights_pair8(weights[0], weights[1]);
+	__m256i weights_bottom = weights_pair8(weights[2], weights[3]);
+	__m256i sum_8 = _mm256_setzero_si256();
+	__m128i sum_4 = _mm_setzero_si128();
+#endif
+
+	for(int y = 0; y < Window_height; ++y) {
+		const uchar* dest_row = dest + y*dest_step;
+		int x = 0;
+	#ifdef LICORNEA_LK_TRACKER_AVX2
+		for(; x + 8 <= Window_width; x += 8) {
+			__m256i diff = _mm256_sub_epi32(interpolate8(dest_row + x, dest_step, weights_top, weights_bottom), load8_epi16(img + x));
+			sum_8 = _mm256_add_epi32(sum_8, _mm256_abs_epi32(diff));
+		}
+		for(; x + 4 <= Window_width; x += 4) {
+			__m128i diff = _mm_sub_epi32(interpolate4(dest_row + x, dest_step, weights_top, weights_bottom), load4_epi16(img + x));
+			sum_4 = _mm_add_epi32(sum_4, _mm_abs_epi32(diff));
+		}
+	#endif
+		for(; x < Window_width; ++x)
+			sum += std::abs(interpolate(dest_row + x, dest_step, weights) - img[x]);
+		img += Window_width;
+	}
+
+#ifdef LICORNEA_LK_TRACKER_AVX2
+	sum += horizontal_sum(sum_8, sum_4);
+#endif
+	return sum;
+}
+
+
+template<int Window_width, int Window_height>
+auto lk_tracker<Window_width, Window_height>::prepare(const image_pyramid& origin_pyramid, const std::vector<cv::Point2f>& positions) const -> origin {
+	using namespace lk_tracker_detail;
+	int max_level = std::min(parameters_.max_level, optical_flow_pyramid_max_level(origin_pyramid, window_size()));
+	const cv::Point2f half_window((Window_width - 1) * 0.5f, (Window_height - 1) * 0.5f);
+	std::size_t count = positions.size();
+
+	origin orig;
+	orig.positions_ = positions;
+	orig.levels_.resize(max_level + 1);
+
+	for(int level = 0; level <= max_level; ++level) {
+		const cv::Mat& img = origin_pyramid[2*level];
+		const cv::Mat& deriv = origin_pyramid[2*level + 1];
+		std::ptrdiff_t img_step = img.step1();
+		std::ptrdiff_t deriv_step = deriv.step1();
+
+		level_& lvl = orig.levels_[level];
+		lvl.features.resize(count);
+		lvl.patches.resize(count * 3 * window_area_);
+
+		for(std::ptrdiff_t feature = 0; feature < count; ++feature) {
+			feature_& feat = lvl.features[feature];
+			feat.valid = false;
+
+			cv::Point2f pt = positions[feature] * static_cast<float>(1.0 / (1 << level)) - half_window;
+			cv::Point2i ipt(cvFloor(pt.x), cvFloor(pt.y));
+			if(out_of_window_bounds(ipt, window_size(), deriv)) continue;
+			int weights[4];
+			bilinear_weights(pt, ipt, weights);
+
+			std::int16_t* patch_img = lvl.patches.data() + feature * 3 * window_area_;
+			std::int16_t* patch_grad_x = patch_img + window_area_;
+			std::int16_t* patch_grad_y = patch_img + 2*window_area_;
+			float A11 = 0.0, A12 = 0.0, A22 = 0.0;
+
+			for(int y = 0; y < Window_height; ++y) {
+				const uchar* src = img.ptr<uchar>() + (ipt.y + y)*img_step + ipt.x;
+				const short* dsrc = deriv.ptr<short>() + (ipt.y + y)*deriv_step + 2*ipt.x;
+				for(int x = 0; x < Window_width; ++x, dsrc += 2) {
+					int ival = interpolate(src + x, img_step, weights);
+					int ixval = descale(dsrc[0]*weights[0] + dsrc[2]*weights[1] + dsrc[deriv_step]*weights[2] + dsrc[deriv_step + 2]*weights[3], weight_bits);
+					int iyval = descale(dsrc[1]*weights[0] + dsrc[3]*weights[1] + dsrc[deriv_step + 1]*weights[2] + dsrc[deriv_step + 3]*weights[3], weight_bits);
+					*(patch_img++) = ival;
+					*(patch_grad_x++) = ixval;
+					*(patch_grad_y++) = iyval;
+					A11 += static_cast<float>(ixval * ixval);
+					A12 += static_cast<float>(ixval * iyval);
+					A22 += static_cast<float>(iyval * iyval);
+				}
+			}
+			A11 *= scale;
+			A12 *= scale;
+			A22 *= scale;
+
+			float D = A11*A22 - A12*A12;
+			float min_eigenvalue = (A22 + A11 - std::sqrt((A11 - A22)*(A11 - A22) + 4.0f*A12*A12)) / (2 * window_area_);
+			if(min_eigenvalue < parameters_.min_eigen_threshold || D < FLT_EPSILON) continue;
+
+			feat.A11 = A11;
+			feat.A12 = A12;
+			feat.A22 = A22;
+			feat.inv_D = 1.0f / D;
+			feat.valid = true;
+		}
+	}
+
+	return orig;
+}
+
+
+template<int Window_width, int Window_height>
+void lk_tracker<Window_width, Window_height>::track(const origin& orig, const image_pyramid& dest_pyramid, std::vector<cv::Point2f>& dest_positions, std::vector<uchar>& status, std::vector<float>& errors) const {
+	using namespace lk_tracker_detail;
+	int max_level = std::min(orig.max_level(), optical_flow_pyramid_max_level(dest_pyramid, window_size()));
+	const cv::Point2f half_window((Window_width - 1) * 0.5f, (Window_height - 1) * 0.5f);
+	std::size_t count = orig.features_count();
+
+	dest_positions.resize(count);
+	status.assign(count, 1);
+	errors.assign(count, 0.0);
+
+	for(std::ptrdiff_t feature = 0; feature < count; ++feature) {
+		cv::Point2f& result = dest_positions[feature];
+
+		for(int level = max_level; level >= 0; --level) {
+			const level_& lvl = orig.levels_[level];
+			const feature_& feat = lvl.features[feature];
+			const cv::Mat& img = dest_pyramid[2*level];
+			std::ptrdiff_t img_step = img.step1();
+
+			// initial guess from origin position on top level, or from result of previous level
+			cv::Point2f pt;
+			if(level == max_level) pt = orig.positions_[feature] * static_cast<float>(1.0 / (1 << level));
+			else pt = result * 2.0f;
+			result = pt;
+
+			if(! feat.valid) {
+				if(level == 0) status[feature] = 0;
+				continue;
+			}
+
+			const std::int16_t* patch = patch_(lvl, feature);
+			pt -= half_window;
+			cv::Point2f prev_delta;
+			for(int iteration = 0; iteration < parameters_.max_iterations; ++iteration) {
+				cv::Point2i ipt(cvFloor(pt.x), cvFloor(pt.y));
+				if(out_of_window_bounds(ipt, window_size(), img)) {
+					if(level == 0) status[feature] = 0;
+					break;
+				}
+				int weights[4];
+				bilinear_weights(pt, ipt, weights);
+
+				float b1, b2;
+				mismatch_(patch, img.ptr<uchar>() + ipt.y*img_step + ipt.x, img_step, weights, b1, b2);
+
+				cv::Point2f delta((feat.A12*b2 - feat.A22*b1) * feat.inv_D, (feat.A12*b1 - feat.A11*b2) * feat.inv_D);
+				pt += delta;
+				result = pt + half_window;
+
+				if(delta.ddot(delta) <= epsilon_sq_) break;
+				if(iteration > 0 && std::abs(delta.x + prev_delta.x) < 0.01 && std::abs(delta.y + prev_delta.y) < 0.01) {
+					// oscillating: take the middle
+					result -= delta * 0.5f;
+					break;
+				}
+				prev_delta = delta;
+			}
+		}
+
+		if(! status[feature]) continue;
+
+		const cv::Mat& img = dest_pyramid[0];
+		std::ptrdiff_t img_step = img.step1();
+		cv::Point2f pt = result - half_window;
+		cv::Point2i ipt(cvFloor(pt.x), cvFloor(pt.y));
+		if(out_of_window_bounds(ipt, window_size(), img)) {
+			status[feature] = 0;
+			continue;
+		}
+		int weights[4];
+		bilinear_weights(pt, ipt, weights);
+		int error = error_(patch_(orig.levels_[0], feature), img.ptr<uchar>() + ipt.y*img_step + ipt.x, img_step, weights);
+		errors[feature] = static_cast<float>(error) / (32 * window_area_);
+	}
+}
+
+}
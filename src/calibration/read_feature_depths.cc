@@ -39,9 +39,9 @@ int main(int argc, const char* argv[]) {
 		
 		const view_index& view_idx = views[i];
 		
-		std::string depth_filename = datas.view(view_idx).depth_filename();
-		if(! file_exists(depth_filename)) continue;
-		cv::Mat_<ushort> depth = load_depth(depth_filename);
+		dataset_view view = datas.view(view_idx);
+		if(! view.depth_exists()) continue;
+		cv::Mat_<ushort> depth = view.load_depth();
 		
 				
 		for(auto& kv : cors.features) {
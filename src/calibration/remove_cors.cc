@@ -3,22 +3,44 @@
 #include <string>
 #include <cstdlib>
 #include <stdexcept>
+#include <set>
 #include "../lib/args.h"
 #include "../lib/json.h"
 #include "../lib/opencv.h"
 #include "../lib/string.h"
 #include "lib/image_correspondence.h"
+#include "lib/binary_image_correspondences.h"
 
 using namespace tlz;
 
 
 int main(int argc, const char* argv[]) {
 	get_args(argc, argv, "in_cors.json out_cors.json removed_feat1,removed,feat2,...");
-	image_correspondences cors = image_correspondences_arg();
+	std::string in_cors_filename = in_filename_arg();
 	std::string out_cors_filename = out_filename_arg();
 	std::string removed_cors_str = string_arg();
 
 	std::vector<std::string> removed_cors = explode(',', removed_cors_str);
+	
+	if(is_binary_image_correspondences_v2(in_cors_filename) && file_name_extension(out_cors_filename) == "bin") {
+		// copy point blocks of remaining features directly from the mapped file
+		std::cout << "filtering binary image correspondences" << std::endl;
+		mapped_image_correspondences mcors(in_cors_filename);
+		std::set<std::string> removed_cors_set(removed_cors.begin(), removed_cors.end());
+		binary_image_correspondences_data data;
+		data.dataset_group = mcors.dataset_group();
+		for(std::ptrdiff_t feature = 0; feature < mcors.features_count(); ++feature) {
+			std::string feature_name = mcors.feature_name(feature);
+			if(removed_cors_set.count(feature_name) == 1) continue;
+			auto pts = mcors.feature_points(feature);
+			data.add_feature(feature_name, mcors.feature_reference_view(feature), pts.begin(), pts.end());
+		}
+		export_binary_image_correspondences_v2(data, out_cors_filename);
+		return EXIT_SUCCESS;
+	}
+	
+	std::cout << "loading image correspondences" << std::endl;
+	image_correspondences cors = import_image_correspondences(in_cors_filename);
 	for(const std::string& removed_feature_name : removed_cors) {
 		cors.features.erase(removed_feature_name);
 	}
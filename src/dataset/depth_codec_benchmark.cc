@@ -0,0 +1,68 @@
+#include "../lib/args.h"
+#include "../lib/dataset.h"
+#include "../lib/depth_codec.h"
+#include "../lib/opencv.h"
+#include <format.h>
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include <string>
+
+using namespace tlz;
+
+using benchmark_clock = std::chrono::steady_clock;
+
+real elapsed_seconds(benchmark_clock::time_point start) {
+	return std::chrono::duration<real>(benchmark_clock::now() - start).count();
+}
+
+int main(int argc, const char* argv[]) {
+	get_args(argc, argv, "dataset_parameters.json [samples_count=20] [dataset_group]");
+	dataset datas = dataset_arg();
+	int samples_count = int_opt_arg(20);
+	std::string dataset_group_name = string_opt_arg("");
+	
+	dataset_group datag = datas.group(dataset_group_name);
+	
+	std::cout << "loading sample depth maps" << std::endl;
+	std::vector<cv::Mat_<ushort>> samples;
+	auto indices = datas.indices();
+	int stride = std::max<int>(1, indices.size() / samples_count);
+	for(std::ptrdiff_t i = 0; i < indices.size() && samples.size() < samples_count; i += stride) {
+		dataset_view view = datag.view(indices[i]);
+		if(view.depth_exists()) samples.push_back(view.load_depth());
+	}
+	if(samples.empty()) throw std::runtime_error("no depth maps in dataset");
+	
+	real raw_size = 0.0;
+	for(const cv::Mat_<ushort>& sample : samples) raw_size += sample.total() * sizeof(ushort);
+	const real mb = 1024.0 * 1024.0;
+	std::cout << samples.size() << " samples, " << raw_size / mb << " MB uncompressed\n" << std::endl;
+	
+	std::cout << fmt::format("{:<10} {:>10} {:>8} {:>12} {:>12}", "codec", "size (MB)", "ratio", "enc (MB/s)", "dec (MB/s)") << std::endl;
+	for(const std::string& codec_name : depth_codec_names()) {
+		auto codec = make_depth_codec(codec_name);
+		
+		std::vector<std::vector<byte>> encoded(samples.size());
+		real encoded_size = 0.0;
+		benchmark_clock::time_point start = benchmark_clock::now();
+		for(std::ptrdiff_t i = 0; i < samples.size(); ++i) {
+			encoded[i] = codec->encode(samples[i]);
+			encoded_size += encoded[i].size();
+		}
+		real encode_time = elapsed_seconds(start);
+		
+		std::vector<cv::Mat_<ushort>> decoded(samples.size());
+		start = benchmark_clock::now();
+		for(std::ptrdiff_t i = 0; i < samples.size(); ++i)
+			decoded[i] = codec->decode(encoded[i].data(), encoded[i].size());
+		real decode_time = elapsed_seconds(start);
+		
+		for(std::ptrdiff_t i = 0; i < samples.size(); ++i)
+			if(cv::norm(samples[i], decoded[i], cv::NORM_INF) != 0.0)
+				throw std::runtime_error("depth codec " + codec_name + " is not lossless");
+		
+		std::cout << fmt::format("{:<10} {:>10.2f} {:>8.2f} {:>12.1f} {:>12.1f}",
+			codec_name, encoded_size / mb, raw_size / encoded_size, raw_size / mb / encode_time, raw_size / mb / decode_time) << std::endl;
+	}
+}
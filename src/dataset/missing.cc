@@ -20,8 +20,8 @@ int main(int argc, const char* argv[]) {
 	for(view_index idx : datas.indices()) {
 		std::cout << '.' << std::flush;
 		dataset_view view = datag.view(idx);
-		bool have_image = file_exists(view.image_filename());
-		bool have_depth = file_exists(view.depth_filename());
+		bool have_image = view.image_exists();
+		bool have_depth = view.depth_exists();
 		
 		if(! have_image) std::cout << "\nmissing image " << idx << " (" << view.image_filename() << ")\n";
 		if(! have_depth) std::cout << "\nmissing depth " << idx << " (" << view.depth_filename() << ")\n";
@@ -0,0 +1,73 @@
+#include "../lib/args.h"
+#include "../lib/dataset.h"
+#include "../lib/dataset_pack.h"
+#include "../lib/filesystem.h"
+#include "../lib/json.h"
+#include <iostream>
+#include <vector>
+#include <string>
+#include <set>
+
+using namespace tlz;
+
+const std::vector<std::string> packed_filename_formats = {
+	"image_filename_format",
+	"depth_filename_format",
+	"mask_filename_format"
+};
+
+std::string pack_filename_relative_to(const std::string& pack_filename, const std::string& parameters_filename) {
+	std::string pack_dir = filename_parent(pack_filename);
+	if(pack_dir != filename_parent(parameters_filename)) return pack_filename;
+	else if(pack_dir == ".") return pack_filename;
+	else return pack_filename.substr(pack_dir.length());
+}
+
+int main(int argc, const char* argv[]) {
+	get_args(argc, argv, "dataset_parameters.json out_dataset.pack [out_dataset_parameters.json]");
+	dataset datas = dataset_arg();
+	std::string out_pack_filename = out_filename_arg();
+	std::string out_parameters_filename = out_filename_opt_arg("");
+	
+	if(datas.is_packed()) throw std::runtime_error("dataset is already packed");
+	
+	std::vector<std::string> group_names = { "" };
+	const json& parameters = datas.parameters();
+	for(auto it = parameters.begin(); it != parameters.end(); ++it)
+		if(it.value().is_object()) group_names.push_back(it.key());
+	
+	dataset_pack_writer writer(out_pack_filename);
+	std::set<std::string> packed_names;
+	std::size_t missing_count = 0;
+	
+	std::cout << "packing files of " << group_names.size() << " dataset groups" << std::endl;
+	auto indices = datas.indices();
+	for(std::ptrdiff_t i = 0; i < indices.size(); ++i) {
+		if(i % 100 == 0) std::cout << i << " of " << indices.size() << std::endl;
+		
+		for(const std::string& group_name : group_names) {
+			dataset_view view = datas.group(group_name).view(indices[i]);
+			for(const std::string& format_name : packed_filename_formats) {
+				std::string relpath = view.local_relpath(format_name);
+				if(relpath.empty() || packed_names.count(relpath) == 1) continue;
+				
+				std::string filename = view.local_filename(format_name);
+				if(! file_exists(filename)) { ++missing_count; continue; }
+				
+				writer.add_file(relpath, filename);
+				packed_names.insert(relpath);
+			}
+		}
+	}
+	
+	std::cout << "writing index" << std::endl;
+	writer.close();
+	std::cout << packed_names.size() << " files packed, " << missing_count << " missing" << std::endl;
+	
+	if(! out_parameters_filename.empty()) {
+		json out_parameters = parameters;
+		out_parameters["pack_filename"] = pack_filename_relative_to(out_pack_filename, out_parameters_filename);
+		export_json_file(out_parameters, out_parameters_filename);
+		std::cout << "packed dataset parameters saved to " << out_parameters_filename << std::endl;
+	}
+}
@@ -30,22 +30,22 @@ int main(int argc, const char* argv[]) {
 		view_index idx(slider_x.value(), slider_y.value());
 		if(! datas.valid(idx)) return;		
 		
-		std::string image_filename = datag.view(idx).image_filename();
-		std::string depth_filename = datag.view(idx).depth_filename();
+		dataset_view dview = datag.view(idx);
+		std::string image_filename = dview.image_filename();
 
 		view.clear();
 		view.draw_text(cv::Rect(10, 0, sz.width-20, 20), "index: " + encode_view_index(idx));
 		try {
 			if(depth_opacity_slider == 1.0) {
-				cv::Mat_<ushort> depth_img = load_depth(depth_filename);
+				cv::Mat_<ushort> depth_img = dview.load_depth();
 				cv::Mat_<uchar> viz_depth_img = viewer::visualize_depth(depth_img, d_min_slider, d_max_slider);
 				view.draw(cv::Point(0, 20), viz_depth_img);
 			} else if(depth_opacity_slider == 0.0) {
-				cv::Mat_<cv::Vec3b> img = load_texture(image_filename);
+				cv::Mat_<cv::Vec3b> img = dview.load_texture();
 				view.draw(cv::Point(0, 20), img);
 			} else {
-				cv::Mat_<cv::Vec3b> img = load_texture(image_filename);
-				cv::Mat_<ushort> depth_img = load_depth(depth_filename);
+				cv::Mat_<cv::Vec3b> img = dview.load_texture().clone();
+				cv::Mat_<ushort> depth_img = dview.load_depth();
 				cv::Mat_<uchar> viz_depth_img = viewer::visualize_depth(depth_img, d_min_slider, d_max_slider);
 				cv::Mat_<cv::Vec3b> viz_depth_img_col;
 				cv::cvtColor(viz_depth_img, viz_depth_img_col, CV_GRAY2BGR);
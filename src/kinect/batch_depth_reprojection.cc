@@ -0,0 +1,202 @@
+#include "../lib/args.h"
+#include "../lib/dataset.h"
+#include "../lib/view_read_ahead.h"
+#include "../lib/image_cache.h"
+#include "../lib/filesystem.h"
+#include "../lib/opencv.h"
+#include "lib/kinect_reprojection.h"
+#include "lib/densify/depth_densify.h"
+#include "lib/common.h"
+#include <iostream>
+#include <chrono>
+#include <deque>
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <stdexcept>
+#include <algorithm>
+
+using namespace tlz;
+
+namespace {
+
+using batch_clock = std::chrono::steady_clock;
+
+const std::size_t read_ahead_window = 8;
+const int read_threads_count = 4;
+const int write_threads_count = 4;
+const std::size_t max_queued_writes = 8;
+
+
+/// Saves densified depth maps and masks into the dataset, on background threads.
+class depth_writer {
+private:
+	struct job {
+		view_index idx;
+		cv::Mat_<ushort> depth;
+		cv::Mat_<uchar> mask;
+	};
+
+	const dataset& datas_;
+	std::mutex mutex_;
+	std::condition_variable queued_cond_;
+	std::condition_variable dequeued_cond_;
+	std::deque<job> queue_;
+	bool finished_ = false;
+	std::exception_ptr error_;
+	std::vector<std::thread> threads_;
+
+	void write_(const job& jb) {
+		dataset_view view = datas_.view(jb.idx);
+		make_parent_directories(view.depth_filename());
+		view.save_depth(jb.depth);
+		std::string mask_filename = view.mask_filename();
+		if(! mask_filename.empty()) {
+			make_parent_directories(mask_filename);
+			cv::imwrite(mask_filename, jb.mask);
+		}
+	}
+
+	void thread_main_() {
+		for(;;) {
+			job jb;
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				queued_cond_.wait(lock, [&] { return (! queue_.empty() || finished_); });
+				if(queue_.empty()) return;
+				jb = std::move(queue_.front());
+				queue_.pop_front();
+			}
+			dequeued_cond_.notify_one();
+
+			try {
+				write_(jb);
+			} catch(...) {
+				std::lock_guard<std::mutex> lock(mutex_);
+				if(! error_) error_ = std::current_exception();
+			}
+		}
+	}
+
+public:
+	explicit depth_writer(const dataset& datas) : datas_(datas) {
+		for(int i = 0; i < write_threads_count; ++i) threads_.emplace_back(&depth_writer::thread_main_, this);
+	}
+
+	~depth_writer() {
+		if(! threads_.empty()) try { finish(); } catch(...) { }
+	}
+
+	/// Queue depth map and mask for writing. Blocks while too many writes are pending.
+	void write(const view_index& idx, const cv::Mat_<ushort>& depth, const cv::Mat_<uchar>& mask) {
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			dequeued_cond_.wait(lock, [&] { return (queue_.size() < max_queued_writes); });
+			queue_.push_back(job { idx, depth, mask });
+		}
+		queued_cond_.notify_one();
+	}
+
+	/// Wait until all queued writes are done, and rethrow the first error.
+	void finish() {
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			finished_ = true;
+		}
+		queued_cond_.notify_all();
+		for(std::thread& thread : threads_) thread.join();
+		threads_.clear();
+		if(error_) std::rethrow_exception(error_);
+	}
+};
+
+}
+
+
+int main(int argc, const char* argv[]) {
+	get_args(argc, argv, "dataset_parameters.json raw_dataset_group method [overwrite] [=was_flipped]");
+	dataset datas = dataset_arg();
+	std::string raw_group_name = string_arg();
+	std::string method = string_arg();
+	bool overwrite = bool_opt_arg("overwrite");
+	bool was_flipped = bool_opt_arg("was_flipped", true);
+
+	if(datas.is_packed()) throw std::runtime_error("cannot write depth maps into dataset pack");
+	dataset_group raw_datag = datas.group(raw_group_name);
+
+	std::cout << "reading parameters" << std::endl;
+	std::string reprojection_parameters_filename = datas.filepath(raw_datag.parameters().at("kinect_reprojection_parameters_filename"));
+	kinect_reprojection_parameters reprojection_parameters = decode_kinect_reprojection_parameters(import_json_file(reprojection_parameters_filename));
+	kinect_reprojection reproj(reprojection_parameters);
+	std::unique_ptr<depth_densify_base> densifier = make_depth_densify(method);
+
+	std::cout << "collecting views" << std::endl;
+	std::vector<view_index> indices;
+	std::size_t missing_count = 0, existing_count = 0;
+	for(const view_index& idx : datas.indices()) {
+		dataset_view view = datas.view(idx);
+		if(! view.group_view(raw_group_name).depth_exists()) {
+			std::cout << raw_group_name << " depth " << view.group_view(raw_group_name).depth_filename() << " not found, skipping" << std::endl;
+			++missing_count;
+		} else if(! overwrite && view.depth_exists()) {
+			++existing_count;
+		} else {
+			indices.push_back(idx);
+		}
+	}
+	std::cout << indices.size() << " views to process, " << existing_count << " already existing, " << missing_count << " missing" << std::endl;
+
+	// images are used once, so caching them is useless
+	datas.cache().set_capacity(0);
+
+	int components = view_read_ahead::depth;
+	if(densifier->uses_guide()) components |= view_read_ahead::texture;
+	view_read_ahead reader(raw_datag, indices, components, read_ahead_window, read_threads_count);
+	depth_writer writer(datas);
+
+	std::cout << "reprojecting depth maps" << std::endl;
+	batch_clock::time_point start = batch_clock::now();
+	std::size_t processed_count = 0;
+	cv::Mat_<real> out_depth_real(texture_height, texture_width);
+	read_ahead_view raw_view;
+	while(reader.next(raw_view)) {
+		if(raw_view.depth.empty()) throw std::runtime_error("could not load raw depth map");
+
+		// read-ahead images may share data with the image cache, so flip them into new matrices
+		cv::Mat_<ushort> in_depth;
+		if(was_flipped) cv::flip(raw_view.depth, in_depth, 1);
+		else in_depth = raw_view.depth;
+
+		if(densifier->uses_guide()) {
+			if(raw_view.texture.empty()) throw std::runtime_error("could not load raw image, needed as guide");
+			cv::Mat_<cv::Vec3b> guide;
+			if(was_flipped) cv::flip(raw_view.texture, guide, 1);
+			else guide = raw_view.texture;
+			densifier->set_guide(guide);
+		}
+
+		cv::Mat_<ushort> out_depth;
+		cv::Mat_<uchar> out_mask;
+		densifier->densify_ir(reproj, in_depth, out_depth_real, out_mask);
+		out_depth = out_depth_real;
+		if(was_flipped) {
+			cv::flip(out_depth, out_depth, 1);
+			cv::flip(out_mask, out_mask, 1);
+		}
+
+		writer.write(raw_view.idx, out_depth, out_mask);
+
+		++processed_count;
+		if(processed_count % 100 == 0 || processed_count == indices.size()) {
+			real elapsed = std::chrono::duration<real>(batch_clock::now() - start).count();
+			std::cout << processed_count << " of " << indices.size() << " views, " << processed_count / elapsed << " frames/s" << std::endl;
+		}
+	}
+
+	writer.finish();
+	real elapsed = std::chrono::duration<real>(batch_clock::now() - start).count();
+	std::cout << "done, " << processed_count << " views in " << elapsed << " s, " << processed_count / std::max(elapsed, 1e-9) << " frames/s" << std::endl;
+}
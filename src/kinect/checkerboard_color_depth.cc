@@ -34,7 +34,7 @@ int main(int argc, const char* argv[]) {
 	kinect_reprojection_parameters reprojection_parameters = decode_kinect_reprojection_parameters(import_json_file(reprojection_parameters_filename));
 	const intrinsics& color_intr = reprojection_parameters.color_intrinsics;
 	
-	grabber grab(grabber::depth | grabber::color);
+	auto grab = make_grabber(grabber::depth | grabber::color);
 
 	viewer view(754+754, 424+30+30+(have_out_stat?30:0));
 	auto& min_d = view.add_int_slider("depth min ", 0, 0, 20000);
@@ -46,25 +46,26 @@ int main(int argc, const char* argv[]) {
 
 	std::vector<checkerboard_pixel_depth_sample> collected_pixel_depths;
 
+	kinect_reprojection reprojection(reprojection_parameters);
+	kinect_reprojection_parameters reprojection_parameters_no_iroff = reprojection_parameters;
+	reprojection_parameters_no_iroff.ir_depth_offset = kinect_reprojection_parameters::depth_offset_polyfit();
+	kinect_reprojection reprojection_no_iroff(reprojection_parameters_no_iroff);
+
 	auto densifier = make_depth_densify("fast");
 	cv::Mat_<real> reprojected_depth(1080, 1920);
 
 	std::cout << "running viewer... (esc to end)" << std::endl; 
 	bool running = true;
 	while(running) {
-		kinect_reprojection reprojection(reprojection_parameters);
-		
-		grab.grab();
+		if(! grab->grab()) break;
 		view.clear();
 				
-		cv::Mat_<cv::Vec3b> color = grab.get_color_frame();
-		cv::Mat_<real> depth = grab.get_depth_frame();
+		cv::Mat_<cv::Vec3b> color = grab->get_color_frame();
+		cv::Mat_<real> depth = grab->get_depth_frame();
 		
 		// reproject depth
-		if(used_depth_mode == depth_mode::reprojected_no_iroff)
-			reprojection.parameters().ir_depth_offset =  kinect_reprojection_parameters::depth_offset_polyfit();
-
-		auto samples = reprojection.reproject_ir_to_color_samples(depth, depth, true);
+		const kinect_reprojection& used_reprojection = (used_depth_mode == depth_mode::reprojected_no_iroff ? reprojection_no_iroff : reprojection);
+		auto samples = used_reprojection.reproject_ir_to_color_samples(depth, depth, true);
 		if(used_depth_mode == depth_mode::original)
 			for(auto& sample : samples) sample.color_depth = sample.ir_depth;
 		
@@ -130,7 +131,7 @@ int main(int argc, const char* argv[]) {
 			view.draw_text(cv::Rect(20, 424+60, 754+754-40, 30), "collected samples: " + std::to_string(collected_pixel_depths.size()), viewer::right);
 
 		
-		grab.release();
+		grab->release();
 
 		int keycode;
 		running = view.show(keycode);
@@ -21,7 +21,7 @@ int main(int argc, const char* argv[]) {
 	real square_width = real_arg();
 	intrinsics ir_intr = intrinsics_arg();
 	
-	grabber grab(grabber::depth | grabber::ir);
+	auto grab = make_grabber(grabber::depth | grabber::ir);
 
 	viewer view(512+512, 424+70);
 	auto& min_ir = view.add_int_slider("ir min", 0, 0x0000, 0xffff);
@@ -33,11 +33,11 @@ int main(int argc, const char* argv[]) {
 	std::cout << "running viewer... (esc to end)" << std::endl; 
 	bool running = true;
 	while(running) {
-		grab.grab();
+		if(! grab->grab()) break;
 		view.clear();
 				
-		cv::Mat_<float> depth = grab.get_depth_frame(true);
-		cv::Mat_<uchar> ir = grab.get_ir_frame(min_ir.value(), max_ir.value(), true);
+		cv::Mat_<float> depth = grab->get_depth_frame(true);
+		cv::Mat_<uchar> ir = grab->get_ir_frame(min_ir.value(), max_ir.value(), true);
 
 		checkerboard ir_chk = detect_ir_checkerboard(ir, cols, rows, square_width);
 
@@ -80,7 +80,7 @@ int main(int argc, const char* argv[]) {
 		view.draw_text(cv::Rect(512, 424+30, 512, 30), std::to_string(avg_measured_depth-calculated_parallel_depth) + " mm", viewer::center);
 		view.draw_text(cv::Rect(0, 424+40, 512+512, 30), std::to_string(avg_measured_depth-avg_calculated_depth) + " mm", viewer::center);
 
-		grab.release();
+		grab->release();
 
 		running = view.show();
 	}
@@ -21,7 +21,7 @@ int main(int argc, const char* argv[]) {
 	int rows = int_arg();
 	std::string out_chk_samples_filename = out_filename_arg();
 		
-	grabber grab(grabber::depth | grabber::ir);
+	auto grab = make_grabber(grabber::depth | grabber::ir);
 
 	viewer view(512+512, 424+30);
 	auto& min_ir = view.add_int_slider("ir min", 0, 0x0000, 0xffff);
@@ -44,11 +44,11 @@ int main(int argc, const char* argv[]) {
 	std::cout << "running viewer... (enter to capture samples, esc to end)" << std::endl; 
 	bool running = true;
 	while(running) {
-		grab.grab();
+		if(! grab->grab()) break;
 		view.clear();
 				
-		cv::Mat_<float> depth = grab.get_depth_frame();
-		cv::Mat_<uchar> ir = grab.get_ir_frame(min_ir.value(), max_ir.value());
+		cv::Mat_<float> depth = grab->get_depth_frame();
+		cv::Mat_<uchar> ir = grab->get_ir_frame(min_ir.value(), max_ir.value());
 
 		has_sample = false;
 
@@ -67,7 +67,7 @@ int main(int argc, const char* argv[]) {
 		view.draw_text(cv::Rect(20, 424, 512+512-20, 30), std::string("(a) autocollect is ") + (autocollect ? "ON" : "off"), viewer::left);
 		view.draw_text(cv::Rect(0, 424, 512+512-20, 30), std::to_string(samples.size()) + " checkerboard samples (" + std::to_string(total_pixels) + " pixels total)", viewer::right);
 		
-		grab.release();
+		grab->release();
 
 		int keycode = 0;
 		running = view.show(keycode);
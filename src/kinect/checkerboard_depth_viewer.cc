@@ -20,7 +20,7 @@ int main(int argc, const char* argv[]) {
 	real square_width = real_arg();
 	intrinsics ir_intr = intrinsics_arg();
 		
-	grabber grab(grabber::depth | grabber::ir);
+	auto grab = make_grabber(grabber::depth | grabber::ir);
 
 	viewer view(512+512, 424+2*30);
 	auto& min_ir = view.add_int_slider("ir min", 0, 0x0000, 0xffff);
@@ -32,11 +32,11 @@ int main(int argc, const char* argv[]) {
 	std::cout << "running viewer... (esc to end)" << std::endl; 
 	bool running = true;
 	while(running) {
-		grab.grab();
+		if(! grab->grab()) break;
 		view.clear();
 				
-		cv::Mat_<float> depth = grab.get_depth_frame();
-		cv::Mat_<uchar> ir = grab.get_ir_frame(min_ir.value(), max_ir.value());
+		cv::Mat_<float> depth = grab->get_depth_frame();
+		cv::Mat_<uchar> ir = grab->get_ir_frame(min_ir.value(), max_ir.value());
 
 		checkerboard ir_chk = detect_ir_checkerboard(ir, cols, rows, square_width);
 
@@ -77,7 +77,7 @@ int main(int argc, const char* argv[]) {
 		view.draw_text(cv::Rect(20+430, 424+30, 512+512-10, 30), "count: " + std::to_string(count), viewer::left);
 		view.draw_text(cv::Rect(20+570, 424+30, 512+512-10, 30), "reprojection err: " + std::to_string(reprojection_error), viewer::left);
 		
-		grab.release();
+		grab->release();
 
 		running = view.show();
 	}
@@ -103,7 +103,8 @@ int main(int argc, const char* argv[]) {
 
 	} else {
 		
-		grabber grab(grabber::color | grabber::ir);
+		auto grab = make_grabber(grabber::color | grabber::ir);
+		grab->start_async();
 	
 		viewer view(754+512, 424+30);
 		auto& min_ir = view.add_int_slider("ir min", 0, 0x0000, 0xffff);
@@ -115,21 +116,20 @@ int main(int argc, const char* argv[]) {
 		std::cout << "running viewer... (enter to capture checkerboard, esc to end)" << std::endl; 
 		bool running = true;
 		while(running) {
-			grab.grab();
+			if(! grab->grab()) break;
 			view.clear();
 			
 			checkerboard color_chk, ir_chk;
 			
-			cv::Mat_<cv::Vec3b> color = grab.get_color_frame();
-			cv::Mat_<uchar> ir = grab.get_ir_frame(min_ir.value(), max_ir.value());
-			cv::Mat_<ushort> ir_orig = grab.get_original_ir_frame();
+			cv::Mat_<cv::Vec3b> color = grab->get_color_frame();
+			cv::Mat_<uchar> ir = grab->get_ir_frame(min_ir.value(), max_ir.value());
+			cv::Mat_<ushort> ir_orig = grab->get_original_ir_frame();
 	
 			if(mode == "color" || mode == "both") color_chk = detect_color_checkerboard(color, cols, rows, square_width);
 			if(mode == "ir" || mode == "both") ir_chk = detect_ir_checkerboard(ir, cols, rows, square_width);
 							
 			view.draw(cv::Rect(0, 0, 754, 424), visualize_checkerboard(color, color_chk));
 			view.draw(cv::Rect(754, 0, 512, 424), visualize_checkerboard(ir, ir_chk));
-			grab.release();
 			
 	
 			view.draw_text(cv::Rect(0, 424, 754+512-10, 30), std::to_string(count) + " samples collected", viewer::right);
@@ -164,6 +164,7 @@ int main(int argc, const char* argv[]) {
 					save_correspondences_set();
 				}
 			}
+			grab->release(); // after saving color and ir_orig, which may refer to grabbed frame
 		}
 		
 		if(! autosave) {
@@ -24,16 +24,16 @@ int main(int argc, const char* argv[]) {
 	real square_width = real_arg();
 	intrinsics color_intr = intrinsics_arg();
 		
-	grabber grab(grabber::color);
+	auto grab = make_grabber(grabber::color);
 
 	viewer view(1920, 1080+30, true);
 	auto& exaggeration = view.add_int_slider("exaggeration (%)", 100, 100, 3000);
 			
 	do {
-		grab.grab();
+		if(! grab->grab()) break;
 		view.clear();
 				
-		cv::Mat_<cv::Vec3b> color = grab.get_color_frame();
+		cv::Mat_<cv::Vec3b> color = grab->get_color_frame();
 
 		checkerboard color_chk = detect_color_checkerboard(color, cols, rows, square_width);
 
@@ -88,7 +88,7 @@ int main(int argc, const char* argv[]) {
 		
 		view.draw(cv::Rect(0, 0, 1920, 1080), color);
 		view.draw_text(cv::Rect(0, 1080, 1920, 30), "rms reprojection error: " + std::to_string(reprojection_error) + " pixel", viewer::center);
-		grab.release();
+		grab->release();
 
 	} while(view.show());
 }
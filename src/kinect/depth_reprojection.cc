@@ -17,23 +17,32 @@
 using namespace tlz;
 
 
-void do_depth_reprojection(const cv::Mat_<ushort>& in, cv::Mat_<ushort>& out, cv::Mat_<uchar>& out_mask, const kinect_reprojection& reproj, const std::string& method) {	
-	cv::Mat_<real> in_float = in;
-	auto samples = reproj.reproject_ir_to_color_samples(in_float, in_float);
+void do_depth_reprojection(const cv::Mat_<ushort>& in, cv::Mat_<ushort>& out, cv::Mat_<uchar>& out_mask, const kinect_reprojection& reproj, depth_densify_base& densifier, bool use_samples) {	
 	cv::Mat_<real> out_float(texture_height, texture_width);
-	make_depth_densify(method)->densify(samples, out_float, out_mask);
+	if(use_samples) {
+		cv::Mat_<real> in_float = in;
+		auto samples = reproj.reproject_ir_to_color_samples(in_float, in_float);
+		densifier.densify(samples, out_float, out_mask);
+	} else {
+		densifier.densify_ir(reproj, in, out_float, out_mask);
+	}
 	out = out_float;
 }
 
 
 int main(int argc, const char* argv[]) {
-	get_args(argc, argv, "input.png output.png/- output_mask.png/- reprojection_parameters.json method [=was_flipped]");
+	get_args(argc, argv, "input.png output.png/- output_mask.png/- reprojection_parameters.json method [=was_flipped] [samples] [guide.png]");
 	std::string input_filename = in_filename_arg();
 	std::string output_filename = out_filename_opt_arg();
 	std::string output_mask_filename = out_filename_opt_arg();
 	std::string reprojection_parameters_filename = in_filename_arg();
 	std::string method = string_arg();
 	bool was_flipped = bool_opt_arg("was_flipped", true);
+	bool use_samples = bool_opt_arg("samples");
+	std::string guide_filename = in_filename_opt_arg();
+	
+	std::unique_ptr<depth_densify_base> densifier = make_depth_densify(method);
+	if(densifier->uses_guide() && guide_filename.empty()) throw std::runtime_error("densification method needs guide image");
 	
 	std::cout << "reading parameters" << std::endl;
 	kinect_reprojection_parameters reprojection_parameters = decode_kinect_reprojection_parameters(import_json_file(reprojection_parameters_filename));
@@ -42,11 +51,18 @@ int main(int argc, const char* argv[]) {
 	std::cout << "reading input depth map" << std::endl;
 	cv::Mat_<ushort> in_depth = load_depth(input_filename.c_str());
 	if(was_flipped) cv::flip(in_depth, in_depth, 1);
+	
+	if(densifier->uses_guide()) {
+		std::cout << "reading guide image" << std::endl;
+		cv::Mat_<cv::Vec3b> guide = load_texture(guide_filename);
+		if(was_flipped) cv::flip(guide, guide, 1);
+		densifier->set_guide(guide);
+	}
 		
 	std::cout << "doing depth densification" << std::endl;
 	cv::Mat_<ushort> out_depth(texture_height, texture_width);
 	cv::Mat_<uchar> out_mask(texture_height, texture_width);
-	do_depth_reprojection(in_depth, out_depth, out_mask, reproj, method);
+	do_depth_reprojection(in_depth, out_depth, out_mask, reproj, *densifier, use_samples);
 	
 	std::cout << "saving output depth map+mask" << std::endl;
 	if(was_flipped) {
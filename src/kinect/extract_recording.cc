@@ -0,0 +1,103 @@
+#include "../lib/args.h"
+#include "../lib/dataset.h"
+#include "../lib/image_io.h"
+#include "../lib/filesystem.h"
+#include "../lib/string.h"
+#include "lib/kinect_recording.h"
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include <string>
+#include <stdexcept>
+#include <atomic>
+#include <algorithm>
+#include <exception>
+
+using namespace tlz;
+
+namespace {
+
+bool is_jpeg_filename(const std::string& filename) {
+	std::string ext = to_lower(file_name_extension(filename));
+	return (ext == "jpg" || ext == "jpeg");
+}
+
+void write_file(const std::string& filename, const kinect_recording_blob& blob) {
+	std::ofstream stream(filename, std::ios_base::binary);
+	stream.write(reinterpret_cast<const char*>(blob.data), blob.size);
+	if(! stream) throw std::runtime_error("could not write " + filename);
+}
+
+}
+
+
+int main(int argc, const char* argv[]) {
+	get_args(argc, argv, "recording.krec dataset_parameters.json [dataset_group] [frame_step] [overwrite]");
+	std::string recording_filename = in_filename_arg();
+	dataset datas = dataset_arg();
+	std::string group = string_opt_arg("");
+	int frame_step = int_opt_arg(1);
+	bool overwrite = bool_opt_arg("overwrite");
+
+	if(datas.is_packed()) throw std::runtime_error("cannot write into dataset pack");
+	if(frame_step < 1) throw std::invalid_argument("frame step must be at least 1");
+
+	kinect_recording recording(recording_filename);
+	std::cout << recording.frames_count() << " frames in recording" << std::endl;
+
+	std::vector<view_index> indices = datas.indices();
+	std::size_t views_count = std::min(indices.size(), (recording.frames_count() + frame_step - 1) / frame_step);
+	if(views_count < indices.size())
+		std::cout << "recording has frames for only " << views_count << " of " << indices.size() << " views" << std::endl;
+	else if(views_count * frame_step < recording.frames_count())
+		std::cout << "dataset has views for only " << views_count * frame_step << " of " << recording.frames_count() << " frames" << std::endl;
+
+	std::atomic<std::size_t> done_count(0);
+	std::exception_ptr error; // first error, exceptions must not leave the parallel loop
+	std::atomic<bool> failed(false);
+
+	std::cout << "extracting frames" << std::endl;
+	#pragma omp parallel for schedule(dynamic)
+	for(std::ptrdiff_t i = 0; i < views_count; ++i) {
+		if(failed) continue;
+		try {
+			std::ptrdiff_t frame = i * frame_step;
+			dataset_view view = datas.view(indices[i]).group_view(group);
+
+			std::string image_filename = view.image_filename();
+			kinect_recording_blob encoded_color = recording.encoded_color(frame);
+			if(! image_filename.empty() && encoded_color && (overwrite || ! file_exists(image_filename))) {
+				make_parent_directories(image_filename);
+				if(recording.color_format() == kinect_recording_color_format::jpeg && is_jpeg_filename(image_filename))
+					write_file(image_filename, encoded_color);
+				else
+					save_texture(image_filename, recording.color(frame));
+			}
+
+			std::string depth_filename = view.depth_filename();
+			if(! depth_filename.empty() && recording.encoded_depth(frame) && (overwrite || ! file_exists(depth_filename))) {
+				make_parent_directories(depth_filename);
+				view.save_depth(recording.depth(frame));
+			}
+
+			std::string ir_filename = view.local_filename("ir_filename_format");
+			if(! ir_filename.empty() && recording.encoded_ir(frame) && (overwrite || ! file_exists(ir_filename))) {
+				make_parent_directories(ir_filename);
+				save_ir(ir_filename, recording.ir(frame));
+			}
+
+			std::size_t done = ++done_count;
+			if(done % 100 == 0) {
+				#pragma omp critical
+				std::cout << done << " of " << views_count << " views" << std::endl;
+			}
+		} catch(...) {
+			#pragma omp critical
+			if(! error) error = std::current_exception();
+			failed = true;
+		}
+	}
+	if(error) std::rethrow_exception(error);
+
+	std::cout << "done" << std::endl;
+}
@@ -29,7 +29,7 @@ def process_view(x, y):
 	view = datas.view(x, y)
 	raw_view = view.group_view("kinect_raw")
 		
-	if depth:
+	if depth and simulate:
 		out_depth_filename = view.depth_filename("-")
 		out_mask_filename = view.mask_filename("-")
 		in_depth_filename = raw_view.depth_filename()
@@ -38,19 +38,7 @@ def process_view(x, y):
 			print("kinect_raw depth {} not found, skipping".format(in_depth_filename))
 					
 		elif overwrite_depth or not os.path.isfile(out_depth_filename):
-			if verbose: print("reprojecting depth {} -> {}".format(in_depth_filename, out_depth_filename))
-			if not simulate:
-				#call_tool("misc/touch", [
-				#	out_depth_filename,
-				#	"no_create"
-				#])
-				call_tool("kinect/depth_reprojection", [
-					in_depth_filename,
-					out_depth_filename,
-					out_mask_filename,
-					reprojection_parameters_filename,
-					densify_method
-				])
+			print("reprojecting depth {} -> {}".format(in_depth_filename, out_depth_filename))
 
 	if image:
 		out_image_filename = view.image_filename()
@@ -88,7 +76,14 @@ if __name__ == '__main__':
 	
 	indices = [idx for idx in datas.indices()]
 	
-	batch_process(process_view, indices)
+	if depth and not simulate:
+		# all depth maps get reprojected in one process
+		args = [parameters_filename, "kinect_raw", densify_method]
+		if overwrite_depth: args.append("overwrite")
+		call_tool("kinect/batch_depth_reprojection", args)
+	
+	if image or simulate:
+		batch_process(process_view, indices)
 	
 	print("done.")
 
@@ -17,7 +17,7 @@ int main(int argc, const char* argv[]) {
 	
 	bool show_depth = (mode == "depth");
 	
-	grabber grab(show_depth ? grabber::depth : grabber::ir);
+	auto grab = make_grabber(show_depth ? grabber::depth : grabber::ir);
 
 	viewer view(512+512, 20+424);
 	int max_possible_val = (show_depth ? 6000 : 0xffff);
@@ -29,7 +29,7 @@ int main(int argc, const char* argv[]) {
 	mat33 camera_mat;
 	std::vector<real> distortion_coeffs;
 	if(ir_intrinsics_filename == "internal") {
-		const auto& par = grab.internal_parameters().ir;
+		const auto& par = grab->internal_parameters().ir;
 		camera_mat = mat33(
 			par.fx, 0.0, par.cx,
 			0.0, par.fy, par.cy,
@@ -44,19 +44,19 @@ int main(int argc, const char* argv[]) {
 	
 	
 	do {
-		grab.grab();
+		if(! grab->grab()) break;
 		view.clear();
 		
 		cv::Mat_<cv::Vec3b> raw_img, undistorted_img;
 		if(show_depth) {
-			cv::Mat_<uchar> viz_depth = view.visualize_depth(grab.get_depth_frame(false), min_val.value(), max_val.value());
+			cv::Mat_<uchar> viz_depth = view.visualize_depth(grab->get_depth_frame(false), min_val.value(), max_val.value());
 			cv::cvtColor(viz_depth, raw_img, CV_GRAY2BGR);
 		} else {
-			cv::cvtColor(grab.get_ir_frame(min_val.value(), max_val.value(), false), raw_img, CV_GRAY2BGR);
+			cv::cvtColor(grab->get_ir_frame(min_val.value(), max_val.value(), false), raw_img, CV_GRAY2BGR);
 		}
 		
 		
-		grab.release();
+		grab->release();
 		
 		cv::undistort(raw_img, undistorted_img, camera_mat, distortion_coeffs, camera_mat);
 		
@@ -24,7 +24,7 @@ int main(int argc, const char* argv[]) {
 	real square_width = real_arg();
 	intrinsics ir_intr = intrinsics_arg();
 	
-	grabber grab(grabber::ir);
+	auto grab = make_grabber(grabber::ir);
 
 	viewer view(2*512, 2*424+30, true);
 	auto& min_ir = view.add_int_slider("ir min", 0, 0x0000, 0xffff);
@@ -32,10 +32,10 @@ int main(int argc, const char* argv[]) {
 	auto& exaggeration = view.add_int_slider("exaggeration (%)", 100, 100, 1000);
 			
 	do {
-		grab.grab();
+		if(! grab->grab()) break;
 		view.clear();
 				
-		cv::Mat_<uchar> ir = grab.get_ir_frame(min_ir.value(), max_ir.value());
+		cv::Mat_<uchar> ir = grab->get_ir_frame(min_ir.value(), max_ir.value());
 
 		cv::Mat_<cv::Vec3b> large_ir;
 		{
@@ -97,7 +97,7 @@ int main(int argc, const char* argv[]) {
 		
 		view.draw(cv::Rect(0, 0, 2*512, 2*424), large_ir);
 		view.draw_text(cv::Rect(0, 2*424, 2*512, 30), "rms reprojection error: " + std::to_string(reprojection_error) + " pixel", viewer::center);
-		grab.release();
+		grab->release();
 
 	} while(view.show());
 }
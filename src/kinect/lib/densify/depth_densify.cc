@@ -2,6 +2,9 @@
 #include "depth_densify_mine.h"
 #include "depth_densify_splat.h"
 #include "depth_densify_fast.h"
+#include "depth_densify_guided.h"
+#include "../kinect_reprojection.h"
+#include "../common.h"
 
 namespace tlz {
 
@@ -10,10 +13,34 @@ void depth_densify_base::densify(const std::vector<sample>& samples, cv::Mat_<re
 	this->densify(samples, out, unused_mask);
 }
 
+
+void depth_densify_base::densify_z_buffer(const cv::Mat_<float>& z_buffer, cv::Mat_<real>& out, cv::Mat_<uchar>& out_mask) {
+	real scale = z_buffer_scale();
+	std::vector<sample> samples;
+	for(int y = 0; y < z_buffer.rows; ++y) for(int x = 0; x < z_buffer.cols; ++x) {
+		float d = z_buffer(y, x);
+		if(d == 0.0) continue;
+		sample samp = sample(); // IR coordinates, depth and value are unknown, and left 0
+		samp.color_coordinates = vec2(x / scale, y / scale);
+		samp.color_depth = d;
+		samples.push_back(samp);
+	}
+	this->densify(samples, out, out_mask);
+}
+
+
+void depth_densify_base::densify_ir(const kinect_reprojection& reproj, const cv::Mat_<ushort>& ir_z, cv::Mat_<real>& out, cv::Mat_<uchar>& out_mask) {
+	real scale = z_buffer_scale();
+	cv::Mat_<float> z_buffer(scale * texture_height, scale * texture_width);
+	reproj.reproject_ir_to_color_z_buffer(ir_z, z_buffer, scale);
+	this->densify_z_buffer(z_buffer, out, out_mask);
+}
+
 std::unique_ptr<depth_densify_base> make_depth_densify(const std::string& method) {
 	if(method == "mine") return std::make_unique<depth_densify_mine>();
 	else if(method == "splat") return std::make_unique<depth_densify_splat>();
 	else if(method == "fast") return std::make_unique<depth_densify_fast>();
+	else if(method == "guided") return std::make_unique<depth_densify_guided>();
 	else throw std::invalid_argument("unknown depth densify method");
 }
 
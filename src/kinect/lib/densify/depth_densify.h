@@ -9,6 +9,8 @@
 #include <string>
 
 namespace tlz {
+
+class kinect_reprojection;
 	
 class depth_densify_base {
 public:
@@ -18,6 +20,21 @@ public:
 
 	virtual void densify(const std::vector<sample>& samples, cv::Mat_<real>& out, cv::Mat_<uchar>& out_mask) = 0;
 	void densify(const std::vector<sample>& samples, cv::Mat_<real>& out);
+	
+	/// Whether the method needs the color image of the frame, set with set_guide().
+	virtual bool uses_guide() const { return false; }
+	/// Set color image of the frame to densify, for methods that use it as guide.
+	virtual void set_guide(const cv::Mat_<cv::Vec3b>& color) { }
+	
+	/// Size of z-buffer for densify_z_buffer(), relative to color image size.
+	virtual real z_buffer_scale() const { return 1.0; }
+	
+	/// Densify from sparse z-buffer, holding nearest sample depth at each (scaled) color pixel, or 0.
+	/** Default implementation converts it into samples and calls densify(). */
+	virtual void densify_z_buffer(const cv::Mat_<float>& z_buffer, cv::Mat_<real>& out, cv::Mat_<uchar>& out_mask);
+	
+	/// Reproject IR depth map and densify it in one pass, without intermediate samples.
+	void densify_ir(const kinect_reprojection&, const cv::Mat_<ushort>& ir_z, cv::Mat_<real>& out, cv::Mat_<uchar>& out_mask);
 };
 
 std::unique_ptr<depth_densify_base> make_depth_densify(const std::string& method);
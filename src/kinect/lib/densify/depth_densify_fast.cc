@@ -7,7 +7,7 @@ namespace tlz {
 
 
 void depth_densify_fast::densify(const std::vector<sample>& samples, cv::Mat_<real>& out, cv::Mat_<uchar>& out_mask) {
-	const real scaledown = 0.3;
+	const real scaledown = z_buffer_scale();
 	cv::Size scaled_size(scaledown * texture_width, scaledown * texture_height);
 	
 	cv::Mat_<real> scaled_out(scaled_size);
@@ -27,4 +27,17 @@ void depth_densify_fast::densify(const std::vector<sample>& samples, cv::Mat_<re
 	out_mask = (out != 0.0);
 }
 
+
+real depth_densify_fast::z_buffer_scale() const {
+	return 0.3;
+}
+
+
+void depth_densify_fast::densify_z_buffer(const cv::Mat_<float>& z_buffer, cv::Mat_<real>& out, cv::Mat_<uchar>& out_mask) {
+	cv::Mat_<float> out_float;
+	cv::resize(z_buffer, out_float, cv::Size(texture_width, texture_height), 0.0, 0.0, cv::INTER_NEAREST);
+	out = out_float;
+	out_mask = (out != 0.0);
+}
+
 }
@@ -8,6 +8,9 @@ namespace tlz {
 class depth_densify_fast : public depth_densify_base {
 public:
 	void densify(const std::vector<sample>& samples, cv::Mat_<real>& out, cv::Mat_<uchar>& out_mask) override;
+	
+	real z_buffer_scale() const override;
+	void densify_z_buffer(const cv::Mat_<float>& z_buffer, cv::Mat_<real>& out, cv::Mat_<uchar>& out_mask) override;
 };
 
 }
@@ -0,0 +1,146 @@
+#include "depth_densify_guided.h"
+#include "../common.h"
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace tlz {
+
+void depth_densify_guided::set_guide(const cv::Mat_<cv::Vec3b>& color) {
+	if(color.cols != texture_width || color.rows != texture_height)
+		throw std::invalid_argument("guide image must have color image size");
+	guide_ = color;
+	compute_distances_();
+}
+
+
+void depth_densify_guided::compute_distances_() {
+	horizontal_distances_.create(texture_height, texture_width);
+	vertical_distances_.create(texture_height, texture_width);
+	
+	auto color_distance = [](const cv::Vec3b& a, const cv::Vec3b& b) {
+		return std::abs(a[0] - b[0]) + std::abs(a[1] - b[1]) + std::abs(a[2] - b[2]);
+	};
+	
+	#pragma omp parallel for
+	for(int y = 0; y < texture_height; ++y) {
+		const cv::Vec3b* row = guide_[y];
+		const cv::Vec3b* prev_row = guide_[std::max(y - 1, 0)];
+		ushort* h_row = horizontal_distances_[y];
+		ushort* v_row = vertical_distances_[y];
+		h_row[0] = 0;
+		for(int x = 1; x < texture_width; ++x) h_row[x] = color_distance(row[x], row[x - 1]);
+		for(int x = 0; x < texture_width; ++x) v_row[x] = color_distance(row[x], prev_row[x]);
+	}
+}
+
+
+void depth_densify_guided::filter_(real sigma) {
+	// weight of previous pixel is a^d, with domain transform distance d = 1 + (sigma_s/sigma_r)*color_distance
+	const real log_a = -std::sqrt(2.0) / sigma;
+	const real range_factor = sigma_spatial_ / sigma_range_;
+	weights_.resize(3*255 + 1);
+	for(int color_distance = 0; color_distance < weights_.size(); ++color_distance)
+		weights_[color_distance] = std::exp(log_a * (1.0 + range_factor * color_distance));
+	const float* weights = weights_.data();
+	
+	// horizontal pass, left-to-right and right-to-left
+	#pragma omp parallel for
+	for(int y = 0; y < texture_height; ++y) {
+		float* num = numerator_[y];
+		float* den = denominator_[y];
+		const ushort* dist = horizontal_distances_[y];
+		for(int x = 1; x < texture_width; ++x) {
+			float w = weights[dist[x]];
+			num[x] += w * (num[x - 1] - num[x]);
+			den[x] += w * (den[x - 1] - den[x]);
+		}
+		for(int x = texture_width - 2; x >= 0; --x) {
+			float w = weights[dist[x + 1]];
+			num[x] += w * (num[x + 1] - num[x]);
+			den[x] += w * (den[x + 1] - den[x]);
+		}
+	}
+	
+	// vertical pass, top-to-bottom and bottom-to-top, going through rows so that memory access stays sequential
+	const int column_block_width = 64;
+	#pragma omp parallel for
+	for(int min_x = 0; min_x < texture_width; min_x += column_block_width) {
+		int max_x = std::min(min_x + column_block_width, (int)texture_width);
+		for(int y = 1; y < texture_height; ++y) {
+			float* num = numerator_[y];
+			float* den = denominator_[y];
+			const float* prev_num = numerator_[y - 1];
+			const float* prev_den = denominator_[y - 1];
+			const ushort* dist = vertical_distances_[y];
+			for(int x = min_x; x < max_x; ++x) {
+				float w = weights[dist[x]];
+				num[x] += w * (prev_num[x] - num[x]);
+				den[x] += w * (prev_den[x] - den[x]);
+			}
+		}
+		for(int y = texture_height - 2; y >= 0; --y) {
+			float* num = numerator_[y];
+			float* den = denominator_[y];
+			const float* next_num = numerator_[y + 1];
+			const float* next_den = denominator_[y + 1];
+			const ushort* dist = vertical_distances_[y + 1];
+			for(int x = min_x; x < max_x; ++x) {
+				float w = weights[dist[x]];
+				num[x] += w * (next_num[x] - num[x]);
+				den[x] += w * (next_den[x] - den[x]);
+			}
+		}
+	}
+}
+
+
+void depth_densify_guided::densify_z_buffer(const cv::Mat_<float>& z_buffer, cv::Mat_<real>& out, cv::Mat_<uchar>& out_mask) {
+	if(guide_.empty()) throw std::logic_error("guided depth densification needs guide color image");
+	if(z_buffer.cols != texture_width || z_buffer.rows != texture_height)
+		throw std::invalid_argument("z-buffer must have color image size");
+	
+	numerator_.create(texture_height, texture_width);
+	denominator_.create(texture_height, texture_width);
+	#pragma omp parallel for
+	for(int y = 0; y < texture_height; ++y)
+	for(int x = 0; x < texture_width; ++x) {
+		float d = z_buffer(y, x);
+		numerator_(y, x) = d;
+		denominator_(y, x) = (d != 0.0f ? 1.0f : 0.0f);
+	}
+	
+	// iterations with decreasing sigma, as in the paper
+	for(int i = 0; i < iterations_; ++i) {
+		real sigma = sigma_spatial_ * std::sqrt(3.0) * std::pow(2.0, iterations_ - (i + 1)) / std::sqrt(std::pow(4.0, iterations_) - 1.0);
+		filter_(sigma);
+	}
+	
+	out.create(texture_height, texture_width);
+	out_mask.create(texture_height, texture_width);
+	#pragma omp parallel for
+	for(int y = 0; y < texture_height; ++y)
+	for(int x = 0; x < texture_width; ++x) {
+		float den = denominator_(y, x);
+		bool valid = (den >= min_density_);
+		out(y, x) = (valid ? numerator_(y, x) / den : 0.0);
+		out_mask(y, x) = (valid ? 0xff : 0);
+	}
+}
+
+
+void depth_densify_guided::densify(const std::vector<sample>& samples, cv::Mat_<real>& out, cv::Mat_<uchar>& out_mask) {
+	z_buffer_.create(texture_height, texture_width);
+	z_buffer_.setTo(0.0);
+	for(const sample& samp : samples) {
+		int sx = samp.color_coordinates[0], sy = samp.color_coordinates[1];
+		if(sx < 0 || sx >= texture_width || sy < 0 || sy >= texture_height) continue;
+		float new_d = samp.color_depth;
+		float& d = z_buffer_(sy, sx);
+		if(d == 0.0f || new_d < d) d = new_d;
+	}
+	densify_z_buffer(z_buffer_, out, out_mask);
+}
+
+}
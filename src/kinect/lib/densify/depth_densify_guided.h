@@ -0,0 +1,42 @@
+#ifndef LICORNEA_KINECT_DEPTH_DENSIFY_GUIDED_H_
+#define LICORNEA_KINECT_DEPTH_DENSIFY_GUIDED_H_
+
+#include "depth_densify.h"
+#include <vector>
+
+namespace tlz {
+
+/// Densification by edge-aware filtering, guided by the color image.
+/** Normalized convolution with a domain transform recursive filter (Gastal and Oliveira, 2011): the sparse depth
+ ** samples and their mask get smoothed with the same filter, whose weights drop across color edges, and the
+ ** results are divided. The filter is separable, and its cost per pixel does not depend on its spatial extent.
+ ** Pixels where the density of samples is too low are left invalid. */
+class depth_densify_guided : public depth_densify_base {
+private:
+	real sigma_spatial_ = 20.0;
+	real sigma_range_ = 20.0;
+	int iterations_ = 3;
+	real min_density_ = 0.02;
+
+	cv::Mat_<cv::Vec3b> guide_;
+	cv::Mat_<ushort> horizontal_distances_; // L1 color distance from pixel (x-1, y) to (x, y)
+	cv::Mat_<ushort> vertical_distances_; // L1 color distance from pixel (x, y-1) to (x, y)
+	std::vector<float> weights_; // filter weight for each color distance
+	cv::Mat_<float> z_buffer_;
+	cv::Mat_<float> numerator_;
+	cv::Mat_<float> denominator_;
+	
+	void compute_distances_();
+	void filter_(real sigma);
+
+public:
+	bool uses_guide() const override { return true; }
+	void set_guide(const cv::Mat_<cv::Vec3b>& color) override;
+	
+	void densify(const std::vector<sample>& samples, cv::Mat_<real>& out, cv::Mat_<uchar>& out_mask) override;
+	void densify_z_buffer(const cv::Mat_<float>& z_buffer, cv::Mat_<real>& out, cv::Mat_<uchar>& out_mask) override;
+};
+
+}
+
+#endif
@@ -1,119 +1,171 @@
 #include "depth_densify_mine.h"
 #include "../common.h"
+#include "../../../lib/assert.h"
 #include <vector>
 #include <algorithm>
+#include <cstdlib>
 
 namespace tlz {
 
-
-void depth_densify_mine::densify(const std::vector<sample>& orig_samples, cv::Mat_<real>& out_, cv::Mat_<uchar>& out_mask) {
-	out_ = cv::Mat_<real>(texture_height, texture_width);
-	out_mask = cv::Mat_<uchar>(texture_height, texture_width);
-
-	std::vector<sample> samples = orig_samples;
-	auto cmp = [](const sample& a, const sample& b) { return (a.color_depth > b.color_depth); };
-	std::sort(samples.begin(), samples.end(), cmp);
+namespace {
+	const int shadow_width = 3;
+	const real shadow_min_depth_diff = 100.0;
 	
-	cv::Mat_<float> out(out_.size());
+	const int fill_radius = 5;
+	const int fill_accept_dist = 3;
 	
-	cv::Mat_<uchar> sparse_mask(texture_height, texture_width);
-	cv::Mat_<real> sparse(texture_height, texture_width);
-	sparse_mask.setTo(0);
+	const int splat_bands_count = 16;
+	const int splat_band_height = (texture_height + splat_bands_count - 1) / splat_bands_count;
+
+	struct fill_offset {
+		int x;
+		int y;
+		int dist; // chessboard distance
+	};
 	
-	int shadow_width = 3;
-	real shadow_min_depth_diff = 100.0;
+	/// Offsets of neighbors considered for filling a pixel.
+	/** Within Euclidian distance fill_radius, and not on same row or column. Ordered by x, then y, which
+	 ** decides which of the equally near samples gets taken. */
+	const std::vector<fill_offset>& fill_offsets_() {
+		static const std::vector<fill_offset> offsets = [] {
+			std::vector<fill_offset> offs;
+			for(int x = -fill_radius; x <= fill_radius; ++x) if(x != 0)
+			for(int y = -fill_radius; y <= fill_radius; ++y) if(y != 0) {
+				if(x*x + y*y > fill_radius*fill_radius) continue;
+				offs.push_back(fill_offset { x, y, std::max(std::abs(x), std::abs(y)) });
+			}
+			return offs;
+		}();
+		return offsets;
+	}
+}
+
+
+void depth_densify_mine::splat_samples_(const std::vector<sample>& samples) {
+	auto in_texture = [](int sx, int sy) { return (sx >= 0 && sx < texture_width && sy >= 0 && sy < texture_height); };
+
+	// bin samples by band of rows
+	band_offsets_.assign(splat_bands_count + 1, 0);
 	for(const sample& samp : samples) {
 		int sx = samp.color_coordinates[0], sy = samp.color_coordinates[1];
-		if(sx < 0 || sx >= texture_width || sy < 0 || sy >= texture_height) continue;
-		
-		real new_d = samp.color_depth;
+		if(in_texture(sx, sy)) band_offsets_[sy / splat_band_height + 1]++;
+	}
+	for(int band = 0; band < splat_bands_count; ++band) band_offsets_[band + 1] += band_offsets_[band];
+	binned_points_.resize(band_offsets_.back());
+	{
+		std::vector<std::size_t> band_positions(band_offsets_.begin(), band_offsets_.end() - 1);
+		for(const sample& samp : samples) {
+			int sx = samp.color_coordinates[0], sy = samp.color_coordinates[1];
+			if(in_texture(sx, sy)) binned_points_[band_positions[sy / splat_band_height]++] = splat_point { sx, sy, samp.color_depth };
+		}
+	}
 	
-		// cast shadow
-		int min_x = std::max(sx - shadow_width, 0), max_x = std::min(sx + shadow_width, (int)texture_width-1);
-		int min_y = std::max(sy - shadow_width, 0), max_y = std::min(sy + shadow_width, (int)texture_height-1);
-		for(int x = min_x; x <= max_x; ++x) if(x != sx)
-		for(int y = min_y; y <= max_y; ++y) if(y != sy) {
-			if(! sparse_mask(y, x)) continue;
-			if(sparse(y, x) - new_d > shadow_min_depth_diff) sparse_mask(y, x) = 0;
+	// each band of rows gets written by one thread only, so no synchronization needed
+	sparse_.create(texture_height, texture_width);
+	#pragma omp parallel for
+	for(int band = 0; band < splat_bands_count; ++band) {
+		int min_y = band * splat_band_height;
+		int max_y = std::min(min_y + splat_band_height, (int)texture_height);
+		for(int y = min_y; y < max_y; ++y) std::fill(sparse_[y], sparse_[y] + texture_width, 0.0);
+		
+		for(std::size_t i = band_offsets_[band]; i < band_offsets_[band + 1]; ++i) {
+			const splat_point& pt = binned_points_[i];
+			real& d = sparse_(pt.y, pt.x);
+			if(d == 0.0 || pt.depth < d) d = pt.depth;
 		}
+	}
+}
+
 
-		sparse(sy, sx) = new_d;
-		sparse_mask(sy, sx) = 0xff;
-	}	
+void depth_densify_mine::cast_shadows_() {
+	sparse_mask_.create(texture_height, texture_width);
 	
-	out.setTo(0.0);
-	out_mask.setTo(0);
+	// sample gets removed when a much nearer sample is within shadow_width, and not on same row or column
+	#pragma omp parallel for
+	for(int sy = 0; sy < texture_height; ++sy)
+	for(int sx = 0; sx < texture_width; ++sx) {
+		real d = sparse_(sy, sx);
+		bool shadowed = false;
+		if(d != 0.0) {
+			int min_x = std::max(sx - shadow_width, 0), max_x = std::min(sx + shadow_width, (int)texture_width-1);
+			int min_y = std::max(sy - shadow_width, 0), max_y = std::min(sy + shadow_width, (int)texture_height-1);
+			for(int y = min_y; y <= max_y && !shadowed; ++y) if(y != sy) {
+				const real* row = sparse_[y];
+				for(int x = min_x; x <= max_x; ++x) if(x != sx) {
+					real caster_d = row[x];
+					if(caster_d != 0.0 && d - caster_d > shadow_min_depth_diff) { shadowed = true; break; }
+				}
+			}
+		}
+		sparse_mask_(sy, sx) = (d != 0.0 && !shadowed ? 0xff : 0);
+	}
+}
+
+
+void depth_densify_mine::fill_(cv::Mat_<real>& out, cv::Mat_<uchar>& out_mask) {
+	filled_.create(texture_height, texture_width);
+	out_mask.create(texture_height, texture_width);
 	
-	/*
-	out=sparse;
-	out.setTo(0, sparse_mask==0);
-	out_mask=sparse_mask;
-	return;
-	*/
+	const std::vector<fill_offset>& offsets = fill_offsets_();
 	
-	int rad = 5;
-	int rad_sq = rad*rad;
-
 	#pragma omp parallel for
-	for(int px = 0; px < texture_width; ++px)
-	for(int py = 0; py < texture_height; ++py) {
-		uchar& mask = out_mask(py, px);
-		float& d = out(py, px);
-
-		if(sparse_mask(py, px)) {
-			d = sparse(py, px);
+	for(int py = 0; py < texture_height; ++py)
+	for(int px = 0; px < texture_width; ++px) {
+		bool border = (px < fill_radius || px >= texture_width - fill_radius || py < fill_radius || py >= texture_height - fill_radius);
+		
+		float d = 0.0;
+		uchar mask = 0;
+		if(sparse_mask_(py, px)) {
+			d = sparse_(py, px);
 			mask = 0xff;
-			//continue;
 		}
-			
-		int min_dist = rad*rad;
-		real min_dist_d = 0.0;
 		
+		int min_dist = fill_radius*fill_radius;
+		real min_dist_d = 0.0;
 		real max_d = 0.0;
-		
 		int samples_count = 0;
-		
-		int accept_dist = 3;
-		
-		int min_x = std::max(px - rad, 0), max_x = std::min(px + rad, (int)texture_width-1);
-		int min_y = std::max(py - rad, 0), max_y = std::min(py + rad, (int)texture_height-1);
-		for(int sx = min_x; sx <= max_x; ++sx) if(sx != px)
-		for(int sy = min_y; sy <= max_y; ++sy) if(sy != py) {
-			if(! sparse_mask(sy, sx)) continue;
-
-			real sd = sparse(sy, sx);
 
-			int off_x = sx - px, off_y = sy - py;
-			
-			int dist = std::max(std::abs(off_x), std::abs(off_y));
-			int euc_sq_dist = off_x*off_x + off_y*off_y;
-
-			if(euc_sq_dist > rad_sq) continue;
+		for(const fill_offset& off : offsets) {
+			int sx = px + off.x, sy = py + off.y;
+			if(border && (sx < 0 || sx >= texture_width || sy < 0 || sy >= texture_height)) continue;
+			if(! sparse_mask_(sy, sx)) continue;
 			
+			real sd = sparse_(sy, sx);
 			samples_count++;
-			
-			//if(sx % 100 != 0 || sy % 100 != 0) continue;
-			
-			if(dist < min_dist) {
-				min_dist = dist;
+			if(off.dist < min_dist) {
+				min_dist = off.dist;
 				min_dist_d = sd;
 			}
-			
-			if(sd > max_d) {
-				max_d = sd;
-			}
+			if(sd > max_d) max_d = sd;
 		}
 		
 		if(samples_count > 0) {
 			mask = 0xff;
-			if(min_dist < accept_dist) d = min_dist_d;
+			if(min_dist < fill_accept_dist) d = min_dist_d;
 			else d = max_d;
-		}	
+		}
+		
+		filled_(py, px) = d;
+		out_mask(py, px) = mask;
 	}
 	
-	cv::medianBlur(out, out, 3);
-	
-	out_ = out;
+	cv::medianBlur(filled_, blurred_, 3);
+	blurred_.convertTo(out, cv::DataType<real>::type);
+}
+
+
+void depth_densify_mine::densify(const std::vector<sample>& samples, cv::Mat_<real>& out, cv::Mat_<uchar>& out_mask) {
+	splat_samples_(samples);
+	cast_shadows_();
+	fill_(out, out_mask);
+}
+
+
+void depth_densify_mine::densify_z_buffer(const cv::Mat_<float>& z_buffer, cv::Mat_<real>& out, cv::Mat_<uchar>& out_mask) {
+	Assert(z_buffer.cols == texture_width && z_buffer.rows == texture_height);
+	z_buffer.convertTo(sparse_, cv::DataType<real>::type);
+	cast_shadows_();
+	fill_(out, out_mask);
 }
 
 }
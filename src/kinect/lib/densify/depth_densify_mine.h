@@ -4,13 +4,36 @@
 #include "depth_densify.h"
 
 namespace tlz {
-	
+
+/// Densification used for the Licornea datasets.
+/** Samples are first put into a z-buffer, and samples that are much farther than a nearby sample get removed
+ ** (shadow casting). Then each output pixel takes the depth of the nearest sample around it if there is one close
+ ** enough, or else the maximal depth of the samples around it. Finally a median filter is applied.
+ ** All passes are row-major and parallel. Scratch buffers are kept between calls. */
 class depth_densify_mine : public depth_densify_base {
+private:
+	struct splat_point {
+		int x;
+		int y;
+		real depth;
+	};
+
+	std::vector<splat_point> binned_points_; // samples inside texture, ordered by band of rows
+	std::vector<std::size_t> band_offsets_;
+	cv::Mat_<real> sparse_; // nearest sample depth for each pixel, or 0
+	cv::Mat_<uchar> sparse_mask_; // non-shadowed samples
+	cv::Mat_<float> filled_;
+	cv::Mat_<float> blurred_;
+
+	void splat_samples_(const std::vector<sample>& samples);
+	void cast_shadows_();
+	void fill_(cv::Mat_<real>& out, cv::Mat_<uchar>& out_mask);
+
 public:
 	void densify(const std::vector<sample>& samples, cv::Mat_<real>& out, cv::Mat_<uchar>& out_mask) override;
+	void densify_z_buffer(const cv::Mat_<float>& z_buffer, cv::Mat_<real>& out, cv::Mat_<uchar>& out_mask) override;
 };
 
 }
 
 #endif
-
@@ -2,33 +2,94 @@
 #include "../common.h"
 #include <vector>
 #include <algorithm>
+#include <cmath>
 
 namespace tlz {
 
+namespace {
+	const real splat_reference_radius = 4.0; // radius at reference depth
+	const real splat_reference_depth = 1500.0;
+	const int splat_min_radius = 1;
+	const int splat_max_radius = 12;
+	
+	const int splat_band_height = 32; // must be at least splat_max_radius
+	const int splat_bands_count = (texture_height + splat_band_height - 1) / splat_band_height;
+	
+	int splat_radius_(float depth) {
+		int rad = splat_reference_radius * splat_reference_depth / depth + 0.5;
+		return std::min(std::max(rad, splat_min_radius), splat_max_radius);
+	}
+}
 
-void depth_densify_splat::densify(const std::vector<sample>& orig_samples, cv::Mat_<real>& out, cv::Mat_<uchar>& out_mask) {
-	out = cv::Mat_<real>(texture_height, texture_width);
-	out_mask = cv::Mat_<uchar>(texture_height, texture_width);
 
-	std::vector<sample> samples = orig_samples;
-	auto cmp = [](const sample& a, const sample& b) { return (a.color_depth > b.color_depth); };
-	std::sort(samples.begin(), samples.end(), cmp);
+void depth_densify_splat::add_point_(int x, int y, float depth) {
+	if(x < 0 || x >= texture_width || y < 0 || y >= texture_height || depth <= 0.0) return;
+	points_.push_back(splat_point { x, y, depth });
+}
 
-	out.setTo(0.0);
-	out_mask.setTo(0);
+
+void depth_densify_splat::splat_(cv::Mat_<real>& out, cv::Mat_<uchar>& out_mask) {
+	static_assert(splat_band_height >= splat_max_radius, "splat band height too small");
+
+	// bin points by band of their center
+	band_offsets_.assign(splat_bands_count + 1, 0);
+	for(const splat_point& pt : points_) band_offsets_[pt.y / splat_band_height + 1]++;
+	for(int band = 0; band < splat_bands_count; ++band) band_offsets_[band + 1] += band_offsets_[band];
+	binned_points_.resize(points_.size());
+	{
+		std::vector<std::size_t> band_positions(band_offsets_.begin(), band_offsets_.end() - 1);
+		for(const splat_point& pt : points_) binned_points_[band_positions[pt.y / splat_band_height]++] = pt;
+	}
 	
-	int rad = 4;
-	for(const sample& samp : samples) {
-		int sx = samp.color_coordinates[0], sy = samp.color_coordinates[1];
-		if(sx < 0 || sx >= texture_width || sy < 0 || sy >= texture_height) continue;
-		
-		real new_d = samp.color_depth;
+	// splat bands in parallel, each one only writes its own rows
+	z_buffer_.create(texture_height, texture_width);
+	#pragma omp parallel for schedule(dynamic)
+	for(int band = 0; band < splat_bands_count; ++band) {
+		int band_min_y = band * splat_band_height;
+		int band_max_y = std::min(band_min_y + splat_band_height, (int)texture_height) - 1;
+		for(int y = band_min_y; y <= band_max_y; ++y) std::fill(z_buffer_[y], z_buffer_[y] + texture_width, 0.0f);
 		
-		cv::circle(out, cv::Point(sx, sy), rad, new_d, -1);
-		cv::circle(out_mask, cv::Point(sx, sy), rad, 0xff, -1);
+		// disks reaching this band have center in this or adjacent band
+		std::size_t begin = band_offsets_[std::max(band - 1, 0)];
+		std::size_t end = band_offsets_[std::min(band + 2, splat_bands_count)];
+		for(std::size_t i = begin; i < end; ++i) {
+			const splat_point& pt = binned_points_[i];
+			int rad = splat_radius_(pt.depth);
+			int min_y = std::max(pt.y - rad, band_min_y), max_y = std::min(pt.y + rad, band_max_y);
+			for(int y = min_y; y <= max_y; ++y) {
+				int half_width = std::sqrt(real(rad*rad - (y - pt.y)*(y - pt.y)));
+				int min_x = std::max(pt.x - half_width, 0), max_x = std::min(pt.x + half_width, (int)texture_width - 1);
+				float* row = z_buffer_[y];
+				const float new_d = pt.depth;
+				for(int x = min_x; x <= max_x; ++x) {
+					float d = row[x];
+					row[x] = (d == 0.0f || new_d < d) ? new_d : d;
+				}
+			}
+		}
 	}
-	
-	std::cout << "done" << std::endl;
+
+	z_buffer_.convertTo(out, cv::DataType<real>::type);
+	out_mask = (z_buffer_ != 0.0);
+}
+
+
+void depth_densify_splat::densify(const std::vector<sample>& samples, cv::Mat_<real>& out, cv::Mat_<uchar>& out_mask) {
+	points_.clear();
+	points_.reserve(samples.size());
+	for(const sample& samp : samples)
+		add_point_(samp.color_coordinates[0], samp.color_coordinates[1], samp.color_depth);
+	splat_(out, out_mask);
+}
+
+
+void depth_densify_splat::densify_z_buffer(const cv::Mat_<float>& z_buffer, cv::Mat_<real>& out, cv::Mat_<uchar>& out_mask) {
+	points_.clear();
+	for(int y = 0; y < z_buffer.rows; ++y) {
+		const float* row = z_buffer[y];
+		for(int x = 0; x < z_buffer.cols; ++x) if(row[x] != 0.0f) add_point_(x, y, row[x]);
+	}
+	splat_(out, out_mask);
 }
 
 }
@@ -2,15 +2,35 @@
 #define LICORNEA_KINECT_DEPTH_DENSIFY_SPLAT_H_
 
 #include "depth_densify.h"
+#include <vector>
 
 namespace tlz {
-	
+
+/// Densification by splatting each sample as a disk, nearest depth wins.
+/** Disk radius is inversely proportional to sample depth, so that nearer surfaces, whose samples are spread farther
+ ** apart in the color image, still get covered. The output is processed in bands of rows in parallel, each band
+ ** only drawing the samples whose disks reach it. Scratch buffers are kept between calls. */
 class depth_densify_splat : public depth_densify_base {
+private:
+	struct splat_point {
+		int x;
+		int y;
+		float depth;
+	};
+
+	std::vector<splat_point> points_;
+	std::vector<splat_point> binned_points_;
+	std::vector<std::size_t> band_offsets_;
+	cv::Mat_<float> z_buffer_;
+	
+	void add_point_(int x, int y, float depth);
+	void splat_(cv::Mat_<real>& out, cv::Mat_<uchar>& out_mask);
+
 public:
 	void densify(const std::vector<sample>& samples, cv::Mat_<real>& out, cv::Mat_<uchar>& out_mask) override;
+	void densify_z_buffer(const cv::Mat_<float>& z_buffer, cv::Mat_<real>& out, cv::Mat_<uchar>& out_mask) override;
 };
 
 }
 
 #endif
-
@@ -0,0 +1,285 @@
+#include "kinect_recording.h"
+#include "../../lib/depth_codec.h"
+#include "../../lib/image_io.h"
+#include "../../lib/assert.h"
+#include <stdexcept>
+
+namespace tlz {
+
+namespace {
+	const std::int32_t kinect_recording_magic_ = 0x524B434C;
+	const std::int32_t kinect_recording_version_ = 1;
+
+	static_assert(sizeof(kinect_recording_header) == 16, "unexpected kinect_recording_header layout");
+	static_assert(sizeof(kinect_recording_frame) == 56, "unexpected kinect_recording_frame layout");
+	static_assert(sizeof(kinect_recording_footer) == 24, "unexpected kinect_recording_footer layout");
+
+	const int color_width_ = 1920, color_height_ = 1080;
+}
+
+
+kinect_recording::kinect_recording(const std::string& filename) :
+	file_(filename)
+{
+	const byte* data = file_.data();
+	std::size_t size = file_.size();
+
+	if(size < sizeof(kinect_recording_header) + sizeof(kinect_recording_footer))
+		throw std::runtime_error("Kinect recording file " + filename + " too small");
+	header_ = reinterpret_cast<const kinect_recording_header*>(data);
+	footer_ = reinterpret_cast<const kinect_recording_footer*>(data + size - sizeof(kinect_recording_footer));
+	if(header_->magic != kinect_recording_magic_) throw std::runtime_error("file " + filename + " is not a Kinect recording");
+	if(footer_->magic != kinect_recording_magic_) throw std::runtime_error("Kinect recording file " + filename + " is incomplete");
+	if(header_->version != kinect_recording_version_ || footer_->version != kinect_recording_version_)
+		throw std::runtime_error("Kinect recording file " + filename + " has unsupported version");
+
+	std::size_t end = size - sizeof(kinect_recording_footer);
+	if(footer_->index_offset % 8 != 0 || footer_->index_offset > end || footer_->frames_count > (end - footer_->index_offset) / sizeof(kinect_recording_frame))
+		throw std::runtime_error("Kinect recording file " + filename + " is corrupt");
+	frames_ = reinterpret_cast<const kinect_recording_frame*>(data + footer_->index_offset);
+
+	for(std::ptrdiff_t i = 0; i < frames_count(); ++i) {
+		const kinect_recording_frame& frame = frames_[i];
+		if(frame.color_offset > end || frame.color_size > end - frame.color_offset ||
+		   frame.depth_offset > end || frame.depth_size > end - frame.depth_offset ||
+		   frame.ir_offset > end || frame.ir_size > end - frame.ir_offset)
+			throw std::runtime_error("Kinect recording file " + filename + " is corrupt");
+	}
+}
+
+
+bool kinect_recording::is_recording(const std::string& filename) {
+	std::ifstream stream(filename, std::ios_base::binary);
+	std::int32_t magic = 0;
+	stream.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+	return (stream && magic == kinect_recording_magic_);
+}
+
+
+kinect_recording_blob kinect_recording::blob_(std::uint64_t offset, std::uint64_t size) const {
+	kinect_recording_blob blob;
+	if(size > 0) {
+		blob.data = file_.data() + offset;
+		blob.size = size;
+	}
+	return blob;
+}
+
+
+kinect_recording_blob kinect_recording::encoded_color(std::ptrdiff_t i) const {
+	Assert(i >= 0 && i < frames_count());
+	return blob_(frames_[i].color_offset, frames_[i].color_size);
+}
+
+
+kinect_recording_blob kinect_recording::encoded_depth(std::ptrdiff_t i) const {
+	Assert(i >= 0 && i < frames_count());
+	return blob_(frames_[i].depth_offset, frames_[i].depth_size);
+}
+
+
+kinect_recording_blob kinect_recording::encoded_ir(std::ptrdiff_t i) const {
+	Assert(i >= 0 && i < frames_count());
+	return blob_(frames_[i].ir_offset, frames_[i].ir_size);
+}
+
+
+cv::Mat_<cv::Vec3b> kinect_recording::color(std::ptrdiff_t i) const {
+	kinect_recording_blob blob = encoded_color(i);
+	if(! blob) return cv::Mat_<cv::Vec3b>();
+
+	if(color_format() == kinect_recording_color_format::jpeg) {
+		return decode_texture(blob.data, blob.size);
+	} else {
+		if(blob.size != color_width_ * color_height_ * 3) throw std::runtime_error("raw color frame in Kinect recording has wrong size");
+		cv::Mat_<cv::Vec3b> color(color_height_, color_width_, const_cast<cv::Vec3b*>(reinterpret_cast<const cv::Vec3b*>(blob.data)));
+		return color.clone();
+	}
+}
+
+
+cv::Mat_<ushort> kinect_recording::depth(std::ptrdiff_t i) const {
+	kinect_recording_blob blob = encoded_depth(i);
+	if(! blob) return cv::Mat_<ushort>();
+	return rice_depth_codec().decode(blob.data, blob.size);
+}
+
+
+cv::Mat_<ushort> kinect_recording::ir(std::ptrdiff_t i) const {
+	kinect_recording_blob blob = encoded_ir(i);
+	if(! blob) return cv::Mat_<ushort>();
+	return rice_depth_codec().decode(blob.data, blob.size);
+}
+
+/////
+
+kinect_recording_writer::kinect_recording_writer(const std::string& filename, kinect_recording_color_format color_format, int jpeg_quality, std::size_t max_queued_frames) :
+	stream_(filename, std::ios_base::binary),
+	color_format_(color_format),
+	jpeg_quality_(jpeg_quality),
+	max_queued_frames_(max_queued_frames)
+{
+	if(! stream_) throw std::runtime_error("could not open Kinect recording file " + filename + " for writing");
+
+	kinect_recording_header header;
+	header.magic = kinect_recording_magic_;
+	header.version = kinect_recording_version_;
+	header.color_format = color_format_;
+	header.reserved = 0;
+	write_(&header, sizeof(kinect_recording_header));
+
+	thread_ = std::thread(&kinect_recording_writer::thread_main_, this);
+}
+
+
+kinect_recording_writer::~kinect_recording_writer() {
+	if(! closed_) try {
+		close();
+	} catch(const std::exception&) { }
+}
+
+
+void kinect_recording_writer::write_(const void* data, std::size_t size) {
+	stream_.write(static_cast<const std::ostream::char_type*>(data), size);
+	position_ += size;
+}
+
+
+void kinect_recording_writer::align_() {
+	static const char padding[8] = { 0 };
+	std::size_t padding_size = (8 - position_ % 8) % 8;
+	write_(padding, padding_size);
+}
+
+
+void kinect_recording_writer::write_blob_(const std::vector<uchar>& data, std::uint64_t& offset, std::uint64_t& size) {
+	align_();
+	offset = position_;
+	size = data.size();
+	write_(data.data(), data.size());
+}
+
+
+void kinect_recording_writer::write_frame_(const job& jb) {
+	kinect_recording_frame frame;
+	frame.timestamp_us = jb.timestamp_us;
+	frame.color_offset = frame.color_size = 0;
+	frame.depth_offset = frame.depth_size = 0;
+	frame.ir_offset = frame.ir_size = 0;
+
+	if(! jb.color.empty()) {
+		if(color_format_ == kinect_recording_color_format::jpeg) {
+			std::vector<uchar> data;
+			std::vector<int> params = { CV_IMWRITE_JPEG_QUALITY, jpeg_quality_ };
+			cv::imencode(".jpg", jb.color, data, params);
+			write_blob_(data, frame.color_offset, frame.color_size);
+		} else {
+			Assert(jb.color.isContinuous());
+			align_();
+			frame.color_offset = position_;
+			frame.color_size = jb.color.total() * 3;
+			write_(jb.color.data, frame.color_size);
+		}
+	}
+
+	rice_depth_codec codec;
+	if(! jb.depth.empty()) write_blob_(codec.encode(jb.depth), frame.depth_offset, frame.depth_size);
+	if(! jb.ir.empty()) write_blob_(codec.encode(jb.ir), frame.ir_offset, frame.ir_size);
+
+	if(! stream_) throw std::runtime_error("could not write to Kinect recording file");
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	frames_.push_back(frame);
+}
+
+
+void kinect_recording_writer::thread_main_() {
+	for(;;) {
+		job jb;
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			queued_cond_.wait(lock, [&] { return (! queue_.empty() || closing_); });
+			if(queue_.empty()) return;
+			jb = std::move(queue_.front());
+			queue_.pop_front();
+		}
+
+		try {
+			write_frame_(jb);
+		} catch(...) {
+			std::lock_guard<std::mutex> lock(mutex_);
+			error_ = std::current_exception();
+			queue_.clear();
+			return;
+		}
+	}
+}
+
+
+bool kinect_recording_writer::write(std::uint64_t timestamp_us, const cv::Mat_<cv::Vec3b>& color, const cv::Mat& depth, const cv::Mat& ir) {
+	Assert(! closed_);
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		if(error_ || queue_.size() >= max_queued_frames_) {
+			++dropped_count_;
+			return false;
+		}
+	}
+
+	job jb;
+	jb.timestamp_us = timestamp_us;
+	if(! color.empty()) {
+		if(color.cols != color_width_ || color.rows != color_height_) throw std::invalid_argument("color frame has wrong size");
+		jb.color = color.clone();
+	}
+	if(! depth.empty()) depth.convertTo(jb.depth, CV_16U);
+	if(! ir.empty()) ir.convertTo(jb.ir, CV_16U);
+
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		queue_.push_back(std::move(jb));
+	}
+	queued_cond_.notify_one();
+	return true;
+}
+
+
+std::size_t kinect_recording_writer::written_frames_count() {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return frames_.size();
+}
+
+
+std::size_t kinect_recording_writer::dropped_frames_count() {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return dropped_count_;
+}
+
+
+void kinect_recording_writer::close() {
+	Assert(! closed_);
+	closed_ = true;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		closing_ = true;
+	}
+	queued_cond_.notify_all();
+	thread_.join();
+
+	kinect_recording_footer footer;
+	footer.magic = kinect_recording_magic_;
+	footer.version = kinect_recording_version_;
+	footer.frames_count = frames_.size();
+
+	align_();
+	footer.index_offset = position_;
+	write_(frames_.data(), frames_.size() * sizeof(kinect_recording_frame));
+	write_(&footer, sizeof(kinect_recording_footer));
+
+	stream_.close();
+	if(error_) std::rethrow_exception(error_);
+	if(! stream_) throw std::runtime_error("could not write Kinect recording file");
+}
+
+}
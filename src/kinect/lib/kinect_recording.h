@@ -0,0 +1,157 @@
+#ifndef LICORNEA_KINECT_RECORDING_H_
+#define LICORNEA_KINECT_RECORDING_H_
+
+#include "../../lib/common.h"
+#include "../../lib/opencv.h"
+#include "../../lib/memory_mapped_file.h"
+#include <string>
+#include <vector>
+#include <deque>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <cstdint>
+
+namespace tlz {
+
+/*
+Kinect recording file format.
+Holds a sequence of Kinect frames, appended while recording. Depth and IR frames are encoded with the rice depth
+codec. Color frames are stored as JPEG, or as raw BGR pixels. Each of them may be missing.
+
+   header         kinect_recording_header
+   frames data    color, depth and IR data of each frame, each 8-byte aligned
+   index          kinect_recording_frame[frames_count]
+   footer         kinect_recording_footer
+*/
+
+enum class kinect_recording_color_format : std::int32_t {
+	raw = 0,
+	jpeg = 1
+};
+
+struct kinect_recording_header {
+	std::int32_t magic;
+	std::int32_t version;
+	kinect_recording_color_format color_format;
+	std::int32_t reserved;
+};
+
+struct kinect_recording_frame {
+	std::uint64_t timestamp_us;
+	std::uint64_t color_offset;
+	std::uint64_t color_size;
+	std::uint64_t depth_offset;
+	std::uint64_t depth_size;
+	std::uint64_t ir_offset;
+	std::uint64_t ir_size;
+};
+
+struct kinect_recording_footer {
+	std::int32_t magic;
+	std::int32_t version;
+	std::uint64_t frames_count;
+	std::uint64_t index_offset;
+};
+
+
+/// Encoded data of one frame type in a Kinect recording.
+struct kinect_recording_blob {
+	const byte* data = nullptr;
+	std::size_t size = 0;
+
+	explicit operator bool () const { return (data != nullptr); }
+};
+
+
+/// Read-only access to memory mapped Kinect recording.
+class kinect_recording {
+private:
+	memory_mapped_file file_;
+	const kinect_recording_header* header_ = nullptr;
+	const kinect_recording_footer* footer_ = nullptr;
+	const kinect_recording_frame* frames_ = nullptr;
+
+	kinect_recording_blob blob_(std::uint64_t offset, std::uint64_t size) const;
+
+public:
+	explicit kinect_recording(const std::string& filename);
+
+	/// Whether file at \a filename starts with Kinect recording header.
+	static bool is_recording(const std::string& filename);
+
+	std::size_t frames_count() const { return footer_->frames_count; }
+	kinect_recording_color_format color_format() const { return header_->color_format; }
+
+	/// Time of frame since start of recording, in microseconds.
+	std::uint64_t timestamp_us(std::ptrdiff_t i) const { return frames_[i].timestamp_us; }
+
+	kinect_recording_blob encoded_color(std::ptrdiff_t i) const;
+	kinect_recording_blob encoded_depth(std::ptrdiff_t i) const;
+	kinect_recording_blob encoded_ir(std::ptrdiff_t i) const;
+
+	/// Decode frames. Return empty matrix if frame does not have that type.
+	cv::Mat_<cv::Vec3b> color(std::ptrdiff_t i) const;
+	cv::Mat_<ushort> depth(std::ptrdiff_t i) const;
+	cv::Mat_<ushort> ir(std::ptrdiff_t i) const;
+};
+
+
+/// Sequential writer of Kinect recording files.
+/** Frames are queued by write(), and encoded and written to the file by a dedicated I/O thread, so that the
+ ** grabbing thread does not get delayed. When the I/O thread falls behind and the queue is full, frames are dropped. */
+class kinect_recording_writer {
+private:
+	struct job {
+		std::uint64_t timestamp_us;
+		cv::Mat_<cv::Vec3b> color;
+		cv::Mat_<ushort> depth;
+		cv::Mat_<ushort> ir;
+	};
+
+	std::ofstream stream_;
+	std::uint64_t position_ = 0;
+	kinect_recording_color_format color_format_;
+	int jpeg_quality_;
+	std::size_t max_queued_frames_;
+	std::vector<kinect_recording_frame> frames_;
+
+	std::mutex mutex_;
+	std::condition_variable queued_cond_;
+	std::deque<job> queue_;
+	bool closing_ = false;
+	bool closed_ = false;
+	std::exception_ptr error_;
+	std::size_t dropped_count_ = 0;
+	std::thread thread_;
+
+	void write_(const void* data, std::size_t size);
+	void align_();
+	void write_blob_(const std::vector<uchar>& data, std::uint64_t& offset, std::uint64_t& size);
+	void write_frame_(const job&);
+	void thread_main_();
+
+public:
+	kinect_recording_writer(const std::string& filename, kinect_recording_color_format, int jpeg_quality = 90, std::size_t max_queued_frames = 30);
+	~kinect_recording_writer();
+
+	kinect_recording_writer(const kinect_recording_writer&) = delete;
+	kinect_recording_writer& operator=(const kinect_recording_writer&) = delete;
+
+	/// Queue copy of frame for writing. Empty matrices are not recorded. Returns false if frame was dropped.
+	/** Depth and IR can be 16 bit or float, and are converted to 16 bit while being copied. */
+	bool write(std::uint64_t timestamp_us, const cv::Mat_<cv::Vec3b>& color, const cv::Mat& depth, const cv::Mat& ir);
+
+	std::size_t written_frames_count();
+	std::size_t dropped_frames_count();
+
+	/// Write remaining frames, index and footer. Called by destructor if not called before.
+	/** Rethrows first error from the I/O thread. */
+	void close();
+};
+
+}
+
+#endif
@@ -10,7 +10,30 @@ namespace {
 }
 
 kinect_remapping::kinect_remapping(const kinect_internal_parameters& internal) :
-	internal_parameters_(internal) { }
+	internal_parameters_(internal),
+	shift_factor_(internal.color.shift_m * internal.color.fx)
+{
+	const auto& ir_par = internal_parameters_.ir;
+	const std::size_t n = depth_width * depth_height;
+	
+	std::vector<vec2> distorted_ir(n);
+	for(int ir_y = 0; ir_y < depth_height; ++ir_y) for(int ir_x = 0; ir_x < depth_width; ++ir_x)
+		distorted_ir[ir_x + depth_width*ir_y] = vec2(ir_x + 0.5, ir_y + 0.5);
+	
+	mat33 camera_mat(
+		ir_par.fx, 0.0, ir_par.cx,
+		0.0, ir_par.fy, ir_par.cy,
+		0.0, 0.0, 1.0
+	);
+	std::vector<real> distortion { ir_par.k1, ir_par.k2, ir_par.p1, ir_par.p2, ir_par.k3 };
+	std::vector<vec2> undistorted_ir;
+	cv::undistortPoints(distorted_ir, undistorted_ir, camera_mat, distortion, cv::noArray(), camera_mat);
+	
+	ir_grid_color_base_.resize(n);
+	#pragma omp parallel for
+	for(std::ptrdiff_t idx = 0; idx < n; ++idx)
+		ir_grid_color_base_[idx] = map_ir_to_color_at_infinity_(undistorted_ir[idx]);
+}
 
 
 vec2 kinect_remapping::distort_ir(vec2 undistorted) const {
@@ -44,6 +67,13 @@ vec2 kinect_remapping::undistort_ir(vec2 distorted_coord) const {
 
 
 vec2 kinect_remapping::map_ir_to_color(vec2 undistorted, real z) const {
+	vec2 color = map_ir_to_color_at_infinity_(undistorted);
+	color[0] += shift_factor_ / z;
+	return color;
+}
+
+
+vec2 kinect_remapping::map_ir_to_color_at_infinity_(vec2 undistorted) const {
 	const auto& ir_par = internal_parameters_.ir;
 	const auto& color_par = internal_parameters_.color;
 	real mx = undistorted[0], my = undistorted[1];
@@ -65,7 +95,7 @@ vec2 kinect_remapping::map_ir_to_color(vec2 undistorted, real z) const {
 
 	real rx = (wx / (color_par.fx * color_q)) - (color_par.shift_m / color_par.shift_d);
 	real ry = (wy / color_q) + color_par.cy;
-	real cx = (rx + (color_par.shift_m / z)) * color_par.fx + color_par.cx;
+	real cx = rx * color_par.fx + color_par.cx;
 	return vec2(cx, ry);
 }
 
@@ -5,12 +5,20 @@
 #include "../../lib/color.h"
 #include "ir_to_color_sample.h"
 #include "kinect_internal_parameters.h"
+#include <vector>
 
 namespace tlz {
 
+/// Kinect IR to color mapping from the device's internal parameters.
+/** The depth-independent part of the mapping (IR undistortion and polynomial warp) is precomputed for the
+ ** `depth_width` x `depth_height` IR pixel grid, so that remapping a depth map only adds the depth-dependent shift. */
 class kinect_remapping {
 protected:
 	kinect_internal_parameters internal_parameters_;
+	std::vector<vec2> ir_grid_color_base_; // color coordinates at infinite depth, per IR grid pixel
+	real shift_factor_; // x shift in color image is shift_factor_ / z
+	
+	vec2 map_ir_to_color_at_infinity_(vec2 undistorted_ir) const;
 
 public:
 	explicit kinect_remapping(const kinect_internal_parameters&);
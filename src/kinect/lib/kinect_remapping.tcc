@@ -1,3 +1,4 @@
+#include "common.h"
 #include <cassert>
 
 namespace tlz {
@@ -7,28 +8,34 @@ std::vector<kinect_remapping::sample<Value>> kinect_remapping::remap_ir_to_color
 	const cv::Mat_<Value>& distorted_ir_values_img,
 	const cv::Mat_<Depth>& distorted_ir_z_img
 ) const {
-	assert(distorted_ir_values.cols == 512 && distorted_ir_values.rows == 424);
-	std::vector<vec2> distorted_ir_i_xy_points;
-	std::vector<real> ir_i_z_points;
-
-	distorted_ir_i_xy_points.reserve(512*424);
-	ir_i_z_points.reserve(512*424);
+	assert(distorted_ir_z_img.cols == depth_width && distorted_ir_z_img.rows == depth_height);
 	
-	std::vector<sample<Value>> samples;
-	for(int ir_y = 0; ir_y < 424; ++ir_y) for(int ir_x = 0; ir_x < 512; ++ir_x) {
-		Depth ir_z = distorted_ir_z_img(ir_y, ir_x);
-		if(ir_z <= 0.001) continue;
-
-		vec2 dist_ir(ir_x + 0.5, ir_y + 0.5);
-		vec2 undist_ir = undistort_ir(dist_ir);
-		vec2 color = map_ir_to_color(undist_ir, ir_z);
-
-		sample<Value> samp;
-		samp.ir_coordinates = vec2(ir_x, ir_y);
-		samp.color_depth = samp.ir_depth = ir_z;
-		samp.color_coordinates = color;
-		
-		samples.push_back(samp);
+	// count valid pixels per row, to get position of each row's samples
+	std::vector<std::size_t> row_offsets(depth_height + 1, 0);
+	#pragma omp parallel for
+	for(int ir_y = 0; ir_y < depth_height; ++ir_y) {
+		const Depth* ir_z_row = distorted_ir_z_img[ir_y];
+		std::size_t count = 0;
+		for(int ir_x = 0; ir_x < depth_width; ++ir_x) if(ir_z_row[ir_x] > 0.001) ++count;
+		row_offsets[ir_y + 1] = count;
+	}
+	for(int ir_y = 0; ir_y < depth_height; ++ir_y) row_offsets[ir_y + 1] += row_offsets[ir_y];
+	
+	std::vector<sample<Value>> samples(row_offsets.back());
+	#pragma omp parallel for
+	for(int ir_y = 0; ir_y < depth_height; ++ir_y) {
+		const Depth* ir_z_row = distorted_ir_z_img[ir_y];
+		const vec2* color_base_row = ir_grid_color_base_.data() + depth_width*ir_y;
+		sample<Value>* samp = samples.data() + row_offsets[ir_y];
+		for(int ir_x = 0; ir_x < depth_width; ++ir_x) {
+			Depth ir_z = ir_z_row[ir_x];
+			if(ir_z <= 0.001) continue;
+			
+			samp->ir_coordinates = vec2(ir_x, ir_y);
+			samp->color_depth = samp->ir_depth = ir_z;
+			samp->color_coordinates = vec2(color_base_row[ir_x][0] + shift_factor_ / ir_z, color_base_row[ir_x][1]);
+			++samp;
+		}
 	}
 	
 	return samples;
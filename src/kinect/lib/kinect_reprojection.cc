@@ -5,22 +5,25 @@
 namespace tlz {
 
 kinect_reprojection::kinect_reprojection(const kinect_reprojection_parameters& reproj) :
-	reprojection_parameters_(reproj) { }
+	reprojection_parameters_(reproj)
+{
+	precompute_ir_grid_();
+}
 
 
-std::vector<vec2> kinect_reprojection::reproject_points_ir_to_color(
-	const std::vector<vec2> distorted_ir_i_xy_points,
-	const std::vector<real>& ir_z_points,
-	std::vector<real>& out_color_z_points,
-	bool distort_color
-) const {
-	std::size_t n = distorted_ir_i_xy_points.size();
-	assert(ir_z_points.size() == n);
+void kinect_reprojection::set_parameters(const kinect_reprojection_parameters& reproj) {
+	reprojection_parameters_ = reproj;
+	precompute_ir_grid_();
+}
 
-	assert(out_color_z_point.size() == n);
-	if(n == 0) return {};
+
+void kinect_reprojection::precompute_ir_grid_() {
+	const std::size_t n = depth_width * depth_height;
+	
+	std::vector<vec2> distorted_ir_i_xy_points(n);
+	for(int ir_y = 0; ir_y < depth_height; ++ir_y) for(int ir_x = 0; ir_x < depth_width; ++ir_x)
+		distorted_ir_i_xy_points[ir_x + depth_width*ir_y] = vec2(ir_x, ir_y);
 	
-	// undistort XY coordinates of ir points
 	std::vector<vec2> undistorted_ir_i_xy_points(n);
 	cv::undistortPoints(
 		distorted_ir_i_xy_points,
@@ -31,14 +34,46 @@ std::vector<vec2> kinect_reprojection::reproject_points_ir_to_color(
 		reprojection_parameters_.ir_intrinsics.K
 	);
 	
-	// backproject to ir view space
-	std::vector<vec3> color_v_points(n);
+	mat33 rotation_t = reprojection_parameters_.rotation.t();
+	mat33 ray_transform = rotation_t * reprojection_parameters_.ir_intrinsics.K_inv;
+	ir_color_origin_ = -(rotation_t * reprojection_parameters_.translation);
+	
+	ir_grid_color_rays_.resize(n);
+	ir_grid_depth_offsets_.resize(n);
 	#pragma omp parallel for
-	for(int idx = 0; idx < n; ++idx) {
+	for(std::ptrdiff_t idx = 0; idx < n; ++idx) {
 		const vec2& undistorted_ir_i_xy = undistorted_ir_i_xy_points[idx];
-		const real& ir_z = ir_z_points[idx];		
+		vec3 undistorted_ir_i_h(undistorted_ir_i_xy[0], undistorted_ir_i_xy[1], 1.0);
+		ir_grid_color_rays_[idx] = ray_transform * undistorted_ir_i_h;
+		ir_grid_depth_offsets_[idx] = reprojection_parameters_.ir_depth_offset(undistorted_ir_i_xy);
+	}
+}
+
+
+bool kinect_reprojection::backproject_ir_grid_points_(
+	const std::vector<vec2>& distorted_ir_i_xy_points,
+	const std::vector<real>& ir_z_points,
+	std::vector<real>& out_color_z_points,
+	std::vector<vec3>& out_color_v_points
+) const {
+	std::size_t n = distorted_ir_i_xy_points.size();
+	
+	// only usable if all points are on IR pixel grid
+	std::vector<std::ptrdiff_t> grid_indices(n);
+	for(std::ptrdiff_t idx = 0; idx < n; ++idx) {
+		const vec2& ir_xy = distorted_ir_i_xy_points[idx];
+		int ir_x = ir_xy[0], ir_y = ir_xy[1];
+		if(ir_x != ir_xy[0] || ir_y != ir_xy[1]) return false;
+		if(ir_x < 0 || ir_x >= depth_width || ir_y < 0 || ir_y >= depth_height) return false;
+		grid_indices[idx] = ir_x + depth_width*ir_y;
+	}
+	
+	out_color_v_points.resize(n);
+	#pragma omp parallel for
+	for(std::ptrdiff_t idx = 0; idx < n; ++idx) {
+		const real& ir_z = ir_z_points[idx];
 		real& color_z = out_color_z_points[idx];
-		vec3& color_v = color_v_points[idx];
+		vec3& color_v = out_color_v_points[idx];
 		
 		if(ir_z == 0.0) {
 			color_z = 0.0;
@@ -46,17 +81,68 @@ std::vector<vec2> kinect_reprojection::reproject_points_ir_to_color(
 			continue;
 		}
 		
-		// apply depth offset of IR depths
-		real ir_z_offset = reprojection_parameters_.ir_depth_offset(undistorted_ir_i_xy);
-		real corrected_ir_z = ir_z - ir_z_offset;
-			
-		vec3 undistorted_ir_i_h(undistorted_ir_i_xy[0], undistorted_ir_i_xy[1], 1.0);
-		undistorted_ir_i_h *= corrected_ir_z;
-		
-		vec3 ir_v = reprojection_parameters_.ir_intrinsics.K_inv * undistorted_ir_i_h;
-		color_v = reprojection_parameters_.rotation.t() * (ir_v - reprojection_parameters_.translation);
+		std::ptrdiff_t grid_idx = grid_indices[idx];
+		real corrected_ir_z = ir_z - ir_grid_depth_offsets_[grid_idx];
+		color_v = ir_grid_color_rays_[grid_idx] * corrected_ir_z + ir_color_origin_;
 		color_z = color_v[2];
 	}
+	return true;
+}
+
+
+std::vector<vec2> kinect_reprojection::reproject_points_ir_to_color(
+	const std::vector<vec2> distorted_ir_i_xy_points,
+	const std::vector<real>& ir_z_points,
+	std::vector<real>& out_color_z_points,
+	bool distort_color
+) const {
+	std::size_t n = distorted_ir_i_xy_points.size();
+	assert(ir_z_points.size() == n);
+
+	assert(out_color_z_point.size() == n);
+	if(n == 0) return {};
+	
+	// backproject to color view space, using precomputed rays if points are on IR grid
+	std::vector<vec3> color_v_points;
+	if(! backproject_ir_grid_points_(distorted_ir_i_xy_points, ir_z_points, out_color_z_points, color_v_points)) {
+		// undistort XY coordinates of ir points
+		std::vector<vec2> undistorted_ir_i_xy_points(n);
+		cv::undistortPoints(
+			distorted_ir_i_xy_points,
+			undistorted_ir_i_xy_points,
+			reprojection_parameters_.ir_intrinsics.K,
+			reprojection_parameters_.ir_intrinsics.distortion.cv_coeffs(),
+			cv::noArray(),
+			reprojection_parameters_.ir_intrinsics.K
+		);
+		
+		// backproject to ir view space
+		color_v_points.resize(n);
+		#pragma omp parallel for
+		for(int idx = 0; idx < n; ++idx) {
+			const vec2& undistorted_ir_i_xy = undistorted_ir_i_xy_points[idx];
+			const real& ir_z = ir_z_points[idx];		
+			real& color_z = out_color_z_points[idx];
+			vec3& color_v = color_v_points[idx];
+			
+			if(ir_z == 0.0) {
+				color_z = 0.0;
+				color_v = vec3(0.0, 0.0, 0.0);
+				continue;
+			}
+			
+			// apply depth offset of IR depths
+			real ir_z_offset = reprojection_parameters_.ir_depth_offset(undistorted_ir_i_xy);
+			real corrected_ir_z = ir_z - ir_z_offset;
+				
+			vec3 undistorted_ir_i_h(undistorted_ir_i_xy[0], undistorted_ir_i_xy[1], 1.0);
+			undistorted_ir_i_h *= corrected_ir_z;
+			
+			vec3 ir_v = reprojection_parameters_.ir_intrinsics.K_inv * undistorted_ir_i_h;
+			color_v = reprojection_parameters_.rotation.t() * (ir_v - reprojection_parameters_.translation);
+			color_z = color_v[2];
+		}
+	}
 	
 	std::vector<vec2> out_color_i_xy_points(n);
 	
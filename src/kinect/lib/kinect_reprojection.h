@@ -11,15 +11,31 @@
 namespace tlz {
 
 
+/// Reprojection of Kinect IR depth samples into color camera.
+/** For the fixed `depth_width` x `depth_height` IR pixel grid, the undistorted backprojection rays (in color view
+ ** space) and IR depth offsets get precomputed once when the parameters are set. Reprojecting points on that grid
+ ** then needs no per-frame undistortion. */
 class kinect_reprojection {
 private:
 	kinect_reprojection_parameters reprojection_parameters_;
 	
+	std::vector<vec3> ir_grid_color_rays_; // R^T * K_ir^-1 * undistorted IR pixel, per IR grid pixel
+	std::vector<real> ir_grid_depth_offsets_; // IR depth offset at undistorted IR pixel, per IR grid pixel
+	vec3 ir_color_origin_; // -R^T * t, IR camera center in color view space
+
+	void precompute_ir_grid_();
+	bool backproject_ir_grid_points_(
+		const std::vector<vec2>& distorted_ir_i_xy,
+		const std::vector<real>& ir_z,
+		std::vector<real>& out_color_z,
+		std::vector<vec3>& out_color_v
+	) const;
+	
 public:
 	explicit kinect_reprojection(const kinect_reprojection_parameters&);
 	
-	kinect_reprojection_parameters& parameters() { return reprojection_parameters_; }
 	const kinect_reprojection_parameters& parameters() const { return reprojection_parameters_; }
+	void set_parameters(const kinect_reprojection_parameters&);
 	
 	std::vector<vec2> reproject_points_ir_to_color(
 		const std::vector<vec2> distorted_ir_i_xy,
@@ -36,6 +52,19 @@ public:
 		const cv::Mat_<Depth>& distorted_ir_z,
 		bool distort_color = true
 	) const;
+	
+	/// Reproject IR depth map directly into sparse color z-buffer.
+	/** Each IR pixel on the `depth_width` x `depth_height` grid is reprojected, and its color depth written into
+	 ** `z_buffer` at the color pixel, scaled by `scale`, if it is nearer than existing value. Pixels receiving no
+	 ** sample are set to 0. `z_buffer` must already have the wanted size. No intermediate sample array is created.
+	 ** Runs in parallel over IR rows. */
+	template<typename Depth, typename Out>
+	void reproject_ir_to_color_z_buffer(
+		const cv::Mat_<Depth>& distorted_ir_z,
+		cv::Mat_<Out>& z_buffer,
+		real scale = 1.0,
+		bool distort_color = true
+	) const;
 };
 
 }
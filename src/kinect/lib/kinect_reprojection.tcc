@@ -1,4 +1,6 @@
+#include "common.h"
 #include <cassert>
+#include <vector>
 
 namespace tlz {
 
@@ -46,4 +48,65 @@ std::vector<kinect_reprojection::sample<Value>> kinect_reprojection::reproject_i
 	return samples;
 }
 
+
+
+template<typename Depth, typename Out>
+void kinect_reprojection::reproject_ir_to_color_z_buffer(
+	const cv::Mat_<Depth>& distorted_ir_z_img,
+	cv::Mat_<Out>& z_buffer,
+	real scale,
+	bool distort_color
+) const {
+	assert(distorted_ir_z_img.cols == depth_width && distorted_ir_z_img.rows == depth_height);
+	const intrinsics& color_intr = reprojection_parameters_.color_intrinsics;
+	const real fx = color_intr.fx(), fy = color_intr.fy(), cx = color_intr.cx(), cy = color_intr.cy();
+	const bool distort = distort_color && !color_intr.distortion.is_none();
+	const bool has_color_depth_offset = !reprojection_parameters_.color_depth_offset.is_none();
+	
+	// rows are reprojected in parallel, into the z-buffer index and depth for each IR pixel
+	// then z-buffer gets merged on one thread, because rows in different threads can reach the same color pixels
+	const std::ptrdiff_t grid_size = depth_width * depth_height;
+	std::vector<std::ptrdiff_t> z_buffer_indices(grid_size);
+	std::vector<Out> z_buffer_depths(grid_size);
+	const std::ptrdiff_t z_buffer_stride = z_buffer.step / sizeof(Out);
+	#pragma omp parallel for schedule(static)
+	for(int ir_y = 0; ir_y < depth_height; ++ir_y) {
+		const Depth* ir_z_row = distorted_ir_z_img[ir_y];
+		for(int ir_x = 0; ir_x < depth_width; ++ir_x) {
+			std::ptrdiff_t grid_idx = ir_x + depth_width*ir_y;
+			z_buffer_indices[grid_idx] = -1;
+			real ir_z = ir_z_row[ir_x];
+			if(ir_z <= 0.001) continue;
+			
+			// backproject to color view space, using precomputed ray
+			real corrected_ir_z = ir_z - ir_grid_depth_offsets_[grid_idx];
+			vec3 color_v = ir_grid_color_rays_[grid_idx] * corrected_ir_z + ir_color_origin_;
+			real color_z = color_v[2];
+			if(color_z <= 0.0) continue;
+			
+			// project into color image, and apply color depth offset and distortion
+			vec2 color_i_xy(fx * color_v[0] / color_z + cx, fy * color_v[1] / color_z + cy);
+			if(has_color_depth_offset) color_z -= reprojection_parameters_.color_depth_offset(color_i_xy);
+			if(distort) color_i_xy = distort_point(color_intr, color_i_xy);
+
+			// z-buffer pixel
+			int sx = scale * color_i_xy[0], sy = scale * color_i_xy[1];
+			if(sx < 0 || sx >= z_buffer.cols || sy < 0 || sy >= z_buffer.rows) continue;
+			z_buffer_indices[grid_idx] = sx + z_buffer_stride*sy;
+			z_buffer_depths[grid_idx] = color_z;
+		}
+	}
+
+	// write nearest depths into z-buffer
+	z_buffer.setTo(0);
+	Out* z_buffer_data = z_buffer[0];
+	for(std::ptrdiff_t grid_idx = 0; grid_idx < grid_size; ++grid_idx) {
+		std::ptrdiff_t idx = z_buffer_indices[grid_idx];
+		if(idx == -1) continue;
+		Out new_d = z_buffer_depths[grid_idx];
+		Out& d = z_buffer_data[idx];
+		if(d == 0 || new_d < d) d = new_d;
+	}
+}
+
 }
@@ -0,0 +1,139 @@
+#ifndef LICORNEA_KINECT_LIVE_FRAME_RING_H_
+#define LICORNEA_KINECT_LIVE_FRAME_RING_H_
+
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cstddef>
+
+namespace tlz {
+
+/// Lock-free single-producer/single-consumer ring of preallocated frames.
+/** The producer fills the slot returned by write_slot() and then calls commit(). The consumer reads the slot returned
+ ** by read_slot() or read_latest_slot(), and then calls pop(). A slot is not reused by the producer before it was popped.
+ **
+ ** In queue mode, the consumer takes every frame in order with read_slot(). When the ring is full the producer gets
+ ** no slot, and the frame is counted as dropped.
+ ** In latest mode, the ring works as a triple buffer, and the capacity is always 3. The consumer takes the newest
+ ** committed frame with read_latest_slot(). The producer never waits: it always writes into a slot not being read,
+ ** and a committed frame that was not read before the next commit is counted as skipped.
+ **
+ ** Reading and writing slots is lock-free. A consumer with nothing to read can block in wait_until() instead of
+ ** polling: commit() and notify() then take a mutex only to wake it up. */
+template<typename Frame>
+class frame_ring {
+private:
+	static constexpr std::size_t fresh_bit_ = 4; // in latest_, when slot was committed and not yet read
+
+	std::vector<Frame> slots_;
+	bool latest_mode_;
+
+	// queue mode
+	std::atomic<std::size_t> write_count_ { 0 };
+	std::atomic<std::size_t> read_count_ { 0 };
+
+	// latest mode
+	std::size_t writing_ = 0; // owned by producer
+	std::atomic<std::size_t> latest_ { 1 }; // last committed slot, and fresh_bit_
+	std::size_t reading_ = 2; // owned by consumer
+
+	std::atomic<std::size_t> dropped_count_ { 0 };
+	std::atomic<std::size_t> skipped_count_ { 0 };
+
+	std::mutex wait_mutex_;
+	std::condition_variable wait_condition_;
+
+public:
+	explicit frame_ring(std::size_t capacity, bool latest_mode = false) :
+		slots_(latest_mode ? 3 : capacity),
+		latest_mode_(latest_mode) { }
+	frame_ring(const frame_ring&) = delete;
+	frame_ring& operator=(const frame_ring&) = delete;
+
+	std::size_t capacity() const { return slots_.size(); }
+	bool is_latest_mode() const { return latest_mode_; }
+
+	/// Access slot directly, only for preallocating frames before use.
+	Frame& slot(std::size_t i) { return slots_[i]; }
+
+	// producer side
+	Frame* write_slot() {
+		if(latest_mode_) return &slots_[writing_];
+		std::size_t w = write_count_.load(std::memory_order_relaxed);
+		std::size_t r = read_count_.load(std::memory_order_acquire);
+		if(w - r >= capacity()) return nullptr;
+		else return &slots_[w % capacity()];
+	}
+	void commit() {
+		if(latest_mode_) {
+			std::size_t previous = latest_.exchange(writing_ | fresh_bit_, std::memory_order_acq_rel);
+			if(previous & fresh_bit_) skipped_count_.fetch_add(1, std::memory_order_relaxed);
+			writing_ = previous & ~fresh_bit_;
+		} else {
+			write_count_.fetch_add(1, std::memory_order_release);
+		}
+		notify();
+	}
+	void drop() {
+		dropped_count_.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	/// Wake up consumer blocked in wait_until(), so that it checks its stop condition.
+	void notify() {
+		// lock so that the wake-up cannot fall between the consumer's check and its wait
+		{ std::lock_guard<std::mutex> lock(wait_mutex_); }
+		wait_condition_.notify_all();
+	}
+
+	// consumer side
+	/// Whether read_slot() would return a frame.
+	bool readable() const {
+		if(latest_mode_) return ((latest_.load(std::memory_order_acquire) & fresh_bit_) != 0);
+		else return (read_count_.load(std::memory_order_relaxed) != write_count_.load(std::memory_order_acquire));
+	}
+	/// Block until a frame is readable, `stop()` returns true, or `deadline` is reached.
+	/** Returns false on timeout. `stop()` is checked each time the producer calls commit() or notify(). */
+	template<typename Clock, typename Duration, typename Stop>
+	bool wait_until(const std::chrono::time_point<Clock, Duration>& deadline, Stop&& stop) {
+		std::unique_lock<std::mutex> lock(wait_mutex_);
+		return wait_condition_.wait_until(lock, deadline, [&]() { return readable() || stop(); });
+	}
+
+	Frame* read_slot() {
+		if(latest_mode_) return read_latest_slot();
+		std::size_t r = read_count_.load(std::memory_order_relaxed);
+		std::size_t w = write_count_.load(std::memory_order_acquire);
+		if(r == w) return nullptr;
+		else return &slots_[r % capacity()];
+	}
+	Frame* read_latest_slot() {
+		if(latest_mode_) {
+			if(! (latest_.load(std::memory_order_relaxed) & fresh_bit_)) return nullptr;
+			reading_ = latest_.exchange(reading_, std::memory_order_acq_rel) & ~fresh_bit_;
+			return &slots_[reading_];
+		}
+		std::size_t r = read_count_.load(std::memory_order_relaxed);
+		std::size_t w = write_count_.load(std::memory_order_acquire);
+		if(r == w) return nullptr;
+		if(w - r > 1) {
+			skipped_count_.fetch_add(w - r - 1, std::memory_order_relaxed);
+			read_count_.store(w - 1, std::memory_order_release);
+		}
+		return &slots_[(w - 1) % capacity()];
+	}
+	void pop() {
+		// in latest mode, the read slot gets handed back to the producer by the next read_latest_slot()
+		if(! latest_mode_) read_count_.fetch_add(1, std::memory_order_release);
+	}
+
+	/// Number of frames lost because ring was full.
+	std::size_t dropped_count() const { return dropped_count_.load(std::memory_order_relaxed); }
+	/// Number of frames skipped because a newer frame was taken.
+	std::size_t skipped_count() const { return skipped_count_.load(std::memory_order_relaxed); }
+};
+
+}
+
+#endif
@@ -0,0 +1,118 @@
+#ifdef LICORNEA_WITH_LIBFREENECT2
+
+#include "freenect2_grabber.h"
+#include <iostream>
+#include <stdexcept>
+
+namespace tlz {
+
+using namespace libfreenect2;
+
+int freenect2_grabber::freenect2_frame_types_() const {
+	int types = 0;
+	if(has_(color) || has_(registered_color)) types |= Frame::Color;
+	if(has_(ir)) types |= Frame::Ir;
+	if(has_(depth) || has_(bigdepth) || has_(registered_color)) types |= Frame::Depth;
+	return types;
+}
+
+freenect2_grabber::freenect2_grabber(int frame_types) :
+	grabber(frame_types),
+	context_(),
+	pipeline_(new CpuPacketPipeline()),
+	listener_(freenect2_frame_types_()),
+	frames_(),
+	undistorted_depth_(512, 424, 4),
+	undistorted_ir_(512, 424, 4),
+	registered_color_(512, 424, 4),
+	bigdepth_(1920, 1082, 4)
+{
+	setGlobalLogger(nullptr);
+
+	int device_count = context_.enumerateDevices();
+	if(device_count == 0) throw std::runtime_error("Kinect not found");
+
+	std::string serial = context_.getDefaultDeviceSerialNumber();
+	device_ = context_.openDevice(serial, pipeline_);
+	if(! device_) throw std::runtime_error("could not open device");
+
+	std::cout << "Kinect serial number: " << serial << std::endl;
+
+	if(has_(color) || has_(registered_color))
+		device_->setColorFrameListener(&listener_);
+	if(has_(registered_color) || has_(depth) || has_(depth) || has_(bigdepth) || has_(ir))
+		device_->setIrAndDepthFrameListener(&listener_);
+
+	bool ok = device_->start();
+	if(! ok) throw std::runtime_error("could not start device");
+
+	Freenect2Device::ColorCameraParams color = device_->getColorCameraParams();
+	Freenect2Device::IrCameraParams ir = device_->getIrCameraParams();
+	registration_ = std::make_unique<Registration>(ir, color);
+}
+
+
+freenect2_grabber::~freenect2_grabber() {
+	stop_async_();
+
+	// don't delete pipeline (would segfault, bug in Freenect2?)
+	registration_.reset();
+	device_->stop();
+	device_->close();
+}
+
+
+bool freenect2_grabber::read_frame_(grabbed_frame& frame) {
+	const int max_wait_ms = 5000;
+	bool ok = listener_.waitForNewFrame(frames_, max_wait_ms);
+	if(! ok) return false;
+	frame.timestamp = std::chrono::steady_clock::now();
+
+	Frame* raw_color = frames_[Frame::Color];
+	Frame* raw_depth = frames_[Frame::Depth];
+	Frame* raw_ir = frames_[Frame::Ir];
+
+	if(has_(registered_color) || has_(bigdepth)) {
+		registration_->apply(raw_color, raw_depth, &undistorted_depth_, &registered_color_, true, &bigdepth_);
+	} else if(has_(depth)) {
+		registration_->undistortDepth(raw_depth, &undistorted_depth_);
+	}
+	if(has_(ir)) {
+		registration_->undistortDepth(raw_ir, &undistorted_ir_);
+	}
+
+	if(has_(color)) {
+		cv::Mat_<cv::Vec4b> color_orig(1080, 1920, reinterpret_cast<cv::Vec4b*>(raw_color->data));
+		cv::cvtColor(color_orig, frame.color, CV_BGRA2BGR);
+	}
+	if(has_(registered_color)) {
+		cv::Mat_<cv::Vec4b> color_orig(424, 512, reinterpret_cast<cv::Vec4b*>(registered_color_.data));
+		cv::cvtColor(color_orig, frame.registered_color, CV_BGRA2BGR);
+	}
+	if(has_(ir)) {
+		cv::Mat_<float>(424, 512, reinterpret_cast<float*>(raw_ir->data)).copyTo(frame.ir);
+		cv::Mat_<float>(424, 512, reinterpret_cast<float*>(undistorted_ir_.data)).copyTo(frame.undistorted_ir);
+	}
+	if(has_(depth)) {
+		cv::Mat_<float>(424, 512, reinterpret_cast<float*>(raw_depth->data)).copyTo(frame.depth);
+		cv::Mat_<float>(424, 512, reinterpret_cast<float*>(undistorted_depth_.data)).copyTo(frame.undistorted_depth);
+	}
+	if(has_(bigdepth)) {
+		cv::Mat_<float>(1082, 1920, reinterpret_cast<float*>(bigdepth_.data)).copyTo(frame.bigdepth);
+	}
+
+	listener_.release(frames_);
+	return true;
+}
+
+
+kinect_internal_parameters freenect2_grabber::internal_parameters() {
+	auto color = device_->getColorCameraParams();
+	auto ir = device_->getIrCameraParams();
+	return from_freenect2(color, ir);
+}
+
+
+}
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef LICORNEA_KINECT_LIVE_FREENECT2_GRABBER_H_
+#define LICORNEA_KINECT_LIVE_FREENECT2_GRABBER_H_
+
+#include "grabber.h"
+#include "../freenect2.h"
+#include <libfreenect2/libfreenect2.hpp>
+#include <libfreenect2/frame_listener_impl.h>
+#include <libfreenect2/registration.h>
+#include <libfreenect2/packet_pipeline.h>
+#include <libfreenect2/logger.h>
+#include <memory>
+
+namespace tlz {
+
+/// Grabs frames from Kinect using Freenect2.
+class freenect2_grabber : public grabber {
+private:
+	libfreenect2::Freenect2 context_;
+	libfreenect2::CpuPacketPipeline* pipeline_;
+	libfreenect2::SyncMultiFrameListener listener_;
+	libfreenect2::FrameMap frames_;
+	libfreenect2::Freenect2Device* device_;
+	std::unique_ptr<libfreenect2::Registration> registration_;
+	libfreenect2::Frame undistorted_depth_;
+	libfreenect2::Frame undistorted_ir_;
+	libfreenect2::Frame registered_color_;
+	libfreenect2::Frame bigdepth_;
+
+	int freenect2_frame_types_() const;
+
+protected:
+	bool read_frame_(grabbed_frame&) override;
+
+public:
+	explicit freenect2_grabber(int frame_types);
+	~freenect2_grabber() override;
+
+	libfreenect2::Freenect2& context() { return context_; }
+	libfreenect2::Freenect2Device& device() { return *device_; }
+	libfreenect2::Registration& registration() { return *registration_; }
+	kinect_internal_parameters internal_parameters() override;
+};
+
+}
+
+#endif
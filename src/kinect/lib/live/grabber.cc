@@ -1,120 +1,129 @@
-#ifdef LICORNEA_WITH_LIBFREENECT2
-
 #include "grabber.h"
+#include "replay_grabber.h"
+#ifdef LICORNEA_WITH_LIBFREENECT2
+#include "freenect2_grabber.h"
+#endif
 #include <cassert>
-#include <iostream>
+#include <cstdlib>
+#include <chrono>
+#include <stdexcept>
 
 namespace tlz {
 
-using namespace libfreenect2;
-
-int grabber::freenect2_frame_types_() const {
-	int types = 0;
-	if(has_(color) || has_(registered_color)) types |= Frame::Color;
-	if(has_(ir)) types |= Frame::Ir;
-	if(has_(depth) || has_(bigdepth) || has_(registered_color)) types |= Frame::Depth;
-	return types;
-}
-
 grabber::grabber(int frame_types) :
 	frame_types_(frame_types),
-	released_(true),
-	context_(),
-	pipeline_(new CpuPacketPipeline()),
-	listener_(freenect2_frame_types_()),
-	frames_(),
-	undistorted_depth_(512, 424, 4),
-	undistorted_ir_(512, 424, 4),
-	registered_color_(512, 424, 4),
-	bigdepth_(1920, 1082, 4)
+	capture_stop_(false),
+	capture_ended_(false)
 {
-	setGlobalLogger(nullptr);
-	
-	int device_count = context_.enumerateDevices();
-	if(device_count == 0) throw std::runtime_error("Kinect not found");
-
-	std::string serial = context_.getDefaultDeviceSerialNumber();
-	device_ = context_.openDevice(serial, pipeline_);
-	if(! device_) throw std::runtime_error("could not open device");
-	
-	std::cout << "Kinect serial number: " << serial << std::endl;
-
-	if(has_(color) || has_(registered_color))
-		device_->setColorFrameListener(&listener_);
-	if(has_(registered_color) || has_(depth) || has_(depth) || has_(bigdepth) || has_(ir))
-		device_->setIrAndDepthFrameListener(&listener_);
-	
-	bool ok = device_->start();
-	if(! ok) throw std::runtime_error("could not start device");
-
-	Freenect2Device::ColorCameraParams color = device_->getColorCameraParams();
-	Freenect2Device::IrCameraParams ir = device_->getIrCameraParams();
-	registration_ = std::make_unique<Registration>(ir, color);
-}	
+	allocate_frame_(sync_frame_);
+}
 
 
 grabber::~grabber() {
-	// don't delete pipeline (would segfault, bug in Freenect2?)
-	if(! released_) listener_.release(frames_);
-	registration_.reset();
-	device_->stop();
-	device_->close();
+	stop_async_();
+}
+
+
+void grabber::allocate_frame_(grabbed_frame& frame) const {
+	if(has_(color)) frame.color.create(1080, 1920);
+	if(has_(registered_color)) frame.registered_color.create(424, 512);
+	if(has_(ir)) { frame.ir.create(424, 512); frame.undistorted_ir.create(424, 512); }
+	if(has_(depth)) { frame.depth.create(424, 512); frame.undistorted_depth.create(424, 512); }
+	if(has_(bigdepth)) frame.bigdepth.create(1082, 1920);
+}
+
+
+void grabber::capture_thread_main_() {
+	try {
+		while(! capture_stop_) {
+			grabbed_frame* frame = ring_->write_slot();
+			bool ok = read_frame_(frame ? *frame : dropped_frame_);
+			if(! ok) break;
+			if(frame) ring_->commit();
+			else ring_->drop();
+		}
+	} catch(...) {
+		capture_error_ = std::current_exception();
+	}
+	capture_ended_ = true;
+	ring_->notify();
+}
+
+
+void grabber::stop_async_() {
+	if(capture_thread_.joinable()) {
+		capture_stop_ = true;
+		capture_thread_.join();
+	}
+}
+
+
+void grabber::start_async(std::size_t capacity, bool latest) {
+	if(is_async()) throw std::logic_error("grabber already in asynchronous mode");
+	release();
+
+	ring_ = std::make_unique<frame_ring<grabbed_frame>>(capacity, latest);
+	for(std::size_t i = 0; i < ring_->capacity(); ++i) allocate_frame_(ring_->slot(i));
+	allocate_frame_(dropped_frame_);
+	async_latest_ = latest;
+	capture_thread_ = std::thread(&grabber::capture_thread_main_, this);
+}
+
+
+std::size_t grabber::dropped_frames_count() const {
+	return (is_async() ? ring_->dropped_count() : 0);
+}
+
+
+std::size_t grabber::skipped_frames_count() const {
+	return (is_async() ? ring_->skipped_count() : 0);
 }
 
 
 bool grabber::grab() {
-	const int max_wait_ms = 5000;
-	bool ok = listener_.waitForNewFrame(frames_, max_wait_ms);
-	if(! ok) return false;
-	released_ = false;
-	
-	if(has_(registered_color) || has_(bigdepth)) {
-		Frame* raw_color = frames_[Frame::Color];
-		Frame* raw_depth = frames_[Frame::Depth];
-		registration_->apply(raw_color, raw_depth, &undistorted_depth_, &registered_color_, true, &bigdepth_);
-	} else if(has_(depth)) {
-		Frame* raw_depth = frames_[Frame::Depth];
-		registration_->undistortDepth(raw_depth, &undistorted_depth_);
+	release();
+
+	if(! is_async()) {
+		if(! read_frame_(sync_frame_)) return false;
+		current_ = &sync_frame_;
+		return true;
 	}
-	if(has_(ir)) {
-		Frame* raw_ir = frames_[Frame::Ir];
-		registration_->undistortDepth(raw_ir, &undistorted_ir_);
+
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+	for(;;) {
+		// check before reading, so that frames committed before the capture thread ended are not missed
+		bool ended = capture_ended_;
+		current_ = (async_latest_ ? ring_->read_latest_slot() : ring_->read_slot());
+		if(current_) return true;
+		if(ended && capture_error_) std::rethrow_exception(capture_error_);
+		if(ended) return false;
+		bool woken = ring_->wait_until(deadline, [this]() { return capture_ended_.load(); });
+		if(! woken) return false;
 	}
-	
-	return true;
 }
 
 
 void grabber::release() {
-	if(! released_) listener_.release(frames_);
-	released_ = true;
+	if(current_ && is_async()) ring_->pop();
+	current_ = nullptr;
 }
 
 
-	
 cv::Mat_<cv::Vec3b> grabber::get_color_frame() {
-	assert(has_(color));
-	Frame* raw_color = frames_[Frame::Color];
-	cv::Mat_<cv::Vec4b> color_orig(1080, 1920, reinterpret_cast<cv::Vec4b*>(raw_color->data));
-	cv::Mat_<cv::Vec3b> color;
-	cv::cvtColor(color_orig, color, CV_BGRA2BGR);
-	return color;
+	assert(has_(color) && current_);
+	return current_->color;
 }
 
 
 cv::Mat_<cv::Vec3b> grabber::get_registered_color_frame() {
-	assert(has_(registered_color));
-	cv::Mat_<cv::Vec4b> color_orig(424, 512, reinterpret_cast<cv::Vec4b*>(registered_color_.data));
-	cv::Mat_<cv::Vec3b> color;
-	cv::cvtColor(color_orig, color, CV_BGRA2BGR);
-	return color;
+	assert(has_(registered_color) && current_);
+	return current_->registered_color;
 }
 
 
 cv::Mat_<uchar> grabber::get_ir_frame(float min_ir, float max_ir, bool undistorted) {
-	assert(has_(ir));
-	Frame* raw_ir = frames_[Frame::Ir];
-	cv::Mat_<float> ir_orig(424, 512, reinterpret_cast<float*>(undistorted ? undistorted_ir_.data : raw_ir->data));		
+	assert(has_(ir) && current_);
+	const cv::Mat_<float>& ir_orig = (undistorted ? current_->undistorted_ir : current_->ir);
 	float alpha = 255.0f / (max_ir - min_ir);
 	float beta = -alpha * min_ir;
 	cv::Mat_<uchar> ir;
@@ -127,34 +136,45 @@ cv::Mat_<uchar> grabber::get_ir_frame(float min_ir, float max_ir, bool undistort
 
 
 cv::Mat_<ushort> grabber::get_original_ir_frame(bool undistorted) {
-	assert(has_(ir));
-	Frame* raw_ir = frames_[Frame::Ir];
-	cv::Mat_<float> ir_orig(424, 512, reinterpret_cast<float*>(undistorted ? undistorted_ir_.data : raw_ir->data));		
-	return ir_orig;
+	assert(has_(ir) && current_);
+	cv::Mat_<ushort> ir = (undistorted ? current_->undistorted_ir : current_->ir);
+	return ir;
 }
 
 
 cv::Mat_<float> grabber::get_depth_frame(bool undistorted) {
-	assert(has_(depth));
-	Frame* raw_depth = frames_[Frame::Depth];
-	cv::Mat_<float> depth = cv::Mat_<float>(424, 512, reinterpret_cast<float*>(undistorted ? undistorted_depth_.data : raw_depth->data));		
-	return depth;
+	assert(has_(depth) && current_);
+	return (undistorted ? current_->undistorted_depth : current_->depth);
 }
 
 
 cv::Mat_<float> grabber::get_bigdepth_frame() {
-	cv::Mat_<float> depth_orig(1082, 1920, reinterpret_cast<float*>(bigdepth_.data));		
-	return depth_orig.rowRange(1, 1081);
+	assert(has_(bigdepth) && current_);
+	return current_->bigdepth.rowRange(1, 1081);
 }
 
 
-kinect_internal_parameters grabber::internal_parameters() {
-	auto color = device_->getColorCameraParams();
-	auto ir = device_->getIrCameraParams();
-	return from_freenect2(color, ir);
+std::chrono::steady_clock::time_point grabber::get_frame_timestamp() const {
+	assert(current_);
+	return current_->timestamp;
 }
 
 
-}
+std::unique_ptr<grabber> make_grabber(int frame_types) {
+	const char* replay_env = std::getenv("LICORNEA_KINECT_REPLAY");
+	if(replay_env != nullptr && *replay_env != '\0') {
+		replay_options options;
+		options.source = replay_env;
+		if(const char* fps_env = std::getenv("LICORNEA_KINECT_REPLAY_FPS")) options.fps = std::strtod(fps_env, nullptr);
+		if(const char* loop_env = std::getenv("LICORNEA_KINECT_REPLAY_LOOP")) options.loop = (std::string(loop_env) == "1");
+		return std::make_unique<replay_grabber>(frame_types, options);
+	}
 
+#ifdef LICORNEA_WITH_LIBFREENECT2
+	return std::make_unique<freenect2_grabber>(frame_types);
+#else
+	throw std::runtime_error("built without Freenect2, set LICORNEA_KINECT_REPLAY to replay a recording");
 #endif
+}
+
+}
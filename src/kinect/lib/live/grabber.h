@@ -1,20 +1,38 @@
 #ifndef LICORNEA_KINECT_LIVE_GRABBER_H_
 #define LICORNEA_KINECT_LIVE_GRABBER_H_
 
-#include "../../lib/opencv.h"
-#include "../freenect2.h"
+#include "../../../lib/opencv.h"
 #include "../kinect_internal_parameters.h"
-#include <libfreenect2/libfreenect2.hpp>
-#include <libfreenect2/frame_listener_impl.h>
-#include <libfreenect2/registration.h>
-#include <libfreenect2/packet_pipeline.h>
-#include <libfreenect2/logger.h>
+#include "frame_ring.h"
 #include <string>
 #include <memory>
 #include <vector>
+#include <thread>
+#include <atomic>
+#include <exception>
+#include <chrono>
 
 namespace tlz {
 
+/// Frames of all types at one time, as read by the grabber.
+struct grabbed_frame {
+	cv::Mat_<cv::Vec3b> color;
+	cv::Mat_<cv::Vec3b> registered_color;
+	cv::Mat_<float> ir;
+	cv::Mat_<float> undistorted_ir;
+	cv::Mat_<float> depth;
+	cv::Mat_<float> undistorted_depth;
+	cv::Mat_<float> bigdepth;
+	std::chrono::steady_clock::time_point timestamp; ///< when frame was received, set by read_frame_()
+};
+
+
+/// Grabs frames from Kinect, or from a recording.
+/** Subclasses implement read_frame_(), which copies the next frame into preallocated buffers.
+ ** In synchronous mode (default), grab() reads the next frame on the caller's thread, and processing it delays
+ ** grabbing further frames. After start_async(), a capture thread reads the frames into a ring of preallocated
+ ** buffers, and grab() takes either the oldest or the latest one. In both modes, the get_*_frame() results may refer
+ ** to the grabbed frame's memory, and are valid until release() or the next grab(). */
 class grabber {
 public:
 	enum frame_type_value {
@@ -24,45 +42,75 @@ public:
 		bigdepth = 1<<3,
 		ir = 1<<4
 	};
-			
-private:	
+
+private:
 	int frame_types_;
-	bool released_;
-	
-	libfreenect2::Freenect2 context_;
-	libfreenect2::CpuPacketPipeline* pipeline_;
-	libfreenect2::SyncMultiFrameListener listener_;
-	libfreenect2::FrameMap frames_;
-	libfreenect2::Freenect2Device* device_;
-	std::unique_ptr<libfreenect2::Registration> registration_;
-	libfreenect2::Frame undistorted_depth_;
-	libfreenect2::Frame undistorted_ir_;
-	libfreenect2::Frame registered_color_;
-	libfreenect2::Frame bigdepth_;
+	grabbed_frame sync_frame_;
+	grabbed_frame* current_ = nullptr;
+
+	std::unique_ptr<frame_ring<grabbed_frame>> ring_;
+	grabbed_frame dropped_frame_;
+	std::thread capture_thread_;
+	std::atomic<bool> capture_stop_;
+	std::atomic<bool> capture_ended_;
+	std::exception_ptr capture_error_; // set by capture thread before capture_ended_
+	bool async_latest_ = true;
 
+	void allocate_frame_(grabbed_frame&) const;
+	void capture_thread_main_();
+
+protected:
 	bool has_(frame_type_value t) const { return ((frame_types_ & t) != 0); }
-	int freenect2_frame_types_() const;
-	
-public:	
+
 	explicit grabber(int frame_types);
-	~grabber();
-	
+
+	/// Read next frame into \a frame, and set its timestamp. Returns false on timeout, or at end of recording.
+	virtual bool read_frame_(grabbed_frame& frame) = 0;
+
+	/// Stop capture thread. Must be called by subclass destructor, before its frame source gets destroyed.
+	void stop_async_();
+
+public:
+	grabber(const grabber&) = delete;
+	grabber& operator=(const grabber&) = delete;
+	virtual ~grabber();
+
+	int frame_types() const { return frame_types_; }
+
+	/// Start capture thread, which fills ring of `capacity` frames.
+	/** If `latest`, grab() takes the newest frame and skips older ones, otherwise it takes every frame in order.
+	 ** In latest mode the ring is a triple buffer regardless of `capacity`, and the capture thread never drops frames. */
+	void start_async(std::size_t capacity = 4, bool latest = true);
+	bool is_async() const { return (ring_ != nullptr); }
+	/// Number of frames lost in asynchronous mode because the ring was full.
+	std::size_t dropped_frames_count() const;
+	/// Number of frames skipped in asynchronous mode because a newer frame was taken.
+	std::size_t skipped_frames_count() const;
+
+	/// Take next frame. Returns false on timeout, or at end of recording.
+	/** In asynchronous mode, an exception thrown while reading on the capture thread is rethrown here, once the frames
+	 ** read before it have been taken. */
 	bool grab();
 	void release();
-	
-	libfreenect2::Freenect2& context() { return context_; }
-	libfreenect2::Freenect2Device& device() { return *device_; }
-	libfreenect2::Registration& registration() { return *registration_; }
-	kinect_internal_parameters internal_parameters();
-	
+
+	virtual kinect_internal_parameters internal_parameters() = 0;
+
 	cv::Mat_<cv::Vec3b> get_color_frame();
 	cv::Mat_<cv::Vec3b> get_registered_color_frame();
 	cv::Mat_<uchar> get_ir_frame(float min_ir = 0, float max_ir = 0xffff, bool undistorted = false);
-	cv::Mat_<ushort> get_original_ir_frame(bool undistorted = false); 
+	cv::Mat_<ushort> get_original_ir_frame(bool undistorted = false);
 	cv::Mat_<float> get_depth_frame(bool undistorted = false);
 	cv::Mat_<float> get_bigdepth_frame();
+	/// Time when grabbed frame was received. In asynchronous mode this is on the capture thread, not in grab().
+	std::chrono::steady_clock::time_point get_frame_timestamp() const;
 };
 
+
+/// Create grabber for Kinect, or for replaying a recording.
+/** If the environment variable `LICORNEA_KINECT_REPLAY` is set, a replay_grabber is created which plays the snapshots
+ ** directory or dataset pack it names (see replay_grabber.h). Otherwise the Kinect is opened using Freenect2. */
+std::unique_ptr<grabber> make_grabber(int frame_types);
+
 }
 
 #endif
@@ -0,0 +1,206 @@
+#include "replay_grabber.h"
+#include "../../../lib/filesystem.h"
+#include "../../../lib/image_io.h"
+#include "../../../lib/json.h"
+#include <format.h>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <thread>
+#include <stdexcept>
+
+namespace tlz {
+
+namespace {
+	const std::string color_subdirectory_ = "images";
+	const std::string depth_subdirectory_ = "depths";
+	const std::string ir_subdirectory_ = "ir";
+	const std::string internal_parameters_name_ = "internal_parameters.json";
+}
+
+
+std::string replay_grabber::entry_name_(const std::string& subdirectory, std::size_t index) const {
+	return subdirectory + "/" + fmt::format(options_.filename_template, index);
+}
+
+
+dataset_pack_blob replay_grabber::read_entry_(const std::string& name) {
+	if(pack_) return pack_->find(name);
+
+	std::string filename = filename_append(options_.source, name);
+	std::ifstream stream(filename, std::ios_base::binary | std::ios_base::ate);
+	if(! stream) return dataset_pack_blob();
+	file_buffer_.resize(stream.tellg());
+	stream.seekg(0);
+	stream.read(reinterpret_cast<char*>(file_buffer_.data()), file_buffer_.size());
+	if(! stream) throw std::runtime_error("could not read " + filename);
+
+	dataset_pack_blob blob;
+	blob.data = file_buffer_.data();
+	blob.size = file_buffer_.size();
+	return blob;
+}
+
+
+dataset_pack_blob replay_grabber::read_required_entry_(const std::string& name) {
+	dataset_pack_blob blob = read_entry_(name);
+	if(! blob) throw std::runtime_error("recording " + options_.source + " has no " + name);
+	return blob;
+}
+
+
+std::size_t replay_grabber::count_frames_() {
+	if(recording_) return recording_->frames_count();
+
+	std::string subdirectory;
+	if(has_(color)) subdirectory = color_subdirectory_;
+	else if(has_(depth)) subdirectory = depth_subdirectory_;
+	else subdirectory = ir_subdirectory_;
+
+	std::size_t count = 0;
+	if(pack_) {
+		while(pack_->has(entry_name_(subdirectory, count))) ++count;
+	} else {
+		while(file_exists(filename_append(options_.source, entry_name_(subdirectory, count)))) ++count;
+	}
+	return count;
+}
+
+
+void replay_grabber::read_internal_parameters_() {
+	dataset_pack_blob blob;
+	if(! recording_) blob = read_entry_(internal_parameters_name_);
+	if(! blob) {
+		if(has_(depth) || has_(ir))
+			std::cout << "recording has no " << internal_parameters_name_ << ", undistorted frames are not undistorted" << std::endl;
+		return;
+	}
+
+	const char* text = reinterpret_cast<const char*>(blob.data);
+	internal_parameters_ = decode_kinect_internal_parameters(json::parse(text, text + blob.size));
+	has_internal_parameters_ = true;
+
+	const auto& par = internal_parameters_.ir;
+	cv::Matx33d camera_mat(
+		par.fx, 0.0, par.cx,
+		0.0, par.fy, par.cy,
+		0.0, 0.0, 1.0
+	);
+	std::vector<real> distortion_coeffs = { par.k1, par.k2, par.p1, par.p2, par.k3 };
+	cv::initUndistortRectifyMap(camera_mat, distortion_coeffs, cv::noArray(), camera_mat, cv::Size(512, 424), CV_32FC1, undistort_map_x_, undistort_map_y_);
+}
+
+
+void replay_grabber::undistort_(const cv::Mat_<float>& in, cv::Mat_<float>& out) const {
+	if(has_internal_parameters_) cv::remap(in, out, undistort_map_x_, undistort_map_y_, cv::INTER_NEAREST, cv::BORDER_CONSTANT, cv::Scalar(0));
+	else in.copyTo(out);
+}
+
+
+replay_grabber::replay_grabber(int frame_types, const replay_options& options) :
+	grabber(frame_types),
+	options_(options)
+{
+	if(has_(registered_color) || has_(bigdepth))
+		throw std::invalid_argument("replay grabber cannot provide registered color or big depth frames");
+
+	if(is_file(options_.source)) {
+		if(kinect_recording::is_recording(options_.source)) recording_ = std::make_unique<kinect_recording>(options_.source);
+		else pack_ = std::make_unique<dataset_pack>(options_.source);
+	} else if(! is_directory(options_.source)) throw std::runtime_error("recording " + options_.source + " not found");
+
+	frames_count_ = count_frames_();
+	if(frames_count_ == 0) throw std::runtime_error("recording " + options_.source + " has no frames");
+	std::cout << "replaying " << frames_count_ << " frames from " << options_.source << std::endl;
+
+	read_internal_parameters_();
+}
+
+
+replay_grabber::~replay_grabber() {
+	stop_async_();
+
+	if(started_) {
+		real elapsed = std::chrono::duration<real>(clock::now() - start_time_).count();
+		std::size_t consumed_count = read_frames_count_ - dropped_frames_count() - skipped_frames_count();
+		std::cout << "replayed " << read_frames_count_ << " frames in " << elapsed << " s, "
+			<< consumed_count / std::max(elapsed, 1e-9) << " frames/s consumed" << std::endl;
+	}
+}
+
+
+void replay_grabber::read_snapshot_(std::size_t index, grabbed_frame& frame) {
+	if(has_(color)) {
+		dataset_pack_blob blob = read_required_entry_(entry_name_(color_subdirectory_, index));
+		frame.color = decode_texture(blob.data, blob.size);
+		if(frame.color.cols != 1920 || frame.color.rows != 1080) throw std::runtime_error("recorded color frame has wrong size");
+	}
+	if(has_(depth)) {
+		dataset_pack_blob blob = read_required_entry_(entry_name_(depth_subdirectory_, index));
+		cv::Mat_<ushort> depth = decode_depth(blob.data, blob.size);
+		if(depth.cols != 512 || depth.rows != 424) throw std::runtime_error("recorded depth frame has wrong size");
+		depth.convertTo(frame.depth, CV_32F);
+		undistort_(frame.depth, frame.undistorted_depth);
+	}
+	if(has_(ir)) {
+		dataset_pack_blob blob = read_required_entry_(entry_name_(ir_subdirectory_, index));
+		cv::Mat_<ushort> ir = decode_depth(blob.data, blob.size);
+		if(ir.cols != 512 || ir.rows != 424) throw std::runtime_error("recorded ir frame has wrong size");
+		ir.convertTo(frame.ir, CV_32F);
+		undistort_(frame.ir, frame.undistorted_ir);
+	}
+}
+
+
+void replay_grabber::read_recording_frame_(std::size_t index, grabbed_frame& frame) {
+	if(has_(color)) {
+		frame.color = recording_->color(index);
+		if(frame.color.empty()) throw std::runtime_error("Kinect recording has no color frames");
+	}
+	if(has_(depth)) {
+		cv::Mat_<ushort> depth = recording_->depth(index);
+		if(depth.empty()) throw std::runtime_error("Kinect recording has no depth frames");
+		depth.convertTo(frame.depth, CV_32F);
+		undistort_(frame.depth, frame.undistorted_depth);
+	}
+	if(has_(ir)) {
+		cv::Mat_<ushort> ir = recording_->ir(index);
+		if(ir.empty()) throw std::runtime_error("Kinect recording has no ir frames");
+		ir.convertTo(frame.ir, CV_32F);
+		undistort_(frame.ir, frame.undistorted_ir);
+	}
+}
+
+
+bool replay_grabber::read_frame_(grabbed_frame& frame) {
+	if(! started_) {
+		start_time_ = clock::now();
+		started_ = true;
+	}
+
+	std::size_t index = position_;
+	if(options_.fps > 0.0) {
+		real elapsed = std::chrono::duration<real>(clock::now() - start_time_).count();
+		index = std::max(index, static_cast<std::size_t>(elapsed * options_.fps));
+		auto due_time = start_time_ + std::chrono::duration_cast<clock::duration>(std::chrono::duration<real>(index / options_.fps));
+		std::this_thread::sleep_until(due_time);
+	}
+	if(index >= frames_count_ && ! options_.loop) return false;
+	position_ = index + 1;
+	index %= frames_count_;
+	frame.timestamp = clock::now();
+
+	if(recording_) read_recording_frame_(index, frame);
+	else read_snapshot_(index, frame);
+
+	++read_frames_count_;
+	return true;
+}
+
+
+kinect_internal_parameters replay_grabber::internal_parameters() {
+	if(! has_internal_parameters_) throw std::runtime_error("recording " + options_.source + " has no " + internal_parameters_name_);
+	return internal_parameters_;
+}
+
+}
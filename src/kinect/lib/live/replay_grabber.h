@@ -0,0 +1,72 @@
+#ifndef LICORNEA_KINECT_LIVE_REPLAY_GRABBER_H_
+#define LICORNEA_KINECT_LIVE_REPLAY_GRABBER_H_
+
+#include "grabber.h"
+#include "../../../lib/common.h"
+#include "../../../lib/dataset_pack.h"
+#include "../kinect_recording.h"
+#include <string>
+#include <memory>
+#include <vector>
+#include <chrono>
+
+namespace tlz {
+
+struct replay_options {
+	std::string source; ///< Snapshots directory, dataset pack file, or Kinect recording file.
+	std::string filename_template = "snap_{:04d}.png";
+	real fps = 30.0; ///< Replay speed in frames per second, or 0 for maximal speed.
+	bool loop = false;
+};
+
+
+/// Replays recorded Kinect snapshots through the grabber interface.
+/** Frames are read from the `images/`, `depths/` and `ir/` subdirectories of the source, with names from
+ ** `filename_template` and indices starting at 0, as written by the Kinect viewer. The source can also be a dataset
+ ** pack of such a directory, or a Kinect recording file. If a snapshots directory or pack contains
+ ** `internal_parameters.json`, undistorted IR and depth frames are computed using the IR intrinsics, otherwise they are
+ ** the same as the original frames.
+ ** At real-time speed, frames whose time has passed while the consumer was busy are skipped, like with the Kinect. */
+class replay_grabber : public grabber {
+private:
+	using clock = std::chrono::steady_clock;
+
+	replay_options options_;
+	std::unique_ptr<dataset_pack> pack_;
+	std::unique_ptr<kinect_recording> recording_;
+	std::vector<byte> file_buffer_;
+	std::size_t frames_count_ = 0;
+
+	bool has_internal_parameters_ = false;
+	kinect_internal_parameters internal_parameters_;
+	cv::Mat_<float> undistort_map_x_;
+	cv::Mat_<float> undistort_map_y_;
+
+	bool started_ = false;
+	clock::time_point start_time_;
+	std::size_t position_ = 0;
+	std::size_t read_frames_count_ = 0;
+
+	std::string entry_name_(const std::string& subdirectory, std::size_t index) const;
+	dataset_pack_blob read_entry_(const std::string& name);
+	dataset_pack_blob read_required_entry_(const std::string& name);
+	std::size_t count_frames_();
+	void read_internal_parameters_();
+	void undistort_(const cv::Mat_<float>& in, cv::Mat_<float>& out) const;
+	void read_snapshot_(std::size_t index, grabbed_frame&);
+	void read_recording_frame_(std::size_t index, grabbed_frame&);
+
+protected:
+	bool read_frame_(grabbed_frame&) override;
+
+public:
+	replay_grabber(int frame_types, const replay_options&);
+	~replay_grabber() override;
+
+	std::size_t frames_count() const { return frames_count_; }
+	kinect_internal_parameters internal_parameters() override;
+};
+
+}
+
+#endif
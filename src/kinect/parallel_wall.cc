@@ -83,7 +83,7 @@ int main(int argc, const char* argv[]) {
 	kinect_reprojection_parameters reprojection_parameters = decode_kinect_reprojection_parameters(import_json_file(reprojection_parameters_filename));
 	kinect_reprojection reprojection(reprojection_parameters);
 
-	grabber grab(grabber::color | grabber::depth);
+	auto grab = make_grabber(grabber::color | grabber::depth);
 
 	viewer view("Parallel to Wall", 754+754, 424);
 	view.indicator_color = cv::Vec3b(0, 0, 255);
@@ -98,16 +98,16 @@ int main(int argc, const char* argv[]) {
 	bool running = true;
 	while(running) {
 		try {
-			grab.grab();
+			if(! grab->grab()) break;
 			view.clear();
 	
-			cv::Mat_<cv::Vec3b> color = grab.get_color_frame();
-			cv::Mat_<real> depth = grab.get_depth_frame();
+			cv::Mat_<cv::Vec3b> color = grab->get_color_frame();
+			cv::Mat_<real> depth = grab->get_depth_frame();
 	
 			auto samples = reprojection.reproject_ir_to_color_samples(depth, depth, true);
 			densifier->densify(samples, reprojected_depth);
 	
-			grab.release();
+			grab->release();
 	
 			// get ROI & compute depth slopes
 			int min_x = border_x_slider, max_x = texture_width - border_x_slider;
@@ -0,0 +1,58 @@
+#include "../lib/args.h"
+#include "../lib/viewer.h"
+#include "lib/live/grabber.h"
+#include "lib/kinect_recording.h"
+#include <chrono>
+#include <iostream>
+#include <cstdint>
+
+using namespace tlz;
+
+int main(int argc, const char* argv[]) {
+	get_args(argc, argv, "out_recording.krec [jpeg/raw] [jpeg_quality]");
+	std::string out_recording_filename = out_filename_arg();
+	std::string color_format_name = enum_opt_arg({ "jpeg", "raw" }, "jpeg");
+	int jpeg_quality = int_opt_arg(90);
+
+	kinect_recording_color_format color_format = (color_format_name == "raw" ? kinect_recording_color_format::raw : kinect_recording_color_format::jpeg);
+
+	auto grab = make_grabber(grabber::color | grabber::depth | grabber::ir);
+	grab->start_async(8, false);
+
+	kinect_recording_writer writer(out_recording_filename, color_format, jpeg_quality);
+
+	viewer view(754+512, 424);
+	auto& min_d = view.add_int_slider("depth min ", 0, 0, 20000);
+	auto& max_d = view.add_int_slider("depth max", 6000, 0, 20000);
+
+	std::cout << "recording... (esc to end)" << std::endl;
+	auto start_time = std::chrono::steady_clock::now();
+	std::chrono::steady_clock::time_point first_frame_time;
+	bool first_frame = true;
+	bool cont = true;
+	while(cont) {
+		if(! grab->grab()) break;
+
+		// time when capture thread received the frame, not when it gets taken here
+		auto frame_time = grab->get_frame_timestamp();
+		if(first_frame) { first_frame_time = frame_time; first_frame = false; }
+		std::uint64_t timestamp_us = std::chrono::duration_cast<std::chrono::microseconds>(frame_time - first_frame_time).count();
+		cv::Mat_<cv::Vec3b> color = grab->get_color_frame();
+		cv::Mat_<float> depth = grab->get_depth_frame();
+		cv::Mat_<ushort> ir = grab->get_original_ir_frame();
+		writer.write(timestamp_us, color, depth, ir);
+
+		view.clear();
+		view.draw(cv::Rect(0, 0, 754, 424), color);
+		view.draw_depth(cv::Rect(754, 0, 512, 424), depth, min_d, max_d);
+		grab->release();
+
+		cont = view.show();
+	}
+
+	real elapsed = std::chrono::duration<real>(std::chrono::steady_clock::now() - start_time).count();
+	writer.close();
+	std::cout << "recorded " << writer.written_frames_count() << " frames in " << elapsed << " s, "
+		<< writer.dropped_frames_count() << " dropped by writer, "
+		<< grab->dropped_frames_count() << " dropped by grabber" << std::endl;
+}
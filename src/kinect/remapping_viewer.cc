@@ -29,7 +29,7 @@ int main(int argc, const char* argv[]) {
 	std::pair<freenect2_color_params, freenect2_ir_params> freenect2_internal = to_freenect2(internal_parameters);
 	libfreenect2::Registration registration(freenect2_internal.second, freenect2_internal.first);
 
-	grabber grab(grabber::color | grabber::ir | grabber::depth);
+	auto grab = make_grabber(grabber::color | grabber::ir | grabber::depth);
 	kinect_reprojection	reproj(reprojection_parameters);
 
 	int h = 324;
@@ -49,15 +49,15 @@ int main(int argc, const char* argv[]) {
 	do {
 		int z_offset = offset.value();
 
-		grab.grab();
+		if(! grab->grab()) break;
 		view.clear();
 				
-		cv::Mat_<cv::Vec3b> color = grab.get_color_frame();
-		cv::Mat_<uchar> ir = grab.get_ir_frame();
-		cv::Mat_<float> depth = grab.get_depth_frame();
+		cv::Mat_<cv::Vec3b> color = grab->get_color_frame();
+		cv::Mat_<uchar> ir = grab->get_ir_frame();
+		cv::Mat_<float> depth = grab->get_depth_frame();
 
-		cv::Mat_<uchar> undistorted_ir = grab.get_ir_frame(true);
-		cv::Mat_<float> undistorted_depth = grab.get_depth_frame(true);
+		cv::Mat_<uchar> undistorted_ir = grab->get_ir_frame(true);
+		cv::Mat_<float> undistorted_depth = grab->get_depth_frame(true);
 		
 		// IR+depth to color mapping using Freenect2 registration
 		z_buffer.setTo(INFINITY);
@@ -113,7 +113,7 @@ int main(int argc, const char* argv[]) {
 			view.draw(cv::Rect(2*w, 20, w, h), color, blend);
 		}
 
-		grab.release();
+		grab->release();
 	
 
 		// measure error
@@ -30,7 +30,7 @@ int main(int argc, const char* argv[]) {
 	kinect_reprojection_parameters reprojection_parameters = decode_kinect_reprojection_parameters(import_json_file(reprojection_parameters_filename));
 	kinect_reprojection reprojection(reprojection_parameters);
 
-	grabber grab(grabber::color | grabber::depth);
+	auto grab = make_grabber(grabber::color | grabber::depth);
 
 	viewer view(754+754, 424+30);
 	auto& min_d = view.add_int_slider("depth min ", 0, 0, 20000);
@@ -45,12 +45,13 @@ int main(int argc, const char* argv[]) {
 	
 	bool running = true;
 	while(running) {
-		grab.grab();
+		if(! grab->grab()) break;
 		view.clear();
 
-		cv::Mat_<cv::Vec3b> color = grab.get_color_frame();
-		cv::Mat_<real> depth = grab.get_depth_frame();
+		cv::Mat_<cv::Vec3b> color = grab->get_color_frame();
+		cv::Mat_<real> depth = grab->get_depth_frame();
 
+		if(densifier->uses_guide()) densifier->set_guide(color);
 		auto samples = reprojection.reproject_ir_to_color_samples(depth, depth, true);
 		if(used_depth_mode == depth_mode::original)
 			for(auto& samp : samples) samp.color_depth = samp.ir_depth;
@@ -78,7 +79,7 @@ int main(int argc, const char* argv[]) {
 		view.draw_text(cv::Rect(754+40+2*label_w, 424, label_w, 30), "(d) difference", viewer::left, col(depth_mode::difference));
 
 
-		grab.release();
+		grab->release();
 		
 		int keycode;
 		running = view.show(keycode);
@@ -15,7 +15,8 @@ int main(int argc, const char* argv[]) {
 	std::string out_depths_dir = out_dirname_opt_arg("snap/depths/");
 	std::string out_ir_dir = out_dirname_opt_arg("snap/ir/");
 	
-	grabber grab(grabber::color | grabber::depth | grabber::ir);
+	auto grab = make_grabber(grabber::color | grabber::depth | grabber::ir);
+	grab->start_async();
 
 	viewer view(754+512+512, 424);
 	auto& min_d = view.add_int_slider("depth min ", 0, 0, 20000);
@@ -27,19 +28,17 @@ int main(int argc, const char* argv[]) {
 	
 	bool cont = true;
 	while(cont) {
-		grab.grab();
+		if(! grab->grab()) break;
 		view.clear();
 		
-		cv::Mat_<cv::Vec3b> image = grab.get_color_frame();
-		cv::Mat_<ushort> ir = grab.get_original_ir_frame();
-		cv::Mat_<real> depth = grab.get_depth_frame();
+		cv::Mat_<cv::Vec3b> image = grab->get_color_frame();
+		cv::Mat_<ushort> ir = grab->get_original_ir_frame();
+		cv::Mat_<real> depth = grab->get_depth_frame();
 		
 		view.draw(cv::Rect(0, 0, 754, 424), image);
 		view.draw(cv::Rect(754, 0, 512, 424), viewer::visualize_ir(ir, min_ir, max_ir));
 		view.draw_depth(cv::Rect(754+512, 0, 512, 424), depth, min_d, max_d);
 		
-		grab.release();
-		
 		int keycode;
 		cont = view.show(keycode);
 		if(keycode == enter_keycode) {
@@ -53,5 +52,9 @@ int main(int argc, const char* argv[]) {
 			save_depth(out_depth_filename, depth);
 			save_ir(out_ir_filename, ir);
 		}
+		
+		grab->release();
 	}
+	
+	std::cout << grab->dropped_frames_count() << " frames dropped, " << grab->skipped_frames_count() << " frames skipped" << std::endl;
 }
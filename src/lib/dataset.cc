@@ -2,11 +2,17 @@
 #include "string.h"
 #include "filesystem.h"
 #include "os.h"
+#include "assert.h"
+#include "image_cache.h"
+#include "image_io.h"
+#include "dataset_pack.h"
+#include "depth_codec.h"
 #include <format.h>
 #include <stdexcept>
 #include <fstream>
 #include <string>
 #include <ostream>
+#include <algorithm>
 
 namespace tlz {
 	
@@ -35,15 +41,58 @@ std::string dataset_view::format_name(const std::string& tpl) const {
 	else return fmt::format(tpl, fmt::arg("x", x_));
 }
 
+std::string dataset_view::format_relpath(const std::string& tpl) const {
+	if(dataset_.is_2d()) return fmt::format(tpl, fmt::arg("x", local_filename_x_()), fmt::arg("y", local_filename_y_()));
+	else return fmt::format(tpl, fmt::arg("x", local_filename_x_()));
+}
+
 std::string dataset_view::format_filename(const std::string& tpl) const {
-	std::string relpath;
-	if(dataset_.is_2d()) relpath = fmt::format(tpl, fmt::arg("x", local_filename_x_()), fmt::arg("y", local_filename_y_()));
-	else relpath =  fmt::format(tpl, fmt::arg("x", local_filename_x_()));
-	return dataset_.filepath(relpath);
+	return dataset_.filepath(format_relpath(tpl));
+}
+
+std::string dataset_view::formatted_(const std::string& name, dataset_path_kind kind) const {
+	dataset_path_tables& tables = dataset_.path_tables();
+	int group_id = (kind == dataset_path_kind::name ? 0 : group_id_); // names are only formatted in root group
+	int template_id = tables.template_id(name);
+	if(group_id == -1 || template_id == -1) return std::string();
+
+	const dataset_path_table* table = tables.get(group_id, template_id, kind, [&]() -> std::unique_ptr<dataset_path_table> {
+		const std::string& grp = tables.groups()[group_id];
+		const json& params = (grp.empty() ? dataset_.parameters() : dataset_.parameters()[grp]);
+		std::string tpl = get_or(params, name, std::string());
+		if(tpl.empty()) return nullptr;
+
+		auto new_table = std::make_unique<dataset_path_table>(dataset_.views_count());
+		for(int y : dataset_.y_indices()) for(int x : dataset_.x_indices()) {
+			dataset_view view(dataset_, x, y, grp);
+			switch(kind) {
+				case dataset_path_kind::name: new_table->push_back(view.format_name(tpl)); break;
+				case dataset_path_kind::relpath: new_table->push_back(view.format_relpath(tpl)); break;
+				case dataset_path_kind::filename: new_table->push_back(view.format_filename(tpl)); break;
+			}
+		}
+		return new_table;
+	});
+	if(table) return (*table)[dataset_.view_number(x_, y_)];
+	else return std::string();
+}
+
+cv::Mat dataset_view::load_packed_(const std::string& name, int type) const {
+	std::string relpath = local_relpath(name);
+	return dataset_.cache().load(relpath, type, [&]() -> cv::Mat {
+		dataset_pack_blob blob = dataset_.pack().find(relpath);
+		if(! blob) throw std::runtime_error("no " + relpath + " in dataset pack");
+		switch(type) {
+			case CV_8UC3: return decode_texture(blob.data, blob.size);
+			case CV_8UC1: return decode_gray(blob.data, blob.size);
+			case CV_16UC1: return decode_depth(blob.data, blob.size);
+			default: throw std::logic_error("unsupported image type");
+		}
+	});
 }
 
 dataset_view::dataset_view(const dataset& datas, int x, int y, const std::string& grp) :
-	dataset_(datas), x_(x), y_(y), group_(grp) { }
+	dataset_(datas), x_(x), y_(y), group_(grp), group_id_(datas.path_tables().group_id(grp)) { }
 
 
 const json& dataset_view::local_parameters() const {
@@ -52,13 +101,24 @@ const json& dataset_view::local_parameters() const {
 }
  
 std::string dataset_view::local_filename(const std::string& name, const std::string& def) const {
-	std::string tpl = get_or(local_parameters(), name, std::string());
-	if(! tpl.empty()) return format_filename(tpl);
+	std::string filename = formatted_(name, dataset_path_kind::filename);
+	if(! filename.empty()) return filename;
 	else return def;
 }
 
+std::string dataset_view::local_relpath(const std::string& name) const {
+	return formatted_(name, dataset_path_kind::relpath);
+}
+
+bool dataset_view::local_file_exists(const std::string& name) const {
+	if(dataset_.is_packed()) return dataset_.pack().has(local_relpath(name));
+	else return file_exists(local_filename(name));
+}
+
 std::string dataset_view::camera_name() const {	
-	return format_name(dataset_.parameters()["camera_name_format"]);
+	std::string name = formatted_("camera_name_format", dataset_path_kind::name);
+	if(name.empty()) throw std::runtime_error("dataset has no camera_name_format");
+	return name;
 }
 
 std::string dataset_view::image_filename() const {
@@ -73,6 +133,40 @@ std::string dataset_view::mask_filename() const {
 	return local_filename("mask_filename_format");
 }
 
+bool dataset_view::image_exists() const {
+	return local_file_exists("image_filename_format");
+}
+
+bool dataset_view::depth_exists() const {
+	return local_file_exists("depth_filename_format");
+}
+
+bool dataset_view::mask_exists() const {
+	return local_file_exists("mask_filename_format");
+}
+
+cv::Mat_<cv::Vec3b> dataset_view::load_texture() const {
+	if(dataset_.is_packed()) return load_packed_("image_filename_format", CV_8UC3);
+	else return dataset_.cache().load_texture(image_filename());
+}
+
+cv::Mat_<uchar> dataset_view::load_gray() const {
+	if(dataset_.is_packed()) return load_packed_("image_filename_format", CV_8UC1);
+	else return dataset_.cache().load_gray(image_filename());
+}
+
+cv::Mat_<ushort> dataset_view::load_depth() const {
+	if(dataset_.is_packed()) return load_packed_("depth_filename_format", CV_16UC1);
+	else return dataset_.cache().load_depth(depth_filename());
+}
+
+void dataset_view::save_depth(const cv::Mat_<ushort>& depth) const {
+	if(dataset_.is_packed()) throw std::runtime_error("cannot save depth map into dataset pack");
+	std::string filename = depth_filename();
+	tlz::save_depth(filename, depth, *make_depth_codec(dataset_.group(group_).depth_codec_name()));
+	dataset_.cache().invalidate(filename);
+}
+
 std::string dataset_view::group() const {
 	return group_;
 }
@@ -98,6 +192,10 @@ border dataset_group::image_border() const {
 	else return border();
 }
 
+std::string dataset_group::depth_codec_name() const {
+	return get_or(parameters(), "depth_codec", std::string("png"));
+}
+
 cv::Size dataset_group::image_size_with_border() const {
 	return add_border(image_border(), dataset_.image_size());
 }
@@ -117,7 +215,9 @@ dataset_view dataset_group::view(view_index idx) const {
 /////
 
 
-dataset::dataset(const std::string& parameters_filename) {
+dataset::dataset(const std::string& parameters_filename) :
+	image_cache_(std::make_shared<image_cache>(default_image_cache_capacity()))
+{
 	std::size_t last_sep_pos = parameters_filename.find_last_of('/');
 	if(last_sep_pos == std::string::npos) dirname_ = "./";
 	else dirname_ = parameters_filename.substr(0, last_sep_pos + 1);
@@ -128,6 +228,34 @@ dataset::dataset(const std::string& parameters_filename) {
 	for(int v : parameters_["x_index_range"]) x_index_range_.push_back(v);
 	if(parameters_.count("y_index_range") == 1)
 		for(int v : parameters_["y_index_range"]) y_index_range_.push_back(v);
+	
+	if(parameters_.count("pack_filename") == 1)
+		pack_ = std::make_shared<dataset_pack>(filepath(parameters_["pack_filename"]));
+
+	init_path_tables_();
+}
+
+void dataset::init_path_tables_() {
+	// groups are the object parameters, templates the string parameters ending with "_format"
+	// tables get built on first use, so that errors in templates only occur for templates actually used
+	const std::string format_suffix = "_format";
+	std::vector<std::string> groups = { "" }, templates;
+	auto add_templates = [&](const json& params) {
+		for(auto it = params.begin(); it != params.end(); ++it) {
+			const std::string& key = it.key();
+			bool is_template = it->is_string() && (key.size() > format_suffix.size())
+				&& (key.compare(key.size() - format_suffix.size(), format_suffix.size(), format_suffix) == 0);
+			if(is_template && std::find(templates.begin(), templates.end(), key) == templates.end())
+				templates.push_back(key);
+		}
+	};
+	add_templates(parameters_);
+	for(auto it = parameters_.begin(); it != parameters_.end(); ++it) {
+		if(! it->is_object()) continue;
+		groups.push_back(it.key());
+		add_templates(*it);
+	}
+	path_tables_ = std::make_shared<dataset_path_tables>(groups, templates);
 }
 
 bool dataset::is_1d() const {
@@ -232,6 +360,15 @@ bool dataset::valid(view_index idx) const {
 	return x_valid(idx.x) && y_valid(idx.y);
 }
 
+std::size_t dataset::views_count() const {
+	return x_count() * y_count();
+}
+
+std::ptrdiff_t dataset::view_number(int x, int y) const {
+	Assert(x_valid(x) && y_valid(y));
+	return ((y - y_min()) / y_step()) * x_count() + (x - x_min()) / x_step();
+}
+
 std::vector<view_index> dataset::indices() const {
 	std::vector<view_index> list;
 	for(int x = x_min(); x <= x_max(); x += x_step())
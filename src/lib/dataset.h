@@ -4,26 +4,38 @@
 #include <string>
 #include <utility>
 #include <iosfwd>
+#include <memory>
 #include "border.h"
 #include "json.h"
 #include "border.h"
 #include "args.h"
+#include "opencv.h"
+#include "dataset_path_table.h"
 
 namespace tlz {
 
 class dataset;
+class image_cache;
+class dataset_pack;
+class depth_codec_base;
 
 class dataset_view {
+	friend class dataset;
+
 private:
 	const dataset& dataset_;
 	int x_;
 	int y_;
 	std::string group_;
+	int group_id_; // in dataset's path tables
 
 	int local_filename_x_() const;
 	int local_filename_y_() const;
 	std::string format_name(const std::string& tpl) const;
+	std::string format_relpath(const std::string& tpl) const;
 	std::string format_filename(const std::string& tpl) const;
+	std::string formatted_(const std::string& name, dataset_path_kind kind) const;
+	cv::Mat load_packed_(const std::string& name, int type) const;
 
 public:
 	dataset_view(const dataset&, int x, int y, const std::string& grp = "");
@@ -35,12 +47,29 @@ public:
 	
 	const json& local_parameters() const;
 	std::string local_filename(const std::string& name, const std::string& def = "") const;
+	std::string local_relpath(const std::string& name) const;
+	bool local_file_exists(const std::string& name) const;
 	
 	std::string camera_name() const;
 	
 	std::string image_filename() const;
 	std::string depth_filename() const;
 	std::string mask_filename() const;
+	
+	/// Whether the file exists, on the filesystem or in the dataset pack.
+	bool image_exists() const;
+	bool depth_exists() const;
+	bool mask_exists() const;
+
+	/// Load image or depth map of this view, through the dataset's image cache.
+	/** Reads from the dataset pack instead of the filesystem if the dataset is packed. The result may share its data
+	 ** with the cache, and must be cloned before modifying it. */
+	cv::Mat_<cv::Vec3b> load_texture() const;
+	cv::Mat_<uchar> load_gray() const;
+	cv::Mat_<ushort> load_depth() const;
+	
+	/// Save depth map of this view, encoded with the group's depth codec.
+	void save_depth(const cv::Mat_<ushort>&) const;
 
 	std::string group() const;
 	dataset_view group_view(const std::string& name) const;
@@ -62,6 +91,7 @@ public:
 		{ return parameters()[key]; }
 	
 	border image_border() const;
+	std::string depth_codec_name() const;
 	cv::Size image_size_with_border() const;
 	
 	dataset_view view(int x) const;
@@ -76,6 +106,11 @@ private:
 	std::string dirname_;
 	std::vector<int> x_index_range_;
 	std::vector<int> y_index_range_;
+	std::shared_ptr<image_cache> image_cache_;
+	std::shared_ptr<dataset_pack> pack_;
+	std::shared_ptr<dataset_path_tables> path_tables_;
+
+	void init_path_tables_();
 	
 public:
 	explicit dataset(const std::string& parameters_filename);
@@ -94,6 +129,17 @@ public:
 	cv::Size image_size() const;
 	std::string cameras_filename() const;
 	
+	/// Cache of decoded images of this dataset, shared by copies of the dataset object.
+	image_cache& cache() const { return *image_cache_; }
+	
+	/// Whether the dataset files are stored in a dataset pack, set by `pack_filename` parameter.
+	bool is_packed() const { return (pack_ != nullptr); }
+	const dataset_pack& pack() const { return *pack_; }
+	
+	/// Names and file paths of views, formatted for all views of a group and template when first used.
+	/** Shared by copies of the dataset object, and thread-safe. */
+	dataset_path_tables& path_tables() const { return *path_tables_; }
+	
 	int x_min() const;
 	int x_step() const;
 	int x_max() const;
@@ -111,6 +157,9 @@ public:
 	std::vector<int> y_indices() const;
 	
 	bool valid(view_index) const;
+	std::size_t views_count() const;
+	/// Linear index of view, in `[0, views_count())`. Views are numbered row by row.
+	std::ptrdiff_t view_number(int x, int y) const;
 	std::vector<view_index> indices() const;
 
 	dataset_group group(const std::string& grp) const;
@@ -0,0 +1,153 @@
+#include "dataset_pack.h"
+#include "assert.h"
+#include <algorithm>
+#include <stdexcept>
+#include <iterator>
+
+namespace tlz {
+
+namespace {
+	const std::int32_t dataset_pack_magic_ = 0x4B50434C;
+	const std::int32_t dataset_pack_version_ = 1;
+
+	static_assert(sizeof(dataset_pack_entry) == 32, "unexpected dataset_pack_entry layout");
+	static_assert(sizeof(dataset_pack_footer) == 40, "unexpected dataset_pack_footer layout");
+}
+
+
+dataset_pack::dataset_pack(const std::string& filename) :
+	file_(filename)
+{
+	const byte* data = file_.data();
+	std::size_t size = file_.size();
+
+	if(size < sizeof(dataset_pack_footer)) throw std::runtime_error("dataset pack file " + filename + " too small");
+	footer_ = reinterpret_cast<const dataset_pack_footer*>(data + size - sizeof(dataset_pack_footer));
+	if(footer_->magic != dataset_pack_magic_) throw std::runtime_error("file " + filename + " is not a dataset pack");
+	if(footer_->version != dataset_pack_version_) throw std::runtime_error("dataset pack file " + filename + " has unsupported version");
+
+	std::size_t end = size - sizeof(dataset_pack_footer);
+	if(footer_->index_offset % 8 != 0 || footer_->index_offset > end || footer_->entries_count > (end - footer_->index_offset) / sizeof(dataset_pack_entry))
+		throw std::runtime_error("dataset pack file " + filename + " is corrupt");
+	if(footer_->names_offset > end || footer_->names_size > end - footer_->names_offset)
+		throw std::runtime_error("dataset pack file " + filename + " is corrupt");
+
+	entries_ = reinterpret_cast<const dataset_pack_entry*>(data + footer_->index_offset);
+	names_ = reinterpret_cast<const char*>(data + footer_->names_offset);
+
+	for(std::ptrdiff_t i = 0; i < entries_count(); ++i) {
+		const dataset_pack_entry& entry = entries_[i];
+		if(entry.name_offset > footer_->names_size || entry.name_length > footer_->names_size - entry.name_offset ||
+		   entry.data_offset > end || entry.data_size > end - entry.data_offset)
+			throw std::runtime_error("dataset pack file " + filename + " is corrupt");
+	}
+}
+
+
+std::string dataset_pack::entry_name_(const dataset_pack_entry& entry) const {
+	return std::string(names_ + entry.name_offset, entry.name_length);
+}
+
+
+std::vector<std::string> dataset_pack::entry_names() const {
+	std::vector<std::string> names;
+	for(std::ptrdiff_t i = 0; i < entries_count(); ++i) names.push_back(entry_name_(entries_[i]));
+	return names;
+}
+
+
+dataset_pack_blob dataset_pack::find(const std::string& name) const {
+	const dataset_pack_entry* begin = entries_;
+	const dataset_pack_entry* end = entries_ + entries_count();
+	auto it = std::lower_bound(begin, end, name, [this](const dataset_pack_entry& entry, const std::string& name) {
+		return (name.compare(0, std::string::npos, names_ + entry.name_offset, entry.name_length) > 0);
+	});
+	dataset_pack_blob blob;
+	if(it != end && name.compare(0, std::string::npos, names_ + it->name_offset, it->name_length) == 0) {
+		blob.data = file_.data() + it->data_offset;
+		blob.size = it->data_size;
+	}
+	return blob;
+}
+
+/////
+
+dataset_pack_writer::dataset_pack_writer(const std::string& filename) :
+	stream_(filename, std::ios_base::binary)
+{
+	if(! stream_) throw std::runtime_error("could not open dataset pack file " + filename + " for writing");
+}
+
+
+dataset_pack_writer::~dataset_pack_writer() {
+	if(! closed_) try {
+		close();
+	} catch(const std::runtime_error&) { }
+}
+
+
+void dataset_pack_writer::write_(const void* data, std::size_t size) {
+	stream_.write(static_cast<const std::ostream::char_type*>(data), size);
+	position_ += size;
+}
+
+
+void dataset_pack_writer::align_() {
+	static const char padding[8] = { 0 };
+	std::size_t padding_size = (8 - position_ % 8) % 8;
+	write_(padding, padding_size);
+}
+
+
+void dataset_pack_writer::add(const std::string& name, const byte* data, std::size_t size) {
+	Assert(! closed_);
+	align_();
+
+	dataset_pack_entry entry;
+	entry.name_offset = names_.size();
+	entry.name_length = name.length();
+	entry.data_offset = position_;
+	entry.data_size = size;
+	entries_.push_back(entry);
+	names_.append(name);
+
+	write_(data, size);
+	if(! stream_) throw std::runtime_error("could not write to dataset pack file");
+}
+
+
+void dataset_pack_writer::add_file(const std::string& name, const std::string& filename) {
+	std::ifstream input(filename, std::ios_base::binary);
+	if(! input) throw std::runtime_error("could not open " + filename);
+	std::vector<char> contents((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+	add(name, reinterpret_cast<const byte*>(contents.data()), contents.size());
+}
+
+
+void dataset_pack_writer::close() {
+	Assert(! closed_);
+	closed_ = true;
+
+	std::sort(entries_.begin(), entries_.end(), [this](const dataset_pack_entry& a, const dataset_pack_entry& b) {
+		return (names_.compare(a.name_offset, a.name_length, names_, b.name_offset, b.name_length) < 0);
+	});
+
+	dataset_pack_footer footer;
+	footer.magic = dataset_pack_magic_;
+	footer.version = dataset_pack_version_;
+	footer.entries_count = entries_.size();
+
+	align_();
+	footer.index_offset = position_;
+	write_(entries_.data(), entries_.size() * sizeof(dataset_pack_entry));
+	footer.names_offset = position_;
+	footer.names_size = names_.size();
+	write_(names_.data(), names_.size());
+	align_();
+	write_(&footer, sizeof(dataset_pack_footer));
+
+	stream_.close();
+	if(! stream_) throw std::runtime_error("could not write dataset pack file");
+}
+
+}
@@ -0,0 +1,99 @@
+#ifndef LICORNEA_DATASET_PACK_H_
+#define LICORNEA_DATASET_PACK_H_
+
+#include "common.h"
+#include "memory_mapped_file.h"
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdint>
+
+namespace tlz {
+
+/*
+Packed dataset file format.
+Holds the (encoded) image files of a dataset in one file, so that they can be accessed without per-file
+filesystem operations. Entries are named by their file path relative to the dataset parameters file.
+
+   entries data   contents of the packed files, each 8-byte aligned
+   index          dataset_pack_entry[entries_count], sorted by name
+   names          concatenated entry names
+   footer         dataset_pack_footer
+*/
+
+struct dataset_pack_entry {
+	std::uint64_t name_offset;
+	std::uint64_t name_length;
+	std::uint64_t data_offset;
+	std::uint64_t data_size;
+};
+
+struct dataset_pack_footer {
+	std::int32_t magic;
+	std::int32_t version;
+	std::uint64_t entries_count;
+	std::uint64_t index_offset;
+	std::uint64_t names_offset;
+	std::uint64_t names_size;
+};
+
+
+/// Contents of one file in a dataset pack.
+struct dataset_pack_blob {
+	const byte* data = nullptr;
+	std::size_t size = 0;
+
+	explicit operator bool () const { return (data != nullptr); }
+};
+
+
+/// Read-only access to memory mapped dataset pack.
+class dataset_pack {
+private:
+	memory_mapped_file file_;
+	const dataset_pack_footer* footer_ = nullptr;
+	const dataset_pack_entry* entries_ = nullptr;
+	const char* names_ = nullptr;
+
+	std::string entry_name_(const dataset_pack_entry&) const;
+
+public:
+	explicit dataset_pack(const std::string& filename);
+
+	std::size_t entries_count() const { return footer_->entries_count; }
+	std::vector<std::string> entry_names() const;
+
+	/// Find entry with given name, returns null blob if it does not exist.
+	dataset_pack_blob find(const std::string& name) const;
+	bool has(const std::string& name) const { return static_cast<bool>(find(name)); }
+};
+
+
+/// Sequential writer of dataset pack files.
+class dataset_pack_writer {
+private:
+	std::ofstream stream_;
+	std::uint64_t position_ = 0;
+	std::string names_;
+	std::vector<dataset_pack_entry> entries_;
+	bool closed_ = false;
+
+	void write_(const void* data, std::size_t size);
+	void align_();
+
+public:
+	explicit dataset_pack_writer(const std::string& filename);
+	~dataset_pack_writer();
+
+	void add(const std::string& name, const byte* data, std::size_t size);
+	void add_file(const std::string& name, const std::string& filename);
+
+	std::size_t entries_count() const { return entries_.size(); }
+
+	/// Write index and footer. Called by destructor if not called before.
+	void close();
+};
+
+}
+
+#endif
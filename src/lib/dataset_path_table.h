@@ -0,0 +1,102 @@
+#ifndef LICORNEA_DATASET_PATH_TABLE_H_
+#define LICORNEA_DATASET_PATH_TABLE_H_
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <algorithm>
+#include <cstdint>
+
+namespace tlz {
+
+enum class dataset_path_kind { name, relpath, filename };
+
+/// Formatted names or file paths for all views of a dataset, concatenated into one buffer.
+/** Indexed by dataset::view_number(). Each entry is NUL-terminated in the buffer, so that lookups return a pointer
+ ** into it without copying. */
+class dataset_path_table {
+private:
+	std::string chars_;
+	std::vector<std::uint32_t> offsets_;
+
+public:
+	explicit dataset_path_table(std::size_t views_count) { offsets_.reserve(views_count); }
+
+	std::size_t size() const { return offsets_.size(); }
+
+	void push_back(const std::string& str) {
+		offsets_.push_back(chars_.size());
+		chars_.append(str);
+		chars_.push_back('\0');
+	}
+
+	const char* operator[](std::ptrdiff_t i) const { return chars_.data() + offsets_[i]; }
+
+	bool operator==(const dataset_path_table& other) const
+		{ return (offsets_ == other.offsets_) && (chars_ == other.chars_); }
+};
+
+
+/// Path tables of all groups and templates of a dataset, each built on its first lookup.
+/** Groups and templates are identified by integer ids. Once a table is built it is read-only, and lookups need no
+ ** locking. Tables with the same contents (for example the relpaths of a template shared by several groups) are
+ ** interned, and stored only once. */
+class dataset_path_tables {
+private:
+	static constexpr std::size_t kinds_count_ = 3;
+
+	struct slot_ {
+		std::once_flag built;
+		std::shared_ptr<const dataset_path_table> table; // null if template undefined for group
+	};
+
+	std::vector<std::string> groups_;
+	std::vector<std::string> templates_;
+	std::vector<slot_> slots_;
+
+	std::mutex intern_mutex_;
+	std::vector<std::shared_ptr<const dataset_path_table>> interned_;
+
+	static int find_(const std::vector<std::string>& names, const std::string& name) {
+		auto it = std::find(names.begin(), names.end(), name);
+		if(it == names.end()) return -1;
+		else return it - names.begin();
+	}
+
+	std::shared_ptr<const dataset_path_table> intern_(std::unique_ptr<dataset_path_table> table) {
+		if(! table) return nullptr;
+		std::lock_guard<std::mutex> lock(intern_mutex_);
+		for(const auto& interned_table : interned_)
+			if(*interned_table == *table) return interned_table;
+		interned_.emplace_back(std::move(table));
+		return interned_.back();
+	}
+
+public:
+	dataset_path_tables(const std::vector<std::string>& groups, const std::vector<std::string>& templates) :
+		groups_(groups), templates_(templates), slots_(groups.size() * templates.size() * kinds_count_) { }
+	dataset_path_tables(const dataset_path_tables&) = delete;
+	dataset_path_tables& operator=(const dataset_path_tables&) = delete;
+
+	const std::vector<std::string>& groups() const { return groups_; }
+	const std::vector<std::string>& templates() const { return templates_; }
+
+	/// Id of group or template, or -1 if it has no tables.
+	int group_id(const std::string& group) const { return find_(groups_, group); }
+	int template_id(const std::string& name) const { return find_(templates_, name); }
+
+	/// Get table, calling `build()` to create it on the first lookup.
+	/** `build()` returns a `std::unique_ptr<dataset_path_table>`, or null if the template is not defined for the group.
+	 ** Then null is returned. If `build()` throws, the exception is passed on and the next lookup tries again. */
+	template<typename Build>
+	const dataset_path_table* get(int group_id, int template_id, dataset_path_kind kind, Build&& build) {
+		slot_& slot = slots_[(group_id * templates_.size() + template_id) * kinds_count_ + static_cast<std::size_t>(kind)];
+		std::call_once(slot.built, [&]() { slot.table = intern_(build()); });
+		return slot.table.get();
+	}
+};
+
+}
+
+#endif
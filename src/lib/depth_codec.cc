@@ -0,0 +1,327 @@
+#include "depth_codec.h"
+#include "string.h"
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <fstream>
+
+namespace tlz {
+
+namespace {
+	const std::int32_t rice_magic_ = 0x4344434C;
+	const std::int32_t rice_version_ = 1;
+	const int rice_stripe_rows_ = 32;
+	const int rice_block_size_ = 16;
+	const int rice_escape_length_ = 24;
+
+	struct rice_header {
+		std::int32_t magic;
+		std::int32_t version;
+		std::int32_t width;
+		std::int32_t height;
+		std::int32_t stripe_rows;
+		std::int32_t stripes_count;
+	};
+
+	
+	inline int count_leading_zeros_(std::uint64_t x) {
+		#if defined(__GNUC__) || defined(__clang__)
+		return __builtin_clzll(x);
+		#else
+		int n = 0;
+		while(! (x & (std::uint64_t(1) << 63))) { x <<= 1; ++n; }
+		return n;
+		#endif
+	}
+
+	
+	/// Median edge detection predictor.
+	inline int predict_(int a, int b, int c) {
+		int mx = std::max(a, b), mn = std::min(a, b);
+		if(c >= mx) return mn;
+		else if(c <= mn) return mx;
+		else return a + b - c;
+	}
+
+	
+	class bit_writer {
+	private:
+		std::vector<byte>& out_;
+		std::uint64_t acc_ = 0;
+		int bits_ = 0;
+
+	public:
+		explicit bit_writer(std::vector<byte>& out) : out_(out) { }
+
+		void put(std::uint32_t value, int n) {
+			acc_ = (acc_ << n) | value;
+			bits_ += n;
+			while(bits_ >= 8) {
+				bits_ -= 8;
+				out_.push_back(byte(acc_ >> bits_));
+			}
+		}
+		
+		void flush() {
+			if(bits_ > 0) put(0, 8 - bits_);
+		}
+	};
+
+	
+	class bit_reader {
+	private:
+		const byte* pos_;
+		const byte* end_;
+		std::uint64_t acc_ = 0; // left-aligned
+		int bits_ = 0;
+
+		void refill_() {
+			while(bits_ <= 56) {
+				std::uint64_t b = (pos_ < end_ ? *pos_++ : 0);
+				acc_ |= b << (56 - bits_);
+				bits_ += 8;
+			}
+		}
+
+	public:
+		bit_reader(const byte* begin, const byte* end) : pos_(begin), end_(end) { }
+
+		std::uint32_t get(int n) {
+			if(n == 0) return 0;
+			refill_();
+			std::uint32_t value = std::uint32_t(acc_ >> (64 - n));
+			acc_ <<= n;
+			bits_ -= n;
+			return value;
+		}
+		
+		/// Read number of 0 bits before next 1 bit, up to \a max.
+		int get_zeros(int max) {
+			refill_();
+			int zeros = (acc_ == 0 ? 64 : count_leading_zeros_(acc_));
+			if(zeros >= max) {
+				acc_ <<= max;
+				bits_ -= max;
+				return max;
+			} else {
+				acc_ <<= zeros + 1;
+				bits_ -= zeros + 1;
+				return zeros;
+			}
+		}
+	};
+
+	
+	/// Rice parameter for block of residuals, such that 2^k is approximately their mean.
+	inline int rice_parameter_(const std::uint16_t* residuals, int count) {
+		std::uint32_t sum = 0;
+		for(int i = 0; i < count; ++i) sum += residuals[i];
+		int k = 0;
+		while(k < 15 && (std::uint32_t(count) << (k + 1)) <= sum) ++k;
+		return k;
+	}
+
+	
+	void encode_stripe_(const cv::Mat_<ushort>& depth, int y_begin, int y_end, std::vector<byte>& out) {
+		int width = depth.cols;
+		std::vector<std::uint16_t> residuals(std::size_t(y_end - y_begin) * width);
+		
+		std::uint16_t* residual = residuals.data();
+		for(int y = y_begin; y < y_end; ++y) {
+			const ushort* row = depth[y];
+			const ushort* up_row = (y > y_begin ? depth[y - 1] : nullptr);
+			for(int x = 0; x < width; ++x) {
+				int pred;
+				if(up_row == nullptr) pred = (x > 0 ? row[x - 1] : 0);
+				else if(x == 0) pred = up_row[x];
+				else pred = predict_(row[x - 1], up_row[x], up_row[x - 1]);
+				
+				std::int16_t diff = std::int16_t(std::uint16_t(row[x] - pred));
+				*residual++ = std::uint16_t(std::uint16_t(diff) << 1) ^ std::uint16_t(diff >> 15);
+			}
+		}
+		
+		bit_writer writer(out);
+		for(std::size_t block = 0; block < residuals.size(); block += rice_block_size_) {
+			int count = std::min<std::size_t>(rice_block_size_, residuals.size() - block);
+			const std::uint16_t* block_residuals = residuals.data() + block;
+			int k = rice_parameter_(block_residuals, count);
+			writer.put(k, 4);
+			for(int i = 0; i < count; ++i) {
+				std::uint32_t r = block_residuals[i];
+				std::uint32_t q = r >> k;
+				if(q < rice_escape_length_) {
+					writer.put(1, q + 1);
+					writer.put(r & ((1u << k) - 1), k);
+				} else {
+					writer.put(0, rice_escape_length_);
+					writer.put(r, 16);
+				}
+			}
+		}
+		writer.flush();
+	}
+
+	
+	void decode_stripe_(const byte* begin, const byte* end, int y_begin, int y_end, cv::Mat_<ushort>& depth) {
+		int width = depth.cols;
+		std::size_t count = std::size_t(y_end - y_begin) * width;
+		std::vector<std::uint16_t> residuals(count);
+		
+		bit_reader reader(begin, end);
+		for(std::size_t block = 0; block < count; block += rice_block_size_) {
+			int block_count = std::min<std::size_t>(rice_block_size_, count - block);
+			int k = reader.get(4);
+			for(int i = 0; i < block_count; ++i) {
+				int q = reader.get_zeros(rice_escape_length_);
+				if(q < rice_escape_length_) residuals[block + i] = (std::uint32_t(q) << k) | reader.get(k);
+				else residuals[block + i] = reader.get(16);
+			}
+		}
+		
+		const std::uint16_t* residual = residuals.data();
+		for(int y = y_begin; y < y_end; ++y) {
+			ushort* row = depth[y];
+			const ushort* up_row = (y > y_begin ? depth[y - 1] : nullptr);
+			for(int x = 0; x < width; ++x) {
+				int pred;
+				if(up_row == nullptr) pred = (x > 0 ? row[x - 1] : 0);
+				else if(x == 0) pred = up_row[x];
+				else pred = predict_(row[x - 1], up_row[x], up_row[x - 1]);
+				
+				std::uint16_t r = *residual++;
+				std::int16_t diff = std::int16_t((r >> 1) ^ (~(r & 1) + 1));
+				row[x] = ushort(pred + diff);
+			}
+		}
+	}
+}
+
+
+std::vector<byte> png_depth_codec::encode(const cv::Mat_<ushort>& depth) const {
+	std::vector<int> params = { CV_IMWRITE_PNG_COMPRESSION, compression_level_ };
+	std::vector<byte> data;
+	if(! cv::imencode(".png", depth, data, params)) throw std::runtime_error("could not PNG encode depth map");
+	return data;
+}
+
+
+cv::Mat_<ushort> png_depth_codec::decode(const byte* data, std::size_t size) const {
+	cv::Mat buf(1, size, CV_8U, const_cast<byte*>(data));
+	cv::Mat mat = cv::imdecode(buf, CV_LOAD_IMAGE_ANYDEPTH);
+	if(mat.empty()) throw std::runtime_error("could not decode PNG depth map");
+	if(mat.depth() != CV_16U) throw std::runtime_error("PNG depth map is not 16 bit");
+	cv::Mat_<ushort> mat_ = mat;
+	return mat_;
+}
+
+/////
+
+std::vector<byte> rice_depth_codec::encode(const cv::Mat_<ushort>& depth) const {
+	rice_header header;
+	header.magic = rice_magic_;
+	header.version = rice_version_;
+	header.width = depth.cols;
+	header.height = depth.rows;
+	header.stripe_rows = rice_stripe_rows_;
+	header.stripes_count = (depth.rows + rice_stripe_rows_ - 1) / rice_stripe_rows_;
+	
+	std::vector<std::vector<byte>> stripes(header.stripes_count);
+	#pragma omp parallel for
+	for(std::ptrdiff_t stripe = 0; stripe < header.stripes_count; ++stripe) {
+		int y_begin = stripe * rice_stripe_rows_;
+		int y_end = std::min(y_begin + rice_stripe_rows_, depth.rows);
+		stripes[stripe].reserve(std::size_t(y_end - y_begin) * depth.cols);
+		encode_stripe_(depth, y_begin, y_end, stripes[stripe]);
+	}
+	
+	std::vector<std::uint64_t> stripe_sizes;
+	std::size_t total_size = sizeof(rice_header) + stripes.size() * sizeof(std::uint64_t);
+	for(const std::vector<byte>& stripe : stripes) {
+		stripe_sizes.push_back(stripe.size());
+		total_size += stripe.size();
+	}
+	
+	std::vector<byte> data(total_size);
+	byte* out = data.data();
+	std::memcpy(out, &header, sizeof(rice_header));
+	out += sizeof(rice_header);
+	std::memcpy(out, stripe_sizes.data(), stripe_sizes.size() * sizeof(std::uint64_t));
+	out += stripe_sizes.size() * sizeof(std::uint64_t);
+	for(const std::vector<byte>& stripe : stripes) {
+		std::memcpy(out, stripe.data(), stripe.size());
+		out += stripe.size();
+	}
+	return data;
+}
+
+
+cv::Mat_<ushort> rice_depth_codec::decode(const byte* data, std::size_t size) const {
+	if(! is_encoded(data, size)) throw std::runtime_error("not a Rice coded depth map");
+	if(size < sizeof(rice_header)) throw std::runtime_error("Rice coded depth map is truncated");
+	rice_header header;
+	std::memcpy(&header, data, sizeof(rice_header));
+	if(header.version != rice_version_) throw std::runtime_error("Rice coded depth map has unsupported version");
+	if(header.width < 0 || header.height < 0 || header.stripe_rows <= 0 ||
+	   header.stripes_count != (header.height + header.stripe_rows - 1) / header.stripe_rows)
+		throw std::runtime_error("Rice coded depth map is corrupt");
+	
+	std::size_t table_end = sizeof(rice_header) + std::size_t(header.stripes_count) * sizeof(std::uint64_t);
+	if(size < table_end) throw std::runtime_error("Rice coded depth map is truncated");
+	std::vector<std::uint64_t> stripe_sizes(header.stripes_count);
+	std::memcpy(stripe_sizes.data(), data + sizeof(rice_header), stripe_sizes.size() * sizeof(std::uint64_t));
+
+	std::vector<std::size_t> stripe_offsets(header.stripes_count);
+	std::size_t offset = table_end;
+	for(std::ptrdiff_t stripe = 0; stripe < header.stripes_count; ++stripe) {
+		if(stripe_sizes[stripe] > size - offset) throw std::runtime_error("Rice coded depth map is truncated");
+		stripe_offsets[stripe] = offset;
+		offset += stripe_sizes[stripe];
+	}
+	
+	cv::Mat_<ushort> depth(header.height, header.width);
+	#pragma omp parallel for
+	for(std::ptrdiff_t stripe = 0; stripe < header.stripes_count; ++stripe) {
+		int y_begin = stripe * header.stripe_rows;
+		int y_end = std::min(y_begin + header.stripe_rows, header.height);
+		const byte* begin = data + stripe_offsets[stripe];
+		decode_stripe_(begin, begin + stripe_sizes[stripe], y_begin, y_end, depth);
+	}
+	return depth;
+}
+
+
+bool rice_depth_codec::is_encoded(const byte* data, std::size_t size) {
+	if(size < sizeof(rice_magic_)) return false;
+	std::int32_t magic;
+	std::memcpy(&magic, data, sizeof(magic));
+	return (magic == rice_magic_);
+}
+
+/////
+
+std::unique_ptr<depth_codec_base> make_depth_codec(const std::string& name) {
+	if(name == "png") return std::make_unique<png_depth_codec>(0);
+	else if(name == "png_fast") return std::make_unique<png_depth_codec>(1);
+	else if(name == "png_max") return std::make_unique<png_depth_codec>(9);
+	else if(name == "rice") return std::make_unique<rice_depth_codec>();
+	else throw std::invalid_argument("unknown depth codec " + name);
+}
+
+
+std::vector<std::string> depth_codec_names() {
+	return { "png", "png_fast", "png_max", "rice" };
+}
+
+
+void save_depth(const std::string& filename, const cv::Mat_<ushort>& depth, const depth_codec_base& codec) {
+	if(file_name_extension(filename) != codec.file_extension())
+		throw std::invalid_argument("depth map " + filename + " must have extension ." + codec.file_extension() + " for its codec");
+	std::vector<byte> data = codec.encode(depth);
+	std::ofstream stream(filename, std::ios_base::binary);
+	stream.write(reinterpret_cast<const char*>(data.data()), data.size());
+	if(! stream) throw std::runtime_error("could not write depth map " + filename);
+}
+
+}
@@ -0,0 +1,66 @@
+#ifndef LICORNEA_DEPTH_CODEC_H_
+#define LICORNEA_DEPTH_CODEC_H_
+
+#include "common.h"
+#include "opencv.h"
+#include <vector>
+#include <memory>
+#include <string>
+
+namespace tlz {
+
+/// Lossless codec for 16 bit depth maps.
+class depth_codec_base {
+public:
+	virtual ~depth_codec_base() = default;
+
+	virtual std::vector<byte> encode(const cv::Mat_<ushort>&) const = 0;
+	virtual cv::Mat_<ushort> decode(const byte* data, std::size_t size) const = 0;
+
+	/// File name extension of encoded depth maps, without dot.
+	virtual std::string file_extension() const = 0;
+};
+
+
+/// PNG depth codec, using OpenCV.
+class png_depth_codec : public depth_codec_base {
+private:
+	int compression_level_;
+
+public:
+	explicit png_depth_codec(int compression_level = 0) :
+		compression_level_(compression_level) { }
+
+	std::vector<byte> encode(const cv::Mat_<ushort>&) const override;
+	cv::Mat_<ushort> decode(const byte* data, std::size_t size) const override;
+	std::string file_extension() const override { return "png"; }
+};
+
+
+/// Fast depth codec, with median edge detection prediction and adaptive Rice coding of residuals.
+/** The image is divided into horizontal stripes that are encoded independently, and in parallel.
+ ** In each stripe, pixels are predicted from their left, upper and upper left neighbors (as in LOCO-I).
+ ** The residuals are Rice coded, with a parameter chosen per block of pixels. Suited for Kinect depth maps,
+ ** which are smooth and have large regions of zeroes. */
+class rice_depth_codec : public depth_codec_base {
+public:
+	std::vector<byte> encode(const cv::Mat_<ushort>&) const override;
+	cv::Mat_<ushort> decode(const byte* data, std::size_t size) const override;
+	std::string file_extension() const override { return "rice"; }
+
+	static bool is_encoded(const byte* data, std::size_t size);
+};
+
+
+/// Create depth codec by name: `png`, `png_fast`, `png_max` or `rice`.
+std::unique_ptr<depth_codec_base> make_depth_codec(const std::string& name);
+std::vector<std::string> depth_codec_names();
+
+/// Encode depth map with \a codec and write it to file.
+/** The file name must have the codec's extension, so that Rice coded data never gets written to a `.png` file.
+ ** load_depth() detects the codec when reading it back. */
+void save_depth(const std::string& filename, const cv::Mat_<ushort>&, const depth_codec_base& codec);
+
+}
+
+#endif
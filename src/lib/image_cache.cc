@@ -0,0 +1,141 @@
+#include "image_cache.h"
+#include "image_io.h"
+#include <cstdlib>
+#include <limits>
+#include <stdexcept>
+
+namespace tlz {
+
+namespace {
+	const std::size_t default_image_cache_size_mb_ = 512;
+}
+
+
+image_cache::image_cache(std::size_t capacity) :
+	capacity_(capacity) { }
+
+
+void image_cache::evict_() {
+	while(size_ > capacity_ && ! entries_.empty()) {
+		const entry& lru = entries_.back();
+		size_ -= lru.bytes;
+		index_.erase(lru.key);
+		entries_.pop_back();
+	}
+}
+
+
+cv::Mat image_cache::load(const std::string& key_name, int type, const std::function<cv::Mat()>& loader) {
+	key_type key(key_name, type);
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		auto it = index_.find(key);
+		if(it != index_.end()) {
+			++hits_;
+			entries_.splice(entries_.begin(), entries_, it->second);
+			return it->second->image;
+		}
+		++misses_;
+	}
+
+	// decode without holding the lock, so that different images can be loaded in parallel
+	cv::Mat image = loader();
+	std::size_t bytes = image.total() * image.elemSize();
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	if(bytes > capacity_ || index_.count(key) == 1) return image;
+	entries_.push_front(entry { key, image, bytes });
+	index_[key] = entries_.begin();
+	size_ += bytes;
+	evict_();
+	return image;
+}
+
+
+cv::Mat_<cv::Vec3b> image_cache::load_texture(const std::string& filename) {
+	return load(filename, CV_8UC3, [&filename]() -> cv::Mat {
+		return tlz::load_texture(filename);
+	});
+}
+
+
+cv::Mat_<uchar> image_cache::load_gray(const std::string& filename) {
+	return load(filename, CV_8UC1, [&filename]() -> cv::Mat {
+		cv::Mat mat = cv::imread(filename, CV_LOAD_IMAGE_GRAYSCALE);
+		if(mat.empty()) throw std::runtime_error("could not load texture " + filename);
+		return mat;
+	});
+}
+
+
+cv::Mat_<ushort> image_cache::load_depth(const std::string& filename) {
+	return load(filename, CV_16UC1, [&filename]() -> cv::Mat {
+		return tlz::load_depth(filename);
+	});
+}
+
+
+std::size_t image_cache::capacity() const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return capacity_;
+}
+
+
+void image_cache::set_capacity(std::size_t capacity) {
+	std::lock_guard<std::mutex> lock(mutex_);
+	capacity_ = capacity;
+	evict_();
+}
+
+
+std::size_t image_cache::size() const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return size_;
+}
+
+
+std::size_t image_cache::entries_count() const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return entries_.size();
+}
+
+
+std::size_t image_cache::hits() const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return hits_;
+}
+
+
+std::size_t image_cache::misses() const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return misses_;
+}
+
+
+void image_cache::invalidate(const std::string& key) {
+	std::lock_guard<std::mutex> lock(mutex_);
+	auto it = index_.lower_bound(key_type(key, std::numeric_limits<int>::min()));
+	while(it != index_.end() && it->first.first == key) {
+		size_ -= it->second->bytes;
+		entries_.erase(it->second);
+		it = index_.erase(it);
+	}
+}
+
+
+void image_cache::clear() {
+	std::lock_guard<std::mutex> lock(mutex_);
+	entries_.clear();
+	index_.clear();
+	size_ = 0;
+}
+
+
+std::size_t default_image_cache_capacity() {
+	const char* size_env = std::getenv("LICORNEA_IMAGE_CACHE_SIZE");
+	std::size_t size_mb = default_image_cache_size_mb_;
+	if(size_env != nullptr) size_mb = std::strtoul(size_env, nullptr, 10);
+	return size_mb * 1024 * 1024;
+}
+
+}
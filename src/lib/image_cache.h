@@ -0,0 +1,67 @@
+#ifndef LICORNEA_IMAGE_CACHE_H_
+#define LICORNEA_IMAGE_CACHE_H_
+
+#include "common.h"
+#include "opencv.h"
+#include <string>
+#include <list>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <functional>
+
+namespace tlz {
+
+/// Thread-safe least-recently-used cache of decoded images.
+/** Entries are keyed by file name and pixel type, and evicted once their total size exceeds the capacity
+ ** in bytes. Returned images share their data with the cache, and must not be modified: callers that modify
+ ** them must clone() them first. A capacity of zero disables caching. */
+class image_cache {
+private:
+	using key_type = std::pair<std::string, int>;
+
+	struct entry {
+		key_type key;
+		cv::Mat image;
+		std::size_t bytes;
+	};
+	using entries_list = std::list<entry>;
+
+	mutable std::mutex mutex_;
+	entries_list entries_; // most recently used first
+	std::map<key_type, entries_list::iterator> index_;
+	std::size_t capacity_;
+	std::size_t size_ = 0;
+	std::size_t hits_ = 0;
+	std::size_t misses_ = 0;
+
+	void evict_();
+
+public:
+	explicit image_cache(std::size_t capacity);
+	image_cache(const image_cache&) = delete;
+	image_cache& operator=(const image_cache&) = delete;
+
+	/// Get image with given key and type, or call `loader` and insert its result if not in cache.
+	cv::Mat load(const std::string& key, int type, const std::function<cv::Mat()>& loader);
+
+	cv::Mat_<cv::Vec3b> load_texture(const std::string& filename);
+	cv::Mat_<uchar> load_gray(const std::string& filename);
+	cv::Mat_<ushort> load_depth(const std::string& filename);
+
+	std::size_t capacity() const;
+	void set_capacity(std::size_t capacity);
+	std::size_t size() const;
+	std::size_t entries_count() const;
+	std::size_t hits() const;
+	std::size_t misses() const;
+	void invalidate(const std::string& key);
+	void clear();
+};
+
+/// Default capacity in bytes, from `LICORNEA_IMAGE_CACHE_SIZE` environment variable (in MB).
+std::size_t default_image_cache_capacity();
+
+}
+
+#endif
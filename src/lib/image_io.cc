@@ -1,5 +1,8 @@
 #include "image_io.h"
+#include "depth_codec.h"
 #include <stdexcept>
+#include <fstream>
+#include <vector>
 
 namespace tlz {
 
@@ -10,6 +13,14 @@ cv::Mat_<cv::Vec3b> load_texture(const std::string& filename) {
 	return mat_;
 }
 
+cv::Mat_<cv::Vec3b> decode_texture(const byte* data, std::size_t size) {
+	cv::Mat buf(1, size, CV_8U, const_cast<byte*>(data));
+	cv::Mat mat = cv::imdecode(buf, CV_LOAD_IMAGE_COLOR);
+	if(mat.empty()) throw std::runtime_error("could not decode texture");
+	cv::Mat_<cv::Vec3b> mat_ = mat;
+	return mat_;
+}
+
 void save_texture(const std::string& filename, const cv::Mat_<cv::Vec3b>& texture) {
 	std::vector<int> params = { CV_IMWRITE_PNG_COMPRESSION, 0 };
 	cv::imwrite(filename, texture, params);
@@ -33,9 +44,21 @@ void save_ir(const std::string& filename, const cv::Mat_<ushort>& ir) {
 /////
 
 cv::Mat_<ushort> load_depth(const std::string& filename) {
-	cv::Mat mat = cv::imread(filename, CV_LOAD_IMAGE_ANYDEPTH);
-	if(mat.empty()) throw std::runtime_error("could not load depth map " + filename);
-	if(mat.depth() != CV_16U) throw std::runtime_error("input depth map " + filename + " is not must be 16 bit");
+	std::ifstream stream(filename, std::ios_base::binary | std::ios_base::ate);
+	if(! stream) throw std::runtime_error("could not load depth map " + filename);
+	std::vector<byte> data(stream.tellg());
+	stream.seekg(0);
+	stream.read(reinterpret_cast<char*>(data.data()), data.size());
+	if(! stream) throw std::runtime_error("could not load depth map " + filename);
+	return decode_depth(data.data(), data.size());
+}
+
+cv::Mat_<ushort> decode_depth(const byte* data, std::size_t size) {
+	if(rice_depth_codec::is_encoded(data, size)) return rice_depth_codec().decode(data, size);
+	cv::Mat buf(1, size, CV_8U, const_cast<byte*>(data));
+	cv::Mat mat = cv::imdecode(buf, CV_LOAD_IMAGE_ANYDEPTH);
+	if(mat.empty()) throw std::runtime_error("could not decode depth map");
+	if(mat.depth() != CV_16U) throw std::runtime_error("input depth map is not 16 bit");
 	cv::Mat_<ushort> mat_ = mat;
 	return mat_;
 }
@@ -45,4 +68,14 @@ void save_depth(const std::string& filename, const cv::Mat_<ushort>& depth) {
 	cv::imwrite(filename, depth, params);
 }
 
+/////
+
+cv::Mat_<uchar> decode_gray(const byte* data, std::size_t size) {
+	cv::Mat buf(1, size, CV_8U, const_cast<byte*>(data));
+	cv::Mat mat = cv::imdecode(buf, CV_LOAD_IMAGE_GRAYSCALE);
+	if(mat.empty()) throw std::runtime_error("could not decode texture");
+	cv::Mat_<uchar> mat_ = mat;
+	return mat_;
+}
+
 }
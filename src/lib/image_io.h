@@ -8,14 +8,18 @@
 namespace tlz {
 
 cv::Mat_<cv::Vec3b> load_texture(const std::string& filename);
+cv::Mat_<cv::Vec3b> decode_texture(const byte* data, std::size_t size);
 void save_texture(const std::string& filename, const cv::Mat_<cv::Vec3b>&);
 
 cv::Mat_<ushort> load_ir(const std::string& filename);
 void save_ir(const std::string& filename, const cv::Mat_<ushort>&);
 
 cv::Mat_<ushort> load_depth(const std::string& filename);
+cv::Mat_<ushort> decode_depth(const byte* data, std::size_t size);
 void save_depth(const std::string& filename, const cv::Mat_<ushort>&);
 
+cv::Mat_<uchar> decode_gray(const byte* data, std::size_t size);
+
 }
 
 #endif
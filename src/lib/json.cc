@@ -29,6 +29,13 @@ json import_json_file(const std::string& filename) {
 }
 
 
+json import_json_file(const std::string& filename, const json::parser_callback_t& callback) {
+	std::ifstream input(filename);
+	if(! input) throw std::runtime_error("could not open json file " + filename);
+	return json::parse(input, callback);
+}
+
+
 cv::Mat_<real> decode_mat(const json& j) {
 	int rows = j.size();
 	if(j[0].is_array()) {
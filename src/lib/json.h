@@ -13,6 +13,11 @@ using json = nlohmann::json;
 void export_json_file(const json&, const std::string& filename, bool compact = false);
 json import_json_file(const std::string& filename);
 
+/// Parse JSON file, and pass parser events to \a callback.
+/** Values for which the callback returns `false` are discarded right away, so a large file can be processed
+ ** incrementally without building its full DOM. See nlohmann::json::parser_callback_t. */
+json import_json_file(const std::string& filename, const json::parser_callback_t& callback);
+
 cv::Mat_<real> decode_mat(const json&);
 
 json encode_mat_(const cv::Mat_<real>&);
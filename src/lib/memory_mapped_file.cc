@@ -0,0 +1,29 @@
+#include "memory_mapped_file.h"
+#include <utility>
+
+namespace tlz {
+
+memory_mapped_file::memory_mapped_file(memory_mapped_file&& other) :
+	data_(other.data_), size_(other.size_), handle_(other.handle_)
+{
+	other.data_ = nullptr;
+	other.size_ = 0;
+	other.handle_ = nullptr;
+}
+
+
+memory_mapped_file& memory_mapped_file::operator=(memory_mapped_file&& other) {
+	if(&other == this) return *this;
+	unmap_();
+	std::swap(data_, other.data_);
+	std::swap(size_, other.size_);
+	std::swap(handle_, other.handle_);
+	return *this;
+}
+
+
+memory_mapped_file::~memory_mapped_file() {
+	unmap_();
+}
+
+}
@@ -0,0 +1,34 @@
+#ifndef LICORNEA_UTILITY_MEMORY_MAPPED_FILE_H_
+#define LICORNEA_UTILITY_MEMORY_MAPPED_FILE_H_
+
+#include "common.h"
+#include <string>
+
+namespace tlz {
+
+/// Read-only memory mapping of an entire file.
+/** The mapping stays valid for the lifetime of the object. Empty files yield `data() == nullptr`. */
+class memory_mapped_file {
+private:
+	const byte* data_ = nullptr;
+	std::size_t size_ = 0;
+	void* handle_ = nullptr; // file mapping handle (Windows only)
+	
+	void unmap_();
+
+public:
+	explicit memory_mapped_file(const std::string& filename);
+	~memory_mapped_file();
+	
+	memory_mapped_file(const memory_mapped_file&) = delete;
+	memory_mapped_file& operator=(const memory_mapped_file&) = delete;
+	memory_mapped_file(memory_mapped_file&&);
+	memory_mapped_file& operator=(memory_mapped_file&&);
+	
+	const byte* data() const { return data_; }
+	std::size_t size() const { return size_; }
+};
+
+}
+
+#endif
@@ -0,0 +1,48 @@
+#include "os.h"
+#if defined(LICORNEA_OS_LINUX) || defined(LICORNEA_OS_DARWIN)
+#include "memory_mapped_file.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <system_error>
+
+namespace tlz {
+
+memory_mapped_file::memory_mapped_file(const std::string& filename) {
+	int fd = open(filename.c_str(), O_RDONLY);
+	if(fd == -1) throw std::system_error(errno, std::system_category(), "open() failed for " + filename);
+	
+	struct stat sb;
+	if(fstat(fd, &sb) != 0) {
+		int err = errno;
+		close(fd);
+		throw std::system_error(err, std::system_category(), "fstat() failed for " + filename);
+	}
+	size_ = sb.st_size;
+	
+	if(size_ > 0) {
+		void* addr = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+		if(addr == MAP_FAILED) {
+			int err = errno;
+			close(fd);
+			throw std::system_error(err, std::system_category(), "mmap() failed for " + filename);
+		}
+		data_ = static_cast<const byte*>(addr);
+	}
+	
+	close(fd); // mapping remains valid after closing the descriptor
+}
+
+
+void memory_mapped_file::unmap_() {
+	if(data_ != nullptr) munmap(const_cast<byte*>(data_), size_);
+	data_ = nullptr;
+	size_ = 0;
+}
+
+}
+
+#endif
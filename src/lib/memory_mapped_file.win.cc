@@ -0,0 +1,54 @@
+#include "os.h"
+#if defined(LICORNEA_OS_WINDOWS)
+#include "memory_mapped_file.h"
+#include <windows.h>
+#include <system_error>
+
+namespace tlz {
+
+memory_mapped_file::memory_mapped_file(const std::string& filename) {
+	HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if(file == INVALID_HANDLE_VALUE)
+		throw std::system_error(GetLastError(), std::system_category(), "CreateFile() failed for " + filename);
+	
+	LARGE_INTEGER sz;
+	if(! GetFileSizeEx(file, &sz)) {
+		DWORD err = GetLastError();
+		CloseHandle(file);
+		throw std::system_error(err, std::system_category(), "GetFileSizeEx() failed for " + filename);
+	}
+	size_ = sz.QuadPart;
+	
+	if(size_ > 0) {
+		HANDLE mapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if(mapping == NULL) {
+			DWORD err = GetLastError();
+			CloseHandle(file);
+			throw std::system_error(err, std::system_category(), "CreateFileMapping() failed for " + filename);
+		}
+		void* addr = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if(addr == NULL) {
+			DWORD err = GetLastError();
+			CloseHandle(mapping);
+			CloseHandle(file);
+			throw std::system_error(err, std::system_category(), "MapViewOfFile() failed for " + filename);
+		}
+		data_ = static_cast<const byte*>(addr);
+		handle_ = mapping;
+	}
+	
+	CloseHandle(file);
+}
+
+
+void memory_mapped_file::unmap_() {
+	if(data_ != nullptr) UnmapViewOfFile(data_);
+	if(handle_ != nullptr) CloseHandle(static_cast<HANDLE>(handle_));
+	data_ = nullptr;
+	handle_ = nullptr;
+	size_ = 0;
+}
+
+}
+
+#endif
@@ -1,9 +1,39 @@
 #include "ply_importer.h"
 #include "string.h"
 #include <algorithm>
+#include <cstring>
 
 namespace tlz {
 
+namespace {
+	bool is_space_(char c) {
+		return std::isspace(static_cast<unsigned char>(c));
+	}
+
+	template<typename T, typename Source, bool Flip>
+	T decode_binary_property_(const byte* data) {
+		Source value;
+		std::memcpy(&value, data, sizeof(Source));
+		if(Flip) flip_endianness(value);
+		return static_cast<T>(value);
+	}
+	
+	template<typename T, bool Flip>
+	T (*binary_property_decoder_(int type))(const byte*) {
+		switch(type) {
+			case 1: return &decode_binary_property_<T, std::int8_t, Flip>;
+			case 2: return &decode_binary_property_<T, std::uint8_t, Flip>;
+			case 3: return &decode_binary_property_<T, std::int16_t, Flip>;
+			case 4: return &decode_binary_property_<T, std::uint16_t, Flip>;
+			case 5: return &decode_binary_property_<T, std::int32_t, Flip>;
+			case 6: return &decode_binary_property_<T, std::uint32_t, Flip>;
+			case 7: return &decode_binary_property_<T, float, Flip>;
+			case 8: return &decode_binary_property_<T, double, Flip>;
+			default: return nullptr;
+		}
+	}
+}
+
 template<typename Point>
 void ply_importer::read_ascii_(Point* buffer, std::size_t n) {
 	std::string line;
@@ -16,7 +46,7 @@ void ply_importer::read_ascii_(Point* buffer, std::size_t n) {
 		
 		bool last_space = true;
 		for(const char& c : line) {
-			bool space = std::isspace(c);
+			bool space = is_space_(c);
 			if(last_space == space) continue;
 			else if(last_space) *(property++) = &c;
 			last_space = space;
@@ -41,25 +71,13 @@ void ply_importer::read_binary_(Point* out, std::size_t n) {
 
 
 template<typename T>
-T ply_importer::read_binary_property_(const property& prop, byte* data) const {
-	std::size_t sz = property_type_size_(prop.type);
-	data += prop.offset;
-	if(! is_host_endian_binary_()) flip_endianness(data, sz);
-	switch(prop.type) {
-		case int8:   return static_cast<T>( *reinterpret_cast<const std::int8_t*>(data) );
-		case uint8:  return static_cast<T>( *reinterpret_cast<const std::uint8_t*>(data) );
-		case int16:  return static_cast<T>( *reinterpret_cast<const std::int16_t*>(data) );
-		case uint16: return static_cast<T>( *reinterpret_cast<const std::uint16_t*>(data) );
-		case int32:  return static_cast<T>( *reinterpret_cast<const std::int32_t*>(data) );
-		case uint32: return static_cast<T>( *reinterpret_cast<const std::uint32_t*>(data) );
-		default: break;
-	}
-	if(host_has_iec559_float) switch(prop.type) {
-		case float32: return static_cast<T>( *reinterpret_cast<const float*>(data) );
-		case float64: return static_cast<T>( *reinterpret_cast<const double*>(data) );
-		default: break;
-	}
-	return T();
+auto ply_importer::binary_decoder_(const property& prop) const -> binary_decoder<T> {
+	static_assert(int8 == 1 && float64 == 8, "property_type values must match binary_property_decoder_");
+	if(! prop) return nullptr;
+	if(! host_has_iec559_float && (prop.type == float32 || prop.type == float64))
+		throw ply_importer_error("Floating point properties not supported on host");
+	if(is_host_endian_binary_()) return binary_property_decoder_<T, false>(prop.type);
+	else return binary_property_decoder_<T, true>(prop.type);
 }
 
 
@@ -179,7 +197,7 @@ void ply_importer::read_header_() {
 			if(state == before_vertex_definition) throw ply_importer_error("No vertex element definition.");
 			data_start = file_.tellg(); // Start of data.
 
-		} else if(! std::all_of(line.begin(), line.end(), isspace)) {
+		} else if(! std::all_of(line.begin(), line.end(), is_space_)) {
 			// Invalid line, not all whitespace.
 			throw ply_importer_error("Invalid line encountered: " + line);
 		}
@@ -193,6 +211,15 @@ void ply_importer::read_header_() {
 	vertex_length_ = vertex_property_data_offset;
 	number_of_properties_ = vertex_property_index;
 	
+	if(is_binary()) {
+		x_decoder_ = binary_decoder_<float>(x_);
+		y_decoder_ = binary_decoder_<float>(y_);
+		z_decoder_ = binary_decoder_<float>(z_);
+		r_decoder_ = binary_decoder_<std::uint8_t>(r_);
+		g_decoder_ = binary_decoder_<std::uint8_t>(g_);
+		b_decoder_ = binary_decoder_<std::uint8_t>(b_);
+	}
+	
 	if(is_binary()) {
 		// Directly calculate vertex data start
 		vertex_data_start_ = data_start + vertex_data_start_offset;
@@ -211,6 +238,7 @@ void ply_importer::rewind() {
 
 
 ply_importer::ply_importer(const std::string& filename, line_delimitor ld) :
+filename_(filename),
 file_(filename, std::ios_base::in | std::ios_base::binary),
 line_delimitor_(ld != line_delimitor::unknown ? ld : detect_line_delimitor(file_)) {
 	read_header_();	
@@ -254,51 +282,154 @@ void ply_importer::read_ascii_point_(point_full& pt, const char* props[]) const
 }
 
 
-void ply_importer::read_binary_point_(point_xyz& pt, byte* data) const {
+void ply_importer::read_binary_point_(point_xyz& pt, const byte* data) const {
 	pt = point_xyz(
-		read_binary_property_<float>(x_, data),
-		read_binary_property_<float>(y_, data),
-		read_binary_property_<float>(z_, data)
+		x_decoder_(data + x_.offset),
+		y_decoder_(data + y_.offset),
+		z_decoder_(data + z_.offset)
 	);
 }
 
 
-void ply_importer::read_binary_point_(point_full& pt, byte* data) const {
+void ply_importer::read_binary_point_(point_full& pt, const byte* data) const {
 	pt = point_xyz(
-		read_binary_property_<float>(x_, data),
-		read_binary_property_<float>(y_, data),
-		read_binary_property_<float>(z_, data)
+		x_decoder_(data + x_.offset),
+		y_decoder_(data + y_.offset),
+		z_decoder_(data + z_.offset)
 	);
 	if(has_rgb_) pt.color = rgb_color(
-		read_binary_property_<std::uint8_t>(r_, data),
-		read_binary_property_<std::uint8_t>(g_, data),
-		read_binary_property_<std::uint8_t>(b_, data)
+		r_decoder_(data + r_.offset),
+		g_decoder_(data + g_.offset),
+		b_decoder_(data + b_.offset)
 	);
 }
 
 
-void ply_importer::read(point_xyz* buffer, std::size_t n) {
-	if(current_element_ + n > number_of_vertices_)
-		throw ply_importer_error("attempted to read beyond bounds");
+const memory_mapped_file& ply_importer::mapped_file_data_() {
+	if(! mapped_file_) mapped_file_.reset(new memory_mapped_file(filename_));
+	return *mapped_file_;
+}
+
+
+template<typename Point>
+void ply_importer::read_mapped_binary_(Point* out, std::size_t n) {
+	const memory_mapped_file& mapped = mapped_file_data_();
+	std::size_t start = file_.tellg();
+	if(start + n * vertex_length_ > mapped.size()) throw ply_importer_error("PLY file is truncated");
+	const byte* in = mapped.data() + start;
 	
-	if(is_ascii()) read_ascii_(buffer, n);
-	else read_binary_(buffer, n);
+	#pragma omp parallel for schedule(static)
+	for(std::ptrdiff_t i = 0; i < n; ++i)
+		read_binary_point_(out[i], in + i * vertex_length_);
 	
-	current_element_ += n;
+	file_.seekg(start + n * vertex_length_);
 }
 
 
-void ply_importer::read(point_full* buffer, std::size_t n) {
+template<typename Point>
+void ply_importer::read_mapped_ascii_(Point* out, std::size_t n) {
+	const memory_mapped_file& mapped = mapped_file_data_();
+	const char* data = reinterpret_cast<const char*>(mapped.data());
+	std::size_t start = file_.tellg();
+	std::size_t end = mapped.size();
+	char delimitor = (line_delimitor_ == line_delimitor::CR ? '\r' : '\n');
+	
+	// split data into chunks starting at line boundaries
+	std::size_t chunks_count = std::max<std::size_t>(1, (end - start) / ascii_chunk_length_);
+	std::vector<std::size_t> chunk_starts(chunks_count + 1);
+	chunk_starts[0] = start;
+	chunk_starts[chunks_count] = end;
+	for(std::ptrdiff_t chunk = 1; chunk < chunks_count; ++chunk) {
+		std::size_t nominal_start = start + chunk * ascii_chunk_length_;
+		const char* line_end = static_cast<const char*>(std::memchr(data + nominal_start, delimitor, end - nominal_start));
+		chunk_starts[chunk] = (line_end ? line_end - data + 1 : end);
+	}
+	
+	// count lines in each chunk, to get index of first vertex of each chunk
+	std::vector<std::size_t> chunk_first_vertex(chunks_count + 1, 0);
+	#pragma omp parallel for
+	for(std::ptrdiff_t chunk = 0; chunk < chunks_count; ++chunk) {
+		std::size_t begin = std::min(chunk_starts[chunk], chunk_starts[chunk + 1]);
+		chunk_first_vertex[chunk + 1] = std::count(data + begin, data + chunk_starts[chunk + 1], delimitor);
+	}
+	for(std::ptrdiff_t chunk = 0; chunk < chunks_count; ++chunk)
+		chunk_first_vertex[chunk + 1] += chunk_first_vertex[chunk];
+	// last line may end at end of file, without delimitor
+	std::size_t lines_count = chunk_first_vertex[chunks_count];
+	if(end > start && data[end - 1] != delimitor) ++lines_count;
+	if(lines_count < n) throw ply_importer_error("PLY file is truncated");
+		
+	// parse lines of each chunk
+	std::size_t read_end = end;
+	#pragma omp parallel for schedule(dynamic)
+	for(std::ptrdiff_t chunk = 0; chunk < chunks_count; ++chunk) {
+		std::size_t vertex = chunk_first_vertex[chunk];
+		if(vertex >= n) continue;
+		
+		std::vector<const char*> properties(number_of_properties_, nullptr);
+		char line[maximal_ascii_element_line_length_ + 1];
+		
+		const char* pos = data + chunk_starts[chunk];
+		const char* chunk_end = data + chunk_starts[chunk + 1];
+		while(pos < chunk_end && vertex < n) {
+			const char* line_end = static_cast<const char*>(std::memchr(pos, delimitor, chunk_end - pos));
+			if(! line_end) line_end = chunk_end;
+			std::size_t length = std::min<std::size_t>(line_end - pos, maximal_ascii_element_line_length_);
+			std::memcpy(line, pos, length);
+			line[length] = '\0';
+			
+			std::fill(properties.begin(), properties.end(), line + length);
+			auto property = properties.begin();
+			bool last_space = true;
+			for(const char* c = line; c != line + length && property != properties.end(); ++c) {
+				bool space = is_space_(*c);
+				if(last_space == space) continue;
+				else if(last_space) *(property++) = c;
+				last_space = space;
+			}
+			read_ascii_point_(out[vertex], properties.data());
+			
+			++vertex;
+			pos = line_end + 1;
+			if(vertex == n) {
+				#pragma omp critical
+				read_end = std::min<std::size_t>(pos - data, end);
+			}
+		}
+	}
+	
+	file_.clear();
+	file_.seekg(read_end);
+}
+
+
+template<typename Point>
+void ply_importer::read_(Point* buffer, std::size_t n) {
 	if(current_element_ + n > number_of_vertices_)
 		throw ply_importer_error("attempted to read beyond bounds");
 	
-	if(is_ascii()) read_ascii_(buffer, n);
-	else read_binary_(buffer, n);
+	if(n >= minimal_mapped_read_size_) {
+		if(is_ascii()) read_mapped_ascii_(buffer, n);
+		else read_mapped_binary_(buffer, n);
+	} else {
+		if(is_ascii()) read_ascii_(buffer, n);
+		else read_binary_(buffer, n);
+	}
 	
 	current_element_ += n;
 }
 
 
+void ply_importer::read(point_xyz* buffer, std::size_t n) {
+	read_(buffer, n);
+}
+
+
+void ply_importer::read(point_full* buffer, std::size_t n) {
+	read_(buffer, n);
+}
+
+
 std::ptrdiff_t ply_importer::tell() const {
 	return current_element_;
 }
@@ -17,6 +17,7 @@
 #include "common.h"
 #include "io.h"
 #include "point.h"
+#include "memory_mapped_file.h"
 	
 namespace tlz {
 	
@@ -29,10 +30,15 @@ public:
 /// Imports point cloud from PLY file.
 /** Reads only points (vertices), possibly with RGB color and normal vector data. Supports ASCII and binary formats.
  ** Detects line ending type from file. File may contains other elements except vertex, but those are not read.
- ** List-type properties are not supported, and are only tolerated in elements behinds vertex. */
+ ** List-type properties are not supported, and are only tolerated in elements behinds vertex.
+ ** Large reads go through a memory mapping of the file, and are decoded in parallel: for binary, with decoders
+ ** for the property types selected once from the header; for ASCII, after splitting the data into chunks at line
+ ** boundaries. */
 class ply_importer {
 private:
 	const static std::size_t maximal_ascii_element_line_length_ = 256;
+	const static std::size_t minimal_mapped_read_size_ = 1 << 16; ///< Minimal number of vertices to read through mapping.
+	const static std::size_t ascii_chunk_length_ = 1 << 22; ///< Approximate size in bytes of ASCII data chunks.
 
 	enum property_type {
 		none, int8, uint8, int16, uint16, int32, uint32, float32, float64, list
@@ -45,8 +51,12 @@ private:
 		
 		explicit operator bool() const { return (type != none); }
 	};
+	
+	template<typename T> using binary_decoder = T (*)(const byte*);
 		
+	std::string filename_;
 	std::ifstream file_;
+	std::unique_ptr<memory_mapped_file> mapped_file_; ///< Mapping of file, opened on first large read.
 	line_delimitor line_delimitor_;
 	std::ifstream::pos_type vertex_data_start_; ///< File offset where vertex data starts.
 	std::size_t number_of_vertices_; ///< Number of vertex elements in file.
@@ -57,6 +67,8 @@ private:
 	bool has_normal_; ///< Whether nx_, ny_, nz_ are defined.
 	bool has_weight_; ///< Whether w_ is defined.
 	property x_, y_, z_, r_, g_, b_, nx_, ny_, nz_, w_; ///< Offsets, Indices and types of vertex properties.
+	binary_decoder<float> x_decoder_, y_decoder_, z_decoder_; ///< For binary formats, decoders for properties.
+	binary_decoder<std::uint8_t> r_decoder_, g_decoder_, b_decoder_;
 	
 	std::ptrdiff_t current_element_; ///< Index of current element.
 
@@ -77,16 +89,20 @@ private:
 	property* identify_property_(const std::string& nm);
 	static property_type identify_property_type_(const std::string& nm);
 	static std::size_t property_type_size_(property_type t);
+	template<typename T> binary_decoder<T> binary_decoder_(const property& prop) const;
 	void read_header_();
 	
+	template<typename Point> void read_(Point* buffer, std::size_t n);
 	template<typename Point> void read_ascii_(Point* buffer, std::size_t n);
 	template<typename Point> void read_binary_(Point* buffer, std::size_t n);
+	template<typename Point> void read_mapped_ascii_(Point* buffer, std::size_t n);
+	template<typename Point> void read_mapped_binary_(Point* buffer, std::size_t n);
+	const memory_mapped_file& mapped_file_data_();
 	
 	void read_ascii_point_(point_xyz& out_point, const char* props[]) const;
 	void read_ascii_point_(point_full& out_point, const char* props[]) const;
-	void read_binary_point_(point_xyz& out_point, byte* data) const;
-	void read_binary_point_(point_full& out_point, byte* data) const;
-	template<typename T> T read_binary_property_(const property& prop, byte* data) const;
+	void read_binary_point_(point_xyz& out_point, const byte* data) const;
+	void read_binary_point_(point_full& out_point, const byte* data) const;
 
 public:
 	explicit ply_importer(const std::string& filename, line_delimitor ld = line_delimitor::unknown);
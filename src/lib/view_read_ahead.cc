@@ -0,0 +1,94 @@
+#include "view_read_ahead.h"
+#include <stdexcept>
+#include <algorithm>
+
+namespace tlz {
+
+view_read_ahead::view_read_ahead(const dataset_group& datag, const std::vector<view_index>& indices, int components, std::size_t window, int threads_count) :
+	datag_(datag),
+	indices_(indices),
+	components_(components),
+	window_(std::max<std::size_t>(window, 1))
+{
+	threads_count = std::max(1, std::min<int>(threads_count, window_));
+	for(int t = 0; t < threads_count; ++t) threads_.emplace_back(&view_read_ahead::thread_main_, this);
+}
+
+
+view_read_ahead::~view_read_ahead() {
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stop_ = true;
+	}
+	consumed_cond_.notify_all();
+	for(std::thread& th : threads_) th.join();
+}
+
+
+read_ahead_view view_read_ahead::load_(std::ptrdiff_t i) const {
+	read_ahead_view view;
+	view.idx = indices_[i];
+	dataset_view dview = datag_.view(view.idx);
+
+	try {
+		if((components_ & (texture | gray)) && dview.image_exists()) {
+			if(components_ & texture) view.texture = dview.load_texture();
+			if(components_ & gray) view.gray = dview.load_gray();
+		}
+	} catch(const std::runtime_error&) { }
+
+	try {
+		if((components_ & depth) && dview.depth_exists())
+			view.depth = dview.load_depth();
+	} catch(const std::runtime_error&) { }
+
+	return view;
+}
+
+
+void view_read_ahead::thread_main_() {
+	for(;;) {
+		std::ptrdiff_t i;
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			consumed_cond_.wait(lock, [&] {
+				return stop_ || next_load_ >= indices_.size() || next_load_ < next_consume_ + window_;
+			});
+			if(stop_ || next_load_ >= indices_.size()) return;
+			i = next_load_++;
+		}
+
+		slot sl;
+		try {
+			sl.view = load_(i);
+		} catch(...) {
+			sl.error = std::current_exception();
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			loaded_[i] = std::move(sl);
+		}
+		loaded_cond_.notify_all();
+	}
+}
+
+
+bool view_read_ahead::next(read_ahead_view& view) {
+	std::unique_lock<std::mutex> lock(mutex_);
+	if(next_consume_ >= indices_.size()) return false;
+
+	loaded_cond_.wait(lock, [&] { return loaded_.count(next_consume_) == 1; });
+	auto it = loaded_.find(next_consume_);
+	slot sl = std::move(it->second);
+	loaded_.erase(it);
+	++next_consume_;
+
+	lock.unlock();
+	consumed_cond_.notify_all();
+	if(sl.error) std::rethrow_exception(sl.error);
+	view = std::move(sl.view);
+	return true;
+}
+
+}
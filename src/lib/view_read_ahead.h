@@ -0,0 +1,78 @@
+#ifndef LICORNEA_VIEW_READ_AHEAD_H_
+#define LICORNEA_VIEW_READ_AHEAD_H_
+
+#include "common.h"
+#include "opencv.h"
+#include "dataset.h"
+#include <vector>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+
+namespace tlz {
+
+/// Images of one view, loaded by view_read_ahead.
+/** Images that were not requested, or whose file does not exist or could not be loaded, are empty.
+ ** As they come from the dataset's image cache, they must be cloned before modifying them. */
+struct read_ahead_view {
+	view_index idx;
+	cv::Mat_<cv::Vec3b> texture;
+	cv::Mat_<uchar> gray;
+	cv::Mat_<ushort> depth;
+};
+
+/// Sequential traversal of dataset views, with images loaded in advance on background threads.
+/** Views are handed out by next() in the order of the given indices. Up to `window` views ahead of the
+ ** consumer are loaded concurrently, so that decoding of upcoming images overlaps with computation on the
+ ** current one. Loads go through the dataset's image cache.
+ ** Destroying the object before the end is reached stops the loading threads. */
+class view_read_ahead {
+public:
+	enum component {
+		texture = 1,
+		gray = 2,
+		depth = 4
+	};
+
+private:
+	/// Loaded view, or error that occurred while loading it.
+	struct slot {
+		read_ahead_view view;
+		std::exception_ptr error;
+	};
+
+	dataset_group datag_;
+	std::vector<view_index> indices_;
+	int components_;
+	std::size_t window_;
+
+	std::mutex mutex_;
+	std::condition_variable loaded_cond_;
+	std::condition_variable consumed_cond_;
+	std::map<std::ptrdiff_t, slot> loaded_;
+	std::ptrdiff_t next_load_ = 0;
+	std::ptrdiff_t next_consume_ = 0;
+	bool stop_ = false;
+	std::vector<std::thread> threads_;
+
+	read_ahead_view load_(std::ptrdiff_t i) const;
+	void thread_main_();
+
+public:
+	view_read_ahead(const dataset_group&, const std::vector<view_index>& indices, int components, std::size_t window = 8, int threads_count = 2);
+	~view_read_ahead();
+	view_read_ahead(const view_read_ahead&) = delete;
+	view_read_ahead& operator=(const view_read_ahead&) = delete;
+
+	std::size_t size() const { return indices_.size(); }
+
+	/// Wait for next view to be loaded, and move it into `view`. Returns false after the last view.
+	/** If loading the view failed with an exception other than `std::runtime_error`, it is rethrown here. */
+	bool next(read_ahead_view& view);
+};
+
+}
+
+#endif
@@ -124,9 +124,9 @@ int main(int argc, const char* argv[]) {
 			view_index tg_idx(slider_tg_x, slider_tg_y);
 			if(! datas.valid(ref_idx) || ! datas.valid(tg_idx)) return;		
 			
-			cv::Mat_<cv::Vec3b> ref_image = load_texture(datag.view(ref_idx).image_filename());
-			cv::Mat_<cv::Vec3b> tg_image = load_texture(datag.view(tg_idx).image_filename());
-			cv::Mat_<ushort> tg_depth = load_depth(datag.view(tg_idx).depth_filename());
+			cv::Mat_<cv::Vec3b> ref_image = datag.view(ref_idx).load_texture();
+			cv::Mat_<cv::Vec3b> tg_image = datag.view(tg_idx).load_texture();
+			cv::Mat_<ushort> tg_depth = datag.view(tg_idx).load_depth();
 			camera ref_cam = cams_map.at(datas.view(ref_idx).camera_name());
 			camera tg_cam = cams_map.at(datas.view(tg_idx).camera_name());
 			